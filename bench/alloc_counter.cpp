@@ -0,0 +1,73 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <curl/curl.h>
+#include <new>
+
+namespace {
+
+thread_local bool t_counting = false;
+thread_local size_t t_allocations = 0;
+thread_local size_t t_bytes = 0;
+
+inline void count_allocation(size_t size) {
+    if (t_counting) {
+        ++t_allocations;
+        t_bytes += size;
+    }
+}
+
+void* counted_malloc(size_t size) {
+    count_allocation(size);
+    return std::malloc(size);
+}
+
+void* counted_calloc(size_t n, size_t size) {
+    count_allocation(n * size);
+    return std::calloc(n, size);
+}
+
+void* counted_realloc(void* p, size_t size) {
+    count_allocation(size);
+    return std::realloc(p, size);
+}
+
+char* counted_strdup(const char* s) {
+    count_allocation(std::strlen(s) + 1);
+    return strdup(s);
+}
+
+void* allocate(size_t size) {
+    count_allocation(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace neuron::bench {
+
+void start_counting() {
+    t_allocations = 0;
+    t_bytes = 0;
+    t_counting = true;
+}
+
+AllocationCount stop_counting() {
+    t_counting = false;
+    return {t_allocations, t_bytes};
+}
+
+void install_curl_allocator() {
+    curl_global_init_mem(CURL_GLOBAL_DEFAULT, counted_malloc, std::free, counted_realloc, counted_strdup, counted_calloc);
+}
+
+} // namespace neuron::bench
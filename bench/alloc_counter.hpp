@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+namespace neuron::bench {
+
+struct AllocationCount {
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+// Counts heap allocations made by the calling thread between start and stop,
+// including libcurl's once install_curl_allocator has been called. Other
+// threads (the mock server's) are not counted.
+void start_counting();
+AllocationCount stop_counting();
+
+// Initializes libcurl with allocators that feed the same counters
+void install_curl_allocator();
+
+} // namespace neuron::bench
@@ -0,0 +1,291 @@
+#include "mock_server.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS: the benchmark ignores SIGPIPE process-wide instead
+#endif
+
+namespace neuron::bench {
+
+namespace {
+
+bool send_all(int fd, const std::string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string lowercase(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::string chunk(const std::string& data) {
+    char size[32];
+    std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    return size + data + "\r\n";
+}
+
+struct Request {
+    std::string method;
+    std::string body;
+    bool keep_alive = true;
+};
+
+// Reads one request off a keep-alive connection, polling so stop() is noticed
+class RequestReader {
+public:
+    RequestReader(int fd, const std::atomic<bool>& stopping) : fd_(fd), stopping_(stopping) {}
+
+    bool next(Request& request) {
+        size_t header_end;
+        while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) return false;
+        }
+
+        std::string head = lowercase(buffer_.substr(0, header_end));
+        request.method = buffer_.substr(0, buffer_.find(' '));
+        request.keep_alive = head.find("connection: close") == std::string::npos;
+        buffer_.erase(0, header_end + 4);
+
+        size_t length = 0;
+        size_t pos = head.find("content-length:");
+        if (pos != std::string::npos) {
+            length = std::strtoul(head.c_str() + pos + 15, nullptr, 10);
+        }
+
+        if (head.find("transfer-encoding: chunked") != std::string::npos) {
+            return read_chunked(request.body);
+        }
+
+        while (buffer_.size() < length) {
+            if (!fill()) return false;
+        }
+        request.body = buffer_.substr(0, length);
+        buffer_.erase(0, length);
+        return true;
+    }
+
+private:
+    int fd_;
+    const std::atomic<bool>& stopping_;
+    std::string buffer_;
+
+    bool fill() {
+        while (!stopping_) {
+            pollfd pfd{fd_, POLLIN, 0};
+            int ready = poll(&pfd, 1, 100);
+            if (ready < 0 && errno != EINTR) return false;
+            if (ready <= 0) continue;
+
+            char data[16384];
+            ssize_t n = recv(fd_, data, sizeof(data), 0);
+            if (n <= 0) return false;
+            buffer_.append(data, static_cast<size_t>(n));
+            return true;
+        }
+        return false;
+    }
+
+    bool read_chunked(std::string& body) {
+        while (true) {
+            size_t line_end;
+            while ((line_end = buffer_.find("\r\n")) == std::string::npos) {
+                if (!fill()) return false;
+            }
+            size_t size = std::strtoul(buffer_.c_str(), nullptr, 16);
+            buffer_.erase(0, line_end + 2);
+
+            while (buffer_.size() < size + 2) {
+                if (!fill()) return false;
+            }
+            body.append(buffer_, 0, size);
+            buffer_.erase(0, size + 2);
+            if (size == 0) return true;
+        }
+    }
+};
+
+} // namespace
+
+MockServer::MockServer(const MockOptions& options)
+    : options_(options) {}
+
+MockServer::~MockServer() {
+    stop();
+}
+
+std::string MockServer::base_url() const {
+    return "http://127.0.0.1:" + std::to_string(port_);
+}
+
+void MockServer::start() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("mock server: socket failed");
+    }
+
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 512) != 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error(std::string("mock server: cannot listen: ") + std::strerror(errno));
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    acceptor_ = std::thread([this] { accept_loop(); });
+}
+
+void MockServer::stop() {
+    if (listen_fd_ < 0) return;
+
+    stopping_ = true;
+    if (acceptor_.joinable()) acceptor_.join();
+
+    std::vector<std::thread> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& t : connections) {
+        t.join();
+    }
+
+    close(listen_fd_);
+    listen_fd_ = -1;
+}
+
+void MockServer::accept_loop() {
+    while (!stopping_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.emplace_back([this, fd] {
+            serve_connection(fd);
+            close(fd);
+        });
+    }
+}
+
+std::string MockServer::completion_text() const {
+    static const std::string words = "find . -type f -size +100M -exec ls -lh {} + ";
+    std::string text;
+    text.reserve(options_.payload_bytes);
+    while (text.size() < options_.payload_bytes) {
+        text.append(words, 0, std::min(words.size(), options_.payload_bytes - text.size()));
+    }
+    return text;
+}
+
+void MockServer::serve_connection(int fd) {
+    std::mt19937 rng(static_cast<unsigned>(fd) * 2654435761u);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    RequestReader reader(fd, stopping_);
+    Request request;
+
+    while (reader.next(request)) {
+        ++requests_;
+        const std::string connection = request.keep_alive ? "keep-alive" : "close";
+
+        // Warm-up probes (HEAD/GET) just get an empty 404
+        if (request.method != "POST") {
+            if (!send_all(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: " + connection + "\r\n\r\n")) return;
+            if (!request.keep_alive) return;
+            request = Request{};
+            continue;
+        }
+
+        if (options_.latency.count() > 0) {
+            std::this_thread::sleep_for(options_.latency);
+        }
+
+        if (options_.error_rate > 0 && coin(rng) < options_.error_rate) {
+            std::string body = R"({"error":{"message":"injected failure","type":"server_error"}})";
+            std::string response = "HTTP/1.1 503 Service Unavailable\r\nContent-Type: application/json\r\n"
+                                   "Retry-After: 0\r\nContent-Length: " + std::to_string(body.size()) +
+                                   "\r\nConnection: " + connection + "\r\n\r\n" + body;
+            if (!send_all(fd, response) || !request.keep_alive) return;
+            request = Request{};
+            continue;
+        }
+
+        const std::string text = completion_text();
+        const std::string usage = R"("usage":{"prompt_tokens":)" + std::to_string(request.body.size() / 4) +
+                                  R"(,"completion_tokens":)" + std::to_string(text.size() / 4 + 1) +
+                                  R"(,"total_tokens":)" + std::to_string((request.body.size() + text.size()) / 4 + 1) + "}";
+
+        bool streaming = request.body.find("\"stream\":true") != std::string::npos;
+        if (streaming) {
+            std::string head = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                               "Transfer-Encoding: chunked\r\nConnection: " + connection + "\r\n\r\n";
+            if (!send_all(fd, head)) return;
+
+            // Four-character tokens approximate real tokenization
+            for (size_t i = 0; i < text.size(); i += 4) {
+                std::string event = R"(data: {"choices":[{"index":0,"delta":{"content":")" +
+                                    text.substr(i, 4) + "\"}}]}\n\n";
+                if (!send_all(fd, chunk(event))) return;
+                if (options_.token_interval.count() > 0) {
+                    std::this_thread::sleep_for(options_.token_interval);
+                }
+            }
+
+            // As OpenAI does, usage comes in a chunk of its own, and only when asked for
+            std::string last = chunk(R"(data: {"choices":[{"index":0,"delta":{},"finish_reason":"stop"}]})" "\n\n");
+            if (request.body.find("\"include_usage\":true") != std::string::npos) {
+                last += chunk(R"(data: {"choices":[],)" + usage + "}\n\n");
+            }
+            if (!send_all(fd, last + chunk("data: [DONE]\n\n") + "0\r\n\r\n")) return;
+        } else {
+            std::string body = R"({"id":"mock","object":"chat.completion","choices":[{"index":0,"message":{"role":"assistant","content":")" +
+                               text + R"("},"finish_reason":"stop"}],)" + usage + "}";
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                                   std::to_string(body.size()) + "\r\nConnection: " + connection + "\r\n\r\n" + body;
+            if (!send_all(fd, response)) return;
+        }
+
+        if (!request.keep_alive) return;
+        request = Request{};
+    }
+}
+
+} // namespace neuron::bench
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace neuron::bench {
+
+struct MockOptions {
+    std::chrono::milliseconds latency{0};         // Delay before response headers (TTFB)
+    std::chrono::milliseconds token_interval{0};  // Delay between streamed chunks
+    double error_rate = 0.0;                      // Fraction of requests answered with 503
+    size_t payload_bytes = 64;                    // Length of the completion text
+    int port = 0;                                 // 0 picks a free port
+};
+
+// Minimal OpenAI-compatible /chat/completions server on 127.0.0.1. Speaks
+// HTTP/1.1 with keep-alive, answers JSON or SSE depending on "stream" in
+// the request body, and can inject latency and errors. Runs on its own
+// threads so a benchmark can drive it from the same process.
+class MockServer {
+public:
+    explicit MockServer(const MockOptions& options);
+    ~MockServer();
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    void start();  // Throws std::runtime_error if the socket cannot be bound
+    void stop();
+
+    int port() const { return port_; }
+    std::string base_url() const;
+    size_t requests() const { return requests_; }
+
+private:
+    MockOptions options_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> requests_{0};
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<std::thread> connections_;
+
+    void accept_loop();
+    void serve_connection(int fd);
+    std::string completion_text() const;
+};
+
+} // namespace neuron::bench
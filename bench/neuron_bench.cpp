@@ -0,0 +1,260 @@
+// Client-side benchmark for neuron against a local mock server.
+//
+// Measures latency percentiles, throughput and heap allocations for the
+// single-shot, streaming, batch and cache-hit paths without touching the
+// real model endpoint, so client regressions show up before a rollout.
+
+#include "alloc_counter.hpp"
+#include "mock_server.hpp"
+#include "neuron/ai_client.hpp"
+#include "neuron/batch.hpp"
+#include "neuron/config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    std::vector<double> latencies_ms;
+    size_t errors = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    double wall_seconds = 0;
+};
+
+// Counts allocations made on this thread for the lifetime of the scope
+class AllocationScope {
+public:
+    explicit AllocationScope(Sample& sample) : sample_(sample) {
+        neuron::bench::start_counting();
+    }
+    ~AllocationScope() {
+        auto count = neuron::bench::stop_counting();
+        sample_.allocations += count.allocations;
+        sample_.bytes += count.bytes;
+    }
+
+private:
+    Sample& sample_;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+void print_header() {
+    std::printf("%-12s %9s %9s %9s %9s %10s %11s %11s %7s\n",
+                "scenario", "requests", "p50 ms", "p95 ms", "p99 ms", "req/s", "allocs/req", "bytes/req", "errors");
+}
+
+void print_row(const char* name, const Sample& s, size_t requests) {
+    double rps = s.wall_seconds > 0 ? static_cast<double>(requests) / s.wall_seconds : 0;
+    double n = static_cast<double>(std::max<size_t>(requests, 1));
+    std::printf("%-12s %9zu %9.3f %9.3f %9.3f %10.1f %11.1f %11.0f %7zu\n",
+                name, requests,
+                percentile(s.latencies_ms, 50), percentile(s.latencies_ms, 95), percentile(s.latencies_ms, 99),
+                rps, static_cast<double>(s.allocations) / n, static_cast<double>(s.bytes) / n, s.errors);
+}
+
+// Sequential requests through AIClient::run
+Sample run_single(neuron::AIClient& client, size_t requests, bool streaming, const char* prefix) {
+    Sample sample;
+    neuron::TokenCallback on_token;
+    if (streaming) {
+        on_token = [](std::string_view) {};
+    }
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        std::string prompt = std::string(prefix) + std::to_string(i);
+        auto start = Clock::now();
+        std::optional<std::string> result;
+        {
+            AllocationScope scope(sample);
+            result = client.run(prompt, neuron::Mode::RUN, on_token);
+        }
+        sample.latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        // An answer without token usage would leave neuron_tokens_total behind
+        if (!result || !client.last_usage().present) ++sample.errors;
+    }
+    sample.wall_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return sample;
+}
+
+// One BatchRunner pass over `requests` items. Results are taken in
+// completion order and timed here, from when the runner asks for an item
+// (it only does with a slot free) to its result, since the runner's own
+// latency_ms is whole milliseconds and reads 0 on loopback.
+Sample run_batch(neuron::AIClient& client, size_t requests, size_t concurrency) {
+    Sample sample;
+    sample.latencies_ms.reserve(requests);
+    std::vector<std::string> input;
+    for (size_t i = 0; i < requests; ++i) {
+        input.push_back(R"({"mode":"run","prompt":"batch item )" + std::to_string(i) + "\"}");
+    }
+    std::vector<Clock::time_point> started;
+    started.reserve(requests);
+    auto next_line = [&](std::string& line) {
+        if (started.size() == requests) return false;
+        line = input[started.size()];
+        started.push_back(Clock::now());
+        return true;
+    };
+    auto emit = [&](const std::string& line) {
+        auto done = Clock::now();
+        size_t pos = line.find("\"index\":");
+        if (pos == std::string::npos) return;
+        size_t index = std::strtoul(line.c_str() + pos + 8, nullptr, 10);
+        if (index < started.size()) {
+            sample.latencies_ms.push_back(std::chrono::duration<double, std::milli>(done - started[index]).count());
+        }
+    };
+
+    neuron::BatchOptions options;
+    options.concurrency = concurrency;
+    options.ordered = false;
+    neuron::BatchRunner runner(client, options);
+
+    auto begin = Clock::now();
+    {
+        AllocationScope scope(sample);
+        sample.errors = runner.run(next_line, emit);
+    }
+    sample.wall_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return sample;
+}
+
+// Repeats one prompt that is already cached
+Sample run_cache_hits(neuron::AIClient& client, size_t requests) {
+    client.set_cache_policy(neuron::CachePolicy::USE);
+    client.run("cached prompt", neuron::Mode::RUN);
+
+    Sample sample;
+    auto begin = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        auto start = Clock::now();
+        std::optional<std::string> result;
+        {
+            AllocationScope scope(sample);
+            result = client.run("cached prompt", neuron::Mode::RUN);
+        }
+        sample.latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        if (!result || !client.last_from_cache()) ++sample.errors;
+    }
+    sample.wall_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return sample;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("neuron_bench", "Client-side benchmarks against a local mock server");
+    options.add_options()
+        ("h,help", "Print help")
+        ("n,requests", "Requests per scenario", cxxopts::value<size_t>()->default_value("200"))
+        ("c,concurrency", "In-flight limit for the batch scenario", cxxopts::value<size_t>()->default_value("16"))
+        ("latency-ms", "Mock server time to first byte", cxxopts::value<long>()->default_value("0"))
+        ("token-interval-ms", "Mock server delay between streamed chunks", cxxopts::value<long>()->default_value("0"))
+        ("error-rate", "Fraction of requests answered with 503", cxxopts::value<double>()->default_value("0"))
+        ("payload-bytes", "Completion text length", cxxopts::value<size_t>()->default_value("64"))
+        ("scenarios", "Comma-separated: single,stream,batch,cache", cxxopts::value<std::string>()->default_value("single,stream,batch,cache"))
+        ("serve", "Only run the mock server until interrupted")
+        ("port", "Mock server port (0 = any free port)", cxxopts::value<int>()->default_value("0"));
+
+    cxxopts::ParseResult args;
+    try {
+        args = options.parse(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (args.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    neuron::bench::install_curl_allocator();
+
+    neuron::bench::MockOptions mock;
+    mock.latency = std::chrono::milliseconds(args["latency-ms"].as<long>());
+    mock.token_interval = std::chrono::milliseconds(args["token-interval-ms"].as<long>());
+    mock.error_rate = args["error-rate"].as<double>();
+    mock.payload_bytes = args["payload-bytes"].as<size_t>();
+    mock.port = args["port"].as<int>();
+
+    neuron::bench::MockServer server(mock);
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (args.count("serve")) {
+        std::cout << server.base_url() << std::endl;
+        pause();
+        return 0;
+    }
+
+    // Point the client at the mock and keep the user's cache out of it
+    char cache_template[] = "/tmp/neuron-bench-XXXXXX";
+    const char* cache_root = mkdtemp(cache_template);
+    if (!cache_root) {
+        std::cerr << "Error: cannot create a temporary cache directory" << std::endl;
+        return 1;
+    }
+    setenv("XDG_CACHE_HOME", cache_root, 1);
+    setenv("NEURON_BASE_URL", server.base_url().c_str(), 1);
+    setenv("NEURON_API_KEY", "bench", 1);
+    setenv("NEURON_MODEL", "bench/mock", 1);
+    setenv("NEURON_RETRY_BASE_MS", "1", 1);
+
+    neuron::Config config;
+    neuron::AIClient client(config);
+    client.set_cache_policy(neuron::CachePolicy::DISABLED);
+
+    const size_t requests = args["requests"].as<size_t>();
+    const size_t concurrency = args["concurrency"].as<size_t>();
+    const std::string scenarios = "," + args["scenarios"].as<std::string>() + ",";
+    auto enabled = [&](const char* name) { return scenarios.find("," + std::string(name) + ",") != std::string::npos; };
+
+    std::printf("mock server %s  latency=%ldms  payload=%zuB  error-rate=%.2f\n\n",
+                server.base_url().c_str(), static_cast<long>(mock.latency.count()), mock.payload_bytes, mock.error_rate);
+    print_header();
+
+    // One untimed request so connection setup is not charged to the first sample
+    client.run("warm-up", neuron::Mode::RUN);
+
+    if (enabled("single")) {
+        print_row("single-shot", run_single(client, requests, false, "single "), requests);
+    }
+    if (enabled("stream")) {
+        print_row("streaming", run_single(client, requests, true, "stream "), requests);
+    }
+    if (enabled("batch")) {
+        print_row("batch", run_batch(client, requests, concurrency), requests);
+    }
+    if (enabled("cache")) {
+        print_row("cache-hit", run_cache_hits(client, requests), requests);
+    }
+
+    std::printf("\nmock server handled %zu requests\n", server.requests());
+
+    std::string cleanup = std::string("rm -rf '") + cache_root + "'";
+    return std::system(cleanup.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+// Cold-start benchmark for the neuron binary.
+//
+// Spawns the real executable over and over against an in-process mock
+// server and measures, per command, the time from exec to the first byte
+// on stdout and to exit. Every run gets the same fresh environment with
+// the daemon, the response cache and offline suggestions turned off, so
+// each one pays the full startup cost. A p95 above the budget fails the
+// run, which makes this usable as a CI gate.
+
+#include "mock_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxopts.hpp>
+#include <fcntl.h>
+#include <iostream>
+#include <spawn.h>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+#ifndef NEURON_BINARY
+#define NEURON_BINARY "neuron"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Scenario {
+    const char* name;
+    std::vector<std::string> args;
+    std::string input;   // Written to stdin, then closed
+    double budget_ms;    // p95 exec-to-first-byte
+};
+
+struct Sample {
+    std::vector<double> first_byte_ms;
+    std::vector<double> exit_ms;
+    size_t failures = 0;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The caller's environment with the neuron knobs replaced
+std::vector<std::string> child_environment(const std::string& base_url, const std::string& root) {
+    std::vector<std::string> env;
+    for (char** entry = environ; *entry; ++entry) {
+        if (std::strncmp(*entry, "NEURON_", 7) == 0 || std::strncmp(*entry, "XDG_", 4) == 0) continue;
+        env.emplace_back(*entry);
+    }
+    env.push_back("NEURON_BASE_URL=" + base_url);
+    env.push_back("NEURON_API_KEY=bench");
+    env.push_back("NEURON_MODEL=bench/mock");
+    env.push_back("NEURON_DAEMON=0");
+    env.push_back("NEURON_CACHE=0");
+    env.push_back("NEURON_OFFLINE_SUGGEST=0");
+    env.push_back("NEURON_HISTORY=0");
+    env.push_back("XDG_CACHE_HOME=" + root + "/cache");
+    env.push_back("XDG_DATA_HOME=" + root + "/data");
+    return env;
+}
+
+// One spawn of the binary; false if it could not start or exited non-zero
+bool run_once(const std::string& binary, const Scenario& scenario, std::vector<char*>& envp,
+              double& first_byte_ms, double& exit_ms) {
+    int out[2], in[2];
+    if (pipe2(out, O_CLOEXEC) != 0) return false;
+    if (pipe2(in, O_CLOEXEC) != 0) {
+        close(out[0]);
+        close(out[1]);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (const auto& arg : scenario.args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    auto start = Clock::now();
+    int rc = posix_spawn(&pid, binary.c_str(), &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(out[1]);
+    if (rc != 0) {
+        close(in[1]);
+        close(out[0]);
+        std::cerr << "Error: cannot run " << binary << ": " << std::strerror(rc) << std::endl;
+        return false;
+    }
+
+    // Small enough to fit the pipe buffer, so this never blocks; if it
+    // fails the child just reads end of input
+    if (!scenario.input.empty()) {
+        ssize_t written = write(in[1], scenario.input.data(), scenario.input.size());
+        (void)written;
+    }
+    close(in[1]);
+
+    first_byte_ms = -1;
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(out[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (first_byte_ms < 0) first_byte_ms = elapsed_ms(start);
+    }
+    close(out[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    exit_ms = elapsed_ms(start);
+    return first_byte_ms >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("neuron_startup_bench", "Exec-to-first-byte timings of the neuron binary");
+    options.add_options()
+        ("h,help", "Print help")
+        ("binary", "neuron executable to measure", cxxopts::value<std::string>()->default_value(NEURON_BINARY))
+        ("n,runs", "Runs per command", cxxopts::value<size_t>()->default_value("50"))
+        ("scenarios", "Comma-separated: version,run,tell", cxxopts::value<std::string>()->default_value("version,run,tell"))
+        ("budget-version-ms", "p95 budget for --version", cxxopts::value<double>()->default_value("2"))
+        ("budget-run-ms", "p95 budget for run", cxxopts::value<double>()->default_value("3"))
+        ("budget-tell-ms", "p95 budget for tell", cxxopts::value<double>()->default_value("3"))
+        ("env", "Comma-separated KEY=VALUE settings for neuron, e.g. NEURON_PRECONNECT=0",
+         cxxopts::value<std::string>()->default_value(""));
+
+    cxxopts::ParseResult args;
+    try {
+        args = options.parse(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (args.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    neuron::bench::MockServer server(neuron::bench::MockOptions{});
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    char root_template[] = "/tmp/neuron-startup-XXXXXX";
+    const char* root = mkdtemp(root_template);
+    if (!root) {
+        std::cerr << "Error: cannot create a temporary directory" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> env = child_environment(server.base_url(), root);
+    std::istringstream extra(args["env"].as<std::string>());
+    for (std::string entry; std::getline(extra, entry, ',');) {
+        if (!entry.empty()) env.push_back(entry);
+    }
+    std::vector<char*> envp;
+    for (auto& entry : env) envp.push_back(entry.data());
+    envp.push_back(nullptr);
+
+    // "n" declines the confirmation prompt, so run never executes anything
+    const std::vector<Scenario> scenarios = {
+        {"version", {"--version"}, "", args["budget-version-ms"].as<double>()},
+        {"run", {"run", "list files in current directory"}, "n\n", args["budget-run-ms"].as<double>()},
+        {"tell", {"tell", "what is git"}, "", args["budget-tell-ms"].as<double>()},
+    };
+
+    const std::string binary = args["binary"].as<std::string>();
+    const size_t runs = args["runs"].as<size_t>();
+    const std::string selected = "," + args["scenarios"].as<std::string>() + ",";
+
+    std::printf("%s  runs=%zu  mock server %s\n\n", binary.c_str(), runs, server.base_url().c_str());
+    std::printf("%-8s %14s %14s %12s %12s %10s %9s\n",
+                "command", "p50 first ms", "p95 first ms", "p50 exit ms", "p95 exit ms", "budget ms", "failures");
+
+    bool over_budget = false;
+    for (const auto& scenario : scenarios) {
+        if (selected.find("," + std::string(scenario.name) + ",") == std::string::npos) continue;
+
+        // One untimed run so the page cache holds the binary and its libraries
+        double first = 0, exit = 0;
+        run_once(binary, scenario, envp, first, exit);
+
+        Sample sample;
+        for (size_t i = 0; i < runs; ++i) {
+            if (run_once(binary, scenario, envp, first, exit)) {
+                sample.first_byte_ms.push_back(first);
+                sample.exit_ms.push_back(exit);
+            } else {
+                ++sample.failures;
+            }
+        }
+
+        double p95 = percentile(sample.first_byte_ms, 95);
+        bool over = sample.first_byte_ms.empty() || p95 > scenario.budget_ms;
+        over_budget = over_budget || over;
+        std::printf("%-8s %14.2f %14.2f %12.2f %12.2f %10.1f %9zu%s\n",
+                    scenario.name, percentile(sample.first_byte_ms, 50), p95,
+                    percentile(sample.exit_ms, 50), percentile(sample.exit_ms, 95),
+                    scenario.budget_ms, sample.failures, over ? "  OVER BUDGET" : "");
+    }
+
+    std::printf("\nmock server handled %zu requests\n", server.requests());
+
+    std::string cleanup = std::string("rm -rf '") + root + "'";
+    if (std::system(cleanup.c_str()) != 0) return 1;
+    return over_budget ? 1 : 0;
+}
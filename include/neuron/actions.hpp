@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+
+namespace neuron {
+
+// Kind of change a word of a request asks for ("delete", "stop", "install",
+// ...), or empty for words that change nothing, like "list" or "show". The
+// prompt matchers require the kinds named by two requests to agree, so
+// "show old logs" never answers "delete old logs" nor "start the
+// containers" "stop the containers". word is lowercase.
+std::string_view action_kind(std::string_view word);
+
+} // namespace neuron
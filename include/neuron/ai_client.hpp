@@ -1,8 +1,26 @@
 #pragma once
 
+#include "neuron/chat_json.hpp"
 #include "neuron/config.hpp"
+#include "neuron/hash.hpp"
+#include "neuron/rate_limit.hpp"
+#include "neuron/response_cache.hpp"
+#include "neuron/retry.hpp"
+#include "neuron/semantic_cache.hpp"
+#include "neuron/transport_cache.hpp"
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <thread>
+#include <vector>
 
 namespace neuron {
 
@@ -11,23 +29,256 @@ enum class Mode {
     TELL, // for explanation mode
 };
 
+enum class CachePolicy {
+    USE,      // Serve cache hits, store fresh responses
+    REFRESH,  // Always ask the model, but store the new response
+    DISABLED, // Neither read nor write the cache
+};
+
 struct Prompt {
-    std::string system_message;
+    std::string_view system_message;  // Points into the client, built once per OS
     std::string user_template;
 };
 
+// Receives each fragment of the response text as it streams in
+using TokenCallback = std::function<void(std::string_view token)>;
+
+struct StreamState;
+
+// A model, the chat completions URL serving it and the key sent there
+struct ModelEndpoint {
+    std::string model;
+    std::string endpoint;
+    std::string api_key;  // Empty: no Authorization header
+};
+
+class Preconnect;
+
+// Sets up libcurl's global state once; safe to call from any thread
+void init_curl();
+
+// Keeps finished easy handles and one connection, DNS and TLS session
+// cache shared by all of them, so the next request skips DNS, TCP and TLS
+// setup whichever handle or thread performs it. With a transport cache,
+// addresses and TLS sessions also carry over to the next process.
+// Transfers on one pool are expected to run one thread at a time, as the
+// client itself is.
+class HandlePool {
+public:
+    explicit HandlePool(std::unique_ptr<TransportCache> disk = nullptr);
+    ~HandlePool();
+
+    HandlePool(const HandlePool&) = delete;
+    HandlePool& operator=(const HandlePool&) = delete;
+
+    CURL* acquire();
+    void release(CURL* handle);
+
+private:
+    static constexpr size_t kMaxIdle = 16;
+
+    std::mutex mutex_;
+    std::vector<CURL*> idle_;
+    bool used_ = false;  // A handle was ever created
+    CURLSH* share_ = nullptr;
+    std::mutex share_locks_[CURL_LOCK_DATA_LAST];
+    std::unique_ptr<TransportCache> disk_;
+
+    static void lock_share(CURL* handle, curl_lock_data data, curl_lock_access access, void* pool);
+    static void unlock_share(CURL* handle, curl_lock_data data, void* pool);
+};
+
+// One chat completion from prepared curl handle to parsed result. Owns the
+// easy handle and every buffer it points at, so callers like the batch
+// runner can drive many of them concurrently through a multi handle.
+struct Exchange {
+    Mode mode = Mode::RUN;
+    Hash128 key;
+    std::string input;                  // The user's request, for the semantic index
+    bool in_conversation = false;       // Depends on earlier turns; kept out of the semantic index
+    uint64_t scope = 0;                 // Semantic cache scope (model, endpoint, OS, system prompt, context)
+    ModelEndpoint target;               // Where the request is sent
+    bool store = true;                  // Cache the answer in finish()
+    CURL* curl = nullptr;               // Null when answered from the cache
+    std::optional<std::string> cached;  // Cache hit, no transfer needed
+    std::optional<SemanticMatch> match; // Set when the hit came from a similar prompt
+    std::string error;                  // Filled in by AIClient::finish on failure
+    std::string finish_reason;          // "stop", "length", ... when reported
+    Usage usage;
+    long status = 0;
+    CURLcode result = CURLE_OK;
+
+    int attempt = 1;
+    std::chrono::steady_clock::time_point started;           // First attempt, for the overall deadline
+    std::optional<std::chrono::milliseconds> retry_after;    // Server-requested delay
+
+    std::string body;
+    std::string response;
+    curl_slist* headers = nullptr;
+    TokenCallback on_token;
+    std::unique_ptr<StreamState> stream;
+    std::shared_ptr<HandlePool> pool;   // Where curl goes back to when done
+
+    Exchange();
+    ~Exchange();
+
+    Exchange(const Exchange&) = delete;
+    Exchange& operator=(const Exchange&) = delete;
+};
+
+class PendingRequest;
+
 class AIClient {
 public:
     explicit AIClient(const Config& config);
 
-    std::optional<std::string> run(const std::string& user_input, Mode mode);
+    // Starts connecting to the configured endpoint ahead of the client
+    // being built; hand the result to set_preconnect()
+    static std::shared_ptr<Preconnect> preconnect(const Config& config);
+
+    // When on_token is set the request is sent with "stream": true and the
+    // callback sees the text incrementally; the full text is still returned.
+    // Earlier turns of a conversation go in history and are part of the
+    // cache key.
+    std::optional<std::string> run(const std::string& user_input, Mode mode,
+                                   const TokenCallback& on_token = nullptr,
+                                   std::span<const ChatMessage> history = {});
+
+    // Split form of run() for callers that perform the transfer themselves.
+    // prepare() either answers from the cache or returns a configured handle;
+    // finish() parses the result once the transfer is done and caches it.
+    std::unique_ptr<Exchange> prepare(const std::string& user_input, Mode mode,
+                                      const TokenCallback& on_token = nullptr,
+                                      std::span<const ChatMessage> history = {});
+
+    // The user message sent for input, as stored in a conversation's history
+    std::string user_message(const std::string& input, Mode mode) const;
+    std::optional<std::string> finish(Exchange& exchange, CURLcode result);
+
+    // The same request for another model or endpoint, without a cache
+    // lookup and with store unset, so racing copies leave the cache alone
+    std::unique_ptr<Exchange> prepare_for(const ModelEndpoint& target, const std::string& user_input,
+                                          Mode mode, const TokenCallback& on_token = nullptr);
+
+    // "model" or "model@base_url"; either part may be empty for the configured
+    // one. api_key is sent if given; otherwise NEURON_API_KEY is, but only to
+    // the configured server, so it never leaks to another host.
+    ModelEndpoint resolve(std::string_view spec, std::string_view api_key = {}) const;
+    const std::string& model() const { return model_; }
+
+    // Caches content as the answer to exchange's request
+    void store(const Exchange& exchange, const std::string& content);
+
+    // Reserves a send slot under NEURON_RATE_LIMIT, shared with every other
+    // process using the same key and model. Returns how long to wait before
+    // sending, or nothing with exchange.error set if the slot is further
+    // off than max_wait (default: what is left of the deadline).
+    std::optional<std::chrono::milliseconds> reserve(Exchange& exchange,
+                                                     std::optional<std::chrono::milliseconds> max_wait = std::nullopt);
+
+    // Sends a request on a background thread before its answer is needed.
+    // The client must not be used by other threads until the returned
+    // request has been collected or cancelled.
+    std::unique_ptr<PendingRequest> start(const std::string& user_input, Mode mode);
+
+    // Delay before another attempt if the failed exchange may be retried,
+    // and a fresh transfer for that attempt
+    std::optional<std::chrono::milliseconds> retry_delay(const Exchange& exchange);
+    std::unique_ptr<Exchange> retry(const Exchange& exchange);
+
+    // The first request to the preconnected endpoint takes its socket
+    void set_preconnect(std::shared_ptr<Preconnect> preconnect) { preconnect_ = std::move(preconnect); }
+
+    // Facts about the caller's working directory, added to RUN requests
+    // (see collect_directory_context); part of their cache keys too
+    void set_context(std::string context) { context_ = std::move(context); }
+
+    void set_cache_policy(CachePolicy policy) { cache_policy_ = policy; }
+    CachePolicy cache_policy() const { return cache_policy_; }
+    bool last_from_cache() const { return last_from_cache_; }
+    const std::optional<SemanticMatch>& last_match() const { return last_match_; }
+    const Usage& last_usage() const { return last_usage_; }
+    const std::string& last_finish_reason() const { return last_finish_reason_; }
+    const std::string& last_error() const { return last_error_; }
 
 private:
     std::string api_key_;
     std::string model_;
     std::string os_;
+    std::string endpoint_;
+    std::string run_system_;
+    std::string tell_system_;
+    std::string context_;
+
+    std::shared_ptr<HandlePool> handles_;
+    std::shared_ptr<Preconnect> preconnect_;
+    RetryPolicy policy_;
+    std::mt19937 rng_{std::random_device{}()};
+    std::unique_ptr<LatencyTracker> latency_;
+
+    CachePolicy cache_policy_ = CachePolicy::USE;
+    ResponseCache::Options cache_options_;
+    std::unique_ptr<ResponseCache> cache_;
+    bool cache_opened_ = false;
+    bool last_from_cache_ = false;
+    std::optional<SemanticMatch> last_match_;
+    Usage last_usage_;
+    std::string last_finish_reason_;
+    std::string last_error_;
 
+    double rate_per_minute_ = 0;  // 0: no limit
+    long rate_burst_ = 1;
+    std::map<std::string, std::unique_ptr<RateLimiter>> limiters_;  // By model
+    bool coalesce_ = true;
+
+    bool semantic_enabled_ = true;
+    float semantic_threshold_ = 0.9f;
+    std::unique_ptr<SemanticCache> semantic_;
+    bool semantic_opened_ = false;
+
+    static std::string configured_endpoint(const Config& config);
+    std::string build_system_message(Mode mode) const;
     Prompt build_prompt(const std::string& input, Mode mode) const;
+    void build_request(Exchange& exchange, const Prompt& prompt, std::span<const ChatMessage> history) const;
+    bool setup_transfer(Exchange& exchange);
+    std::unique_ptr<Exchange> clone(const Exchange& exchange);
+    bool pace(Exchange& exchange);
+    CURLcode perform(std::unique_ptr<Exchange>& exchange);
+    std::optional<std::string> complete(std::unique_ptr<Exchange> exchange,
+                                        std::optional<CURLcode> performed);
+
+    ResponseCache* cache();
+    SemanticCache* semantic();
+    Hash128 cache_key(const Prompt& prompt, Mode mode, std::span<const ChatMessage> history) const;
+
+    friend class PendingRequest;
+};
+
+// A request in flight on its own thread. get() waits for the transfer and
+// then parses, caches and if needed retries it on the calling thread;
+// cancel() abandons the transfer immediately rather than at the next
+// timeout. Destroying it cancels.
+class PendingRequest {
+public:
+    PendingRequest(AIClient& client, std::unique_ptr<Exchange> exchange);
+    ~PendingRequest();
+
+    PendingRequest(const PendingRequest&) = delete;
+    PendingRequest& operator=(const PendingRequest&) = delete;
+
+    std::optional<std::string> get();
+    void cancel();
+
+private:
+    AIClient& client_;
+    std::unique_ptr<Exchange> exchange_;
+    CURLM* multi_ = nullptr;
+    std::chrono::milliseconds wait_{0};  // For a rate limit slot before sending
+    std::atomic<bool> cancelled_{false};
+    CURLcode result_ = CURLE_OK;
+    std::thread worker_;
+
+    void transfer();
 };
 
 } // namespace neuron
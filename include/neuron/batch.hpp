@@ -0,0 +1,40 @@
+#pragma once
+
+#include "neuron/ai_client.hpp"
+#include "neuron/safety.hpp"
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace neuron {
+
+struct BatchOptions {
+    size_t concurrency = 8;   // Maximum requests in flight at once
+    bool ordered = true;      // Emit results in input order (else completion order)
+    const SafetyAnalyzer* safety = nullptr;  // Rates generated commands when set
+};
+
+// Processes a JSONL stream of {"mode": "run"|"tell", "prompt": "..."} items
+// concurrently on one curl multi handle and writes one JSON result per line.
+// Input is read lazily, so only the in-flight window is held in memory.
+class BatchRunner {
+public:
+    BatchRunner(AIClient& client, const BatchOptions& options);
+
+    // Returns the number of items that failed
+    size_t run(std::istream& in, std::ostream& out);
+
+    // The same over callbacks: next_line fills in the next input line and
+    // returns false at the end, emit gets each result line without its newline
+    using LineSource = std::function<bool(std::string& line)>;
+    using LineSink = std::function<void(const std::string& line)>;
+    size_t run(const LineSource& next_line, const LineSink& emit);
+
+private:
+    AIClient& client_;
+    BatchOptions options_;
+};
+
+} // namespace neuron
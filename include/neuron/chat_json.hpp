@@ -0,0 +1,60 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace neuron {
+
+// Hand-rolled JSON for the chat completions hot path. Requests are written
+// straight into the transfer buffer and responses are scanned for the few
+// fields neuron uses, so no document tree is built either way.
+
+// One earlier message of a conversation
+struct ChatMessage {
+    std::string_view role;  // "system", "user" or "assistant"
+    std::string_view content;
+};
+
+struct ChatRequest {
+    std::string_view model;
+    std::string_view system_message;
+    std::span<const ChatMessage> history;  // Sent between the system and user messages
+    std::string_view user_message;
+    int max_tokens = 0;
+    double temperature = 0;
+    bool stream = false;
+};
+
+// Token accounting reported by the API; present is false when omitted
+struct Usage {
+    long prompt_tokens = 0;
+    long completion_tokens = 0;
+    long total_tokens = 0;
+    bool present = false;
+};
+
+// What neuron reads from a completion body or from one streamed chunk
+struct CompletionFields {
+    std::string content;        // choices[0].message.content or .delta.content
+    std::string finish_reason;  // Empty while a stream is still going
+    Usage usage;
+    bool has_choices = false;
+
+    // Keeps the buffers' capacity so one instance can be reused per chunk
+    void clear();
+};
+
+// Appends value as a quoted, escaped JSON string
+void append_json_string(std::string& out, std::string_view value);
+
+// Replaces out with the request body, reserving its full size up front
+void write_chat_request(std::string& out, const ChatRequest& request);
+
+// Pulls choices[0] content and finish_reason plus usage out of body,
+// skipping everything else without materializing it. Content is appended
+// to out.content. Returns false if body is not well-formed JSON; fields of
+// an unexpected type read as absent.
+bool extract_completion(std::string_view body, CompletionFields& out);
+
+} // namespace neuron
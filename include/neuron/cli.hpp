@@ -2,7 +2,16 @@
 
 #include "neuron/ai_client.hpp"
 #include "neuron/config.hpp"
+#include "neuron/executor.hpp"
+#include "neuron/history.hpp"
+#include "neuron/offline_index.hpp"
+#include "neuron/race.hpp"
+#include "neuron/safety.hpp"
+#include <initializer_list>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace neuron {
 
@@ -15,14 +24,48 @@ public:
 private:
     int argc_;
     char** argv_;
+    CachePolicy cache_policy_ = CachePolicy::USE;
+    std::unique_ptr<Config> config_;    // .env and ~/.neuron_config, read once
+    std::unique_ptr<AIClient> client_;  // Created on first in-process request
+    std::shared_ptr<Preconnect> preconnect_;  // Connecting while run/tell starts up
+    bool last_from_cache_ = false;
+    bool last_from_daemon_ = false;
+    std::string trace_path_;  // --trace=FILE; empty prints a summary instead
+    std::optional<SemanticMatch> last_match_;  // Cache hit for a similar, not identical, prompt
+    std::unique_ptr<SafetyAnalyzer> safety_;   // Rules compiled on first use
+    std::unique_ptr<OfflineIndex> offline_;    // Opened on first use
+    std::unique_ptr<HistoryWriter> history_;   // Started with the first record
+    std::optional<RaceResult> last_race_;      // Set when the last RUN request was raced
+
+    int dispatch();
 
     // Helper methods
     std::string join_args(int start_index) const;
-    bool is_potentially_dangerous(const std::string& command) const;
+    bool is_flag(const std::string& arg) const;
+    bool has_flag(int start_index, std::initializer_list<std::string_view> names) const;
+    void parse_cache_flags(int start_index);
+    const Config& load_config();
+    void start_preconnect();
+    AIClient& in_process_client(const Config& config);
+    std::optional<std::string> ask(const Config& config, const std::string& prompt, Mode mode,
+                                   const TokenCallback& on_token = nullptr);
+    CachePolicy daemon_policy(const Config& config) const;
+    const SafetyAnalyzer& safety(const Config& config);
+    void print_safety_report(const SafetyReport& report) const;
+    void print_race(const RaceResult& race) const;
+    OfflineIndex* offline_index();
+    std::optional<OfflineMatch> offline_lookup(const Config& config, const std::string& prompt);
+    void record_history(const Config& config, const HistoryEntry& entry);
+    ExecResult execute(const Config& config, const std::string& command);
+    void diagnose_failure(const Config& config, const std::string& command, const ExecResult& result);
 
     // Command handlers
-    int handle_run(const std::string& command, const bool auto_execute = false);
-    int handle_tell(const std::string& command);
+    int handle_run(const std::string& command, const bool auto_execute = false, const bool offline = false);
+    int handle_tell(const std::string& command, bool read_stdin);
+    int handle_chat();
+    int handle_batch(int start_index);
+    int handle_history(int start_index);
+    int handle_daemon(const std::string& option = "");
     int handle_setup(const std::string& option = "");
 
     // Setup helper methods
@@ -13,6 +13,15 @@ public:
 
     std::optional<std::string> getNeuronApiKey() const;
     std::optional<std::string> getNeuronModel() const;
+
+    // Generic lookup for tuning knobs: environment first, then config files
+    std::optional<std::string> getValue(const std::string& key) const;
+    // The same without .env, which comes with whatever directory neuron runs
+    // in; for settings that decide where the API key is sent
+    std::optional<std::string> getTrustedValue(const std::string& key) const;
+    long getLong(const std::string& key, long fallback) const;
+    double getDouble(const std::string& key, double fallback) const;
+    bool getFlag(const std::string& key, bool fallback) const;
     
     // Setup methods
     bool setApiKey(const std::string& api_key);
@@ -27,7 +36,8 @@ private:
     static constexpr const char* NEURON_MODEL_ENV = "NEURON_MODEL";
     static constexpr const char* CONFIG_FILE = ".neuron_config";
 
-    std::unordered_map<std::string, std::string> _configMap;
+    std::unordered_map<std::string, std::string> _configMap;  // ~/.neuron_config
+    std::unordered_map<std::string, std::string> _localMap;   // .env, never saved
     
     void load();
     std::string getConfigFilePath() const;
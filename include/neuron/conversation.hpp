@@ -0,0 +1,59 @@
+#pragma once
+
+#include "neuron/chat_json.hpp"
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace neuron {
+
+// Rough token count for budgeting, about four bytes per token for English
+// text and shell commands
+size_t estimate_tokens(std::string_view text);
+
+// Message history for `neuron chat`. Every RUN and TELL turn is kept so
+// later questions can refer back to it; once the history grows past its
+// token budget the oldest turns are folded into a running summary, or
+// dropped when no summary can be made.
+class Conversation {
+public:
+    // Asks the model to condense text; nullopt when it cannot
+    using Summarizer = std::function<std::optional<std::string>(const std::string& text)>;
+
+    explicit Conversation(size_t token_budget);
+
+    void add_turn(std::string user, std::string assistant);
+    void clear();
+
+    // Brings the history back under budget. The newest turn is always kept
+    // verbatim. Returns the number of turns folded or dropped.
+    size_t fit(const Summarizer& summarize);
+
+    // Views into the history, valid until it next changes
+    std::vector<ChatMessage> messages() const;
+
+    size_t turns() const { return turns_.size(); }
+    size_t tokens() const;
+    size_t budget() const { return budget_; }
+    const std::string& summary() const { return summary_; }
+
+private:
+    struct Turn {
+        std::string user;
+        std::string assistant;
+        size_t tokens;
+    };
+
+    size_t budget_;
+    std::deque<Turn> turns_;
+    std::string summary_;  // Stands in for turns already trimmed
+    std::string summary_message_;
+    size_t turn_tokens_ = 0;
+
+    void set_summary(std::string summary);
+};
+
+} // namespace neuron
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "neuron/ai_client.hpp"
+#include "neuron/config.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace neuron {
+
+// Socket the daemon listens on: NEURON_DAEMON_SOCKET if set, otherwise
+// $XDG_RUNTIME_DIR/neuron.sock, otherwise daemon.sock in the cache directory.
+std::string daemon_socket_path(const Config& config);
+
+// How long a client waits for the daemon's answer: the request deadline
+// (NEURON_DEADLINE_MS) plus a little for the daemon's own queueing
+std::chrono::milliseconds daemon_timeout(const Config& config);
+
+struct DaemonReply {
+    std::optional<std::string> content;
+    std::string error;
+    bool cached = false;
+    std::optional<SemanticMatch> match;
+};
+
+// Client side of the daemon protocol: one JSON request line, then zero or
+// more {"token": ...} lines when streaming, then a final result line.
+class DaemonClient {
+public:
+    // timeout bounds every request, from connecting to the last line
+    explicit DaemonClient(std::string socket_path,
+                          std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+    // Returns nullopt when no daemon is listening, or it did not answer in
+    // time, so the caller can fall back to running the request in-process.
+    std::optional<DaemonReply> run(const std::string& prompt, Mode mode,
+                                   CachePolicy policy, const TokenCallback& on_token,
+                                   const std::string& context = "");
+
+    bool ping();
+    bool shutdown();
+
+    // Makes a run() in progress on another thread return nullopt right away
+    void cancel();
+
+private:
+    std::string socket_path_;
+    std::chrono::milliseconds timeout_;
+    std::mutex active_mutex_;
+    int active_fd_ = -1;     // Socket of the run() in progress
+    bool cancelled_ = false;
+
+    int connect_socket() const;
+    std::optional<std::string> simple_request(const std::string& op);
+};
+
+// Resident server. Config is parsed once at startup and every worker keeps
+// its own AIClient, whose handle pool holds connections open between calls.
+class Daemon {
+public:
+    Daemon(const Config& config, std::string socket_path);
+
+    int serve();
+
+private:
+    const Config& config_;
+    std::string socket_path_;
+    std::atomic<bool> stopping_{false};
+
+    void handle_connection(int fd, AIClient& client, CachePolicy default_policy);
+};
+
+} // namespace neuron
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "neuron/config.hpp"
+#include <chrono>
+#include <string>
+
+namespace neuron {
+
+struct ContextOptions {
+    bool enabled = false;
+    std::chrono::milliseconds budget{40};  // Wall time for one collection, all probes together
+    std::chrono::seconds ttl{600};         // Upper bound on a cached collection's age
+    std::string cache_directory;           // Empty: collect every time
+
+    // NEURON_CONTEXT, NEURON_CONTEXT_BUDGET_MS, NEURON_CONTEXT_TTL
+    static ContextOptions from_config(const Config& config);
+};
+
+// Cheap facts about the directory a RUN request is made in, so the model
+// does not have to guess at the project, the package manager or the git
+// state: a summary of the listing, git branch and uncommitted changes,
+// package managers on PATH, and the shell and project tool versions.
+// Probes that spawn a process run in parallel and are killed at the
+// budget; whatever finished by then is used, but not cached. A complete
+// result is cached per directory until the directory, git's HEAD or
+// index, PATH or SHELL change, or the TTL runs out. Returns an empty string if nothing was
+// found or collection is disabled.
+std::string collect_directory_context(const std::string& directory, const ContextOptions& options);
+
+} // namespace neuron
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace neuron {
+
+// Fixed-size byte buffer that keeps only the most recent data written to it
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity);
+
+    void append(std::string_view data);
+    std::string str() const;  // Oldest to newest
+
+    size_t size() const { return total_ < data_.size() ? total_ : data_.size(); }
+    bool overflowed() const { return total_ > data_.size(); }
+
+private:
+    std::vector<char> data_;
+    size_t head_ = 0;   // Next write position
+    size_t total_ = 0;  // Bytes ever appended
+};
+
+struct ExecOptions {
+    std::chrono::milliseconds timeout{0};  // Zero waits indefinitely
+    size_t capture_bytes = 64 * 1024;      // Tail of the output kept for follow-ups
+    bool echo = true;                      // Also pass output through to the terminal
+};
+
+struct ExecResult {
+    bool started = false;
+    std::string error;          // Why the command could not be started
+    int exit_code = -1;         // Exit status, or 128 + signal like a shell reports it
+    int signal = 0;             // Terminating signal, if any
+    bool timed_out = false;
+    std::chrono::microseconds wall{0};
+    std::chrono::microseconds user_cpu{0};
+    std::chrono::microseconds system_cpu{0};
+    long max_rss_kb = 0;        // Peak resident set; never below neuron's own, which the child shares until exec
+    std::string output_tail;    // Last capture_bytes of stdout and stderr as they arrived
+    bool truncated = false;     // Earlier output did not fit in the tail
+
+    bool succeeded() const { return started && exit_code == 0; }
+};
+
+// Runs a generated command with posix_spawn. Simple commands without shell
+// syntax are executed directly; anything else goes through /bin/sh -c.
+// Output is streamed to the terminal while the tail is captured, through
+// a pseudo-terminal when stdout is one so programs keep their colors and
+// progress output, otherwise through pipes. The command runs in a process
+// group of its own, which is given the terminal while neuron has it, so
+// Ctrl-C and Ctrl-Z from the terminal reach it directly. SIGTERM and SIGHUP
+// sent to neuron, and SIGINT/SIGQUIT sent with kill(), are forwarded to the
+// whole group, as are the signals of a timeout.
+ExecResult execute_command(const std::string& command, const ExecOptions& options);
+
+} // namespace neuron
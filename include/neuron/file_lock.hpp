@@ -0,0 +1,22 @@
+#pragma once
+
+#include <sys/file.h>
+
+namespace neuron {
+
+// Holds an flock() for the lifetime of the scope; exclusive unless asked
+// for a shared lock. Locks belong to the open file description, so threads
+// that need to exclude each other must each open their own descriptor.
+class FileLock {
+public:
+    explicit FileLock(int fd, bool shared = false) : fd_(fd) { flock(fd_, shared ? LOCK_SH : LOCK_EX); }
+    ~FileLock() { flock(fd_, LOCK_UN); }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+} // namespace neuron
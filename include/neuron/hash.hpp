@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace neuron {
+
+// 128-bit content hash used for cache and dedup keys. Two FNV-1a lanes with
+// different offset bases, each passed through a murmur3 finalizer so that
+// short, similar prompts still spread across the whole key space.
+struct Hash128 {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const Hash128&) const = default;
+};
+
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t fnv1a64(std::string_view data, uint64_t basis = 0xcbf29ce484222325ULL) {
+    uint64_t h = basis;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Incremental hasher; feed() each field in turn. Field lengths are mixed in
+// so that ("ab", "c") and ("a", "bc") produce different keys.
+class Hasher {
+public:
+    Hasher& feed(std::string_view data) {
+        uint64_t len = data.size();
+        std::string_view len_bytes(reinterpret_cast<const char*>(&len), sizeof(len));
+        hi_ = fnv1a64(data, fnv1a64(len_bytes, hi_));
+        lo_ = fnv1a64(data, fnv1a64(len_bytes, lo_));
+        return *this;
+    }
+
+    Hash128 digest() const { return {mix64(hi_), mix64(lo_ ^ hi_)}; }
+
+private:
+    uint64_t hi_ = 0xcbf29ce484222325ULL;
+    uint64_t lo_ = 0x84222325cbf29ce4ULL;
+};
+
+} // namespace neuron
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "neuron/ai_client.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace neuron {
+
+// One request as it is written to the history
+struct HistoryEntry {
+    Mode mode = Mode::RUN;
+    std::string prompt;
+    std::string response;     // Command for RUN, answer for TELL; empty if none came
+    uint32_t latency_ms = 0;  // Until the response was complete
+    bool cached = false;
+    bool offline = false;     // Answered from the offline index
+    bool daemon = false;
+    bool chat = false;        // A turn of `neuron chat`
+    bool executed = false;
+    int32_t exit_code = 0;    // Meaningful when executed
+};
+
+// One record as read back; the views point into the mapped log
+struct HistoryRecord {
+    int64_t time_us = 0;      // When the request finished, microseconds since the epoch
+    Mode mode = Mode::RUN;
+    std::string_view prompt;
+    std::string_view response;
+    uint32_t latency_ms = 0;
+    bool cached = false;
+    bool offline = false;
+    bool daemon = false;
+    bool chat = false;
+    bool executed = false;
+    int32_t exit_code = 0;
+};
+
+// Usage history in history.log under the data directory: an append-only
+// sequence of binary records, each a fixed header (magic, length, time,
+// latency, exit code, flags, checksum) followed by the prompt and response,
+// padded to 8 bytes. Writers append whole records with one write() under
+// an flock(), so parallel invocations never interleave; readers skip any
+// record whose checksum does not match and resynchronize on the magic.
+
+// Queues entries and writes them from a background thread, so recording
+// never waits on the disk. Whatever is still queued is written when the
+// writer is destroyed.
+class HistoryWriter {
+public:
+    explicit HistoryWriter(std::string path);
+    ~HistoryWriter();
+
+    HistoryWriter(const HistoryWriter&) = delete;
+    HistoryWriter& operator=(const HistoryWriter&) = delete;
+
+    void append(const HistoryEntry& entry);
+
+private:
+    std::string path_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::string queued_;  // Encoded records not yet written
+    bool stopping_ = false;
+    std::thread worker_;  // Started with the first entry
+
+    void drain();
+};
+
+// Memory-mapped view of the history log as it was when opened
+class HistoryReader {
+public:
+    // A missing log reads as empty; throws std::runtime_error if it cannot be mapped
+    explicit HistoryReader(const std::string& path);
+    ~HistoryReader();
+
+    HistoryReader(const HistoryReader&) = delete;
+    HistoryReader& operator=(const HistoryReader&) = delete;
+
+    // Visits every intact record from time since_us on, oldest first, until
+    // visit returns false. Records are in time order but for the few
+    // milliseconds parallel writers can race, so the start is found by
+    // binary search with a minute of slack and then filtered exactly.
+    void scan(int64_t since_us, const std::function<bool(const HistoryRecord&)>& visit) const;
+
+    size_t bytes() const { return size_; }
+
+private:
+    const char* map_ = nullptr;
+    size_t size_ = 0;
+
+    // Offset of the first intact record at or after offset, or size_
+    size_t next_record(size_t offset, HistoryRecord* record) const;
+};
+
+std::string history_path(const std::string& data_directory);
+
+} // namespace neuron
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "neuron/ai_client.hpp"
+#include "neuron/config.hpp"
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <string>
+
+namespace neuron {
+
+struct IngestOptions {
+    size_t chunk_tokens = 3000;  // Input per request, and notes kept before they are merged
+    size_t concurrency = 4;      // Parts in flight at once
+
+    // NEURON_STDIN_CHUNK_TOKENS, NEURON_STDIN_CONCURRENCY
+    static IngestOptions from_config(const Config& config);
+};
+
+struct Chunk {
+    std::string text;
+    size_t first_line = 0;  // 1-based
+    size_t last_line = 0;
+};
+
+// Cuts a stream into pieces of at most max_bytes, ending on a line break
+// unless a single line is longer than that. Holds one piece at a time.
+class ChunkReader {
+public:
+    ChunkReader(std::istream& in, size_t max_bytes);
+
+    std::optional<Chunk> next();
+    bool done() const { return eof_ && buffer_.empty(); }
+    size_t bytes_read() const { return bytes_read_; }
+
+private:
+    std::istream& in_;
+    size_t max_bytes_;
+    std::string buffer_;
+    size_t line_ = 1;
+    size_t bytes_read_ = 0;
+    bool eof_ = false;
+};
+
+// Answers a TELL question about input too large for one request. Every
+// part is sent with the question on its own request, at most concurrency
+// at a time, asking only for what in it bears on the question. The notes
+// come back in input order; whenever they outgrow a chunk, the parts in
+// flight are finished and the notes merged into one before more are sent,
+// so memory does not grow with the input. If a merge fails the oldest notes
+// are dropped instead. A last request answers the question from the notes,
+// streaming to on_token.
+class IngestRunner {
+public:
+    IngestRunner(AIClient& client, const IngestOptions& options);
+
+    // first is the part already taken from reader
+    std::optional<std::string> run(const std::string& question, Chunk first, ChunkReader& reader,
+                                   const TokenCallback& on_token);
+
+    size_t parts() const { return parts_; }
+    size_t failed() const { return failed_; }
+    size_t merges() const { return merges_; }
+    size_t dropped() const { return dropped_; }  // Notes dropped when a merge failed
+
+private:
+    AIClient& client_;
+    IngestOptions options_;
+    size_t parts_ = 0;
+    size_t failed_ = 0;
+    size_t merges_ = 0;
+    size_t dropped_ = 0;
+};
+
+// The single request for input that fits in one part
+std::string stdin_question(const std::string& question, const std::string& input);
+
+} // namespace neuron
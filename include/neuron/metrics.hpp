@@ -0,0 +1,86 @@
+#pragma once
+
+#include "neuron/config.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace neuron {
+
+struct MetricsOptions {
+    std::string textfile;     // Empty: metrics are off
+    std::string state_path;   // Totals shared by every process; empty keeps only this one's
+    std::string listen;       // host:port the daemon serves /metrics on, empty for none; ":port" is loopback
+
+    // NEURON_METRICS, NEURON_METRICS_FILE, NEURON_METRICS_LISTEN
+    static MetricsOptions from_config(const Config& config);
+};
+
+// Request counters and latency histograms for Prometheus. Disabled by
+// default, in which case recording costs one relaxed atomic load. Each
+// process keeps what it recorded since the last flush(); flush() adds that
+// to totals in a file shared by every neuron process, under a lock, and
+// rewrites the textfile for node_exporter's textfile collector from the
+// totals. Both are replaced with a rename, so readers never see half a file.
+class Metrics {
+public:
+    using Labels = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+    // Log-linear buckets in the manner of HDR histograms: four per power of
+    // two from 256us to 134s, so any bucket is within 25% of its neighbour,
+    // plus one for everything faster. Slower values only reach +Inf.
+    static constexpr int kSubBuckets = 4;
+    static constexpr int kFirstExponent = 8;
+    static constexpr int kLastExponent = 26;
+    static constexpr size_t kBuckets = 1 + (kLastExponent - kFirstExponent + 1) * kSubBuckets;
+
+    static Metrics& global();
+
+    void enable(const MetricsOptions& options);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // name is the full sample name, ending in _total
+    void count(std::string_view name, Labels labels, double value = 1);
+    // name is the family name, ending in _seconds
+    void observe(std::string_view name, Labels labels, std::chrono::microseconds duration);
+
+    // Merges into the shared totals and rewrites the textfile
+    bool flush();
+
+    // Text exposition of the totals, after a flush
+    std::string exposition();
+
+    // Upper bound of bucket i, in microseconds
+    static int64_t bucket_bound(size_t i);
+    // Bucket a duration falls in; kBuckets if above the last bound
+    static size_t bucket_for(int64_t microseconds);
+
+private:
+    struct Histogram {
+        std::array<uint64_t, kBuckets + 1> counts{};  // Last one: above every bound
+        double sum = 0;                              // Seconds
+    };
+    struct Snapshot {
+        std::map<std::string, double> counters;        // Keyed by series, "name{labels}"
+        std::map<std::string, Histogram> histograms;
+    };
+
+    std::atomic<bool> enabled_{false};
+    MetricsOptions options_;
+    std::mutex mutex_;
+    Snapshot pending_;    // Since the last flush
+    Snapshot totals_;     // Everything flushed, when there is no shared file
+
+    // Adds pending_ to the totals and rewrites the textfile from them
+    bool merge(Snapshot& totals);
+    static std::string render(const Snapshot& totals);
+};
+
+} // namespace neuron
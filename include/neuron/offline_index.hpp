@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace neuron {
+
+struct OfflineMatch {
+    std::string prompt;   // Indexed prompt that matched
+    std::string command;
+    float similarity = 0;
+};
+
+// Local prompt -> command lookup that needs no network.
+//
+// Entries come from a seed set of common one-liners compiled into neuron
+// and from accepted.log in the data directory, where commands that ran
+// successfully are appended. Both are built into offline.idx in the cache
+// directory: prompts are normalized (case, punctuation, filler words) and
+// split into character trigrams, and the file holds a sorted trigram table
+// with posting lists plus each entry's own trigrams. It is memory-mapped
+// read-only and rebuilt, then atomically renamed into place, when the seed
+// set changed or more than a few hundred commands were logged since; until
+// then those are held in memory and scanned after the index.
+//
+// A lookup only reads the rarest posting lists that could still lead to a
+// match at the requested Dice similarity, bounds every candidate from its
+// hit count and verifies the best ones exactly, so it stays in the
+// microseconds on indexes of hundreds of thousands of entries. Numbers,
+// paths, globs and flags in the prompt must match exactly, as must the kind
+// of action asked for ("delete", "stop", ...), as in the semantic cache.
+class OfflineIndex {
+public:
+    // Throws std::runtime_error if the index cannot be built or opened
+    OfflineIndex(const std::string& cache_directory, const std::string& data_directory);
+    ~OfflineIndex();
+
+    OfflineIndex(const OfflineIndex&) = delete;
+    OfflineIndex& operator=(const OfflineIndex&) = delete;
+
+    std::optional<OfflineMatch> lookup(std::string_view prompt, float threshold) const;
+
+    // Appends an accepted command to the log, rebuilding the index when
+    // enough have been logged since it was built. Throws std::runtime_error
+    // if the rebuilt index cannot be written.
+    void add(std::string_view prompt, std::string_view command);
+
+    size_t size() const;
+
+private:
+    struct Header;
+    struct Gram;
+    struct Entry;
+    struct Delta;
+
+    std::string index_path_;
+    std::string log_path_;
+    const char* map_ = nullptr;
+    size_t map_size_ = 0;
+    std::vector<Delta> delta_;   // Logged after the index was built
+    uint64_t delta_end_ = 0;     // Log bytes read so far
+
+    const Header* header() const;
+    bool open_current();
+    // Loads the log lines past delta_end_ into delta_
+    void read_delta();
+    // Best match in the mapped index above best_similarity, which it raises
+    bool search(const std::vector<uint32_t>& query, uint64_t anchors, float& best_similarity,
+                OfflineMatch& match) const;
+    void rebuild();
+};
+
+} // namespace neuron
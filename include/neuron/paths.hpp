@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace neuron {
+
+// Per-user cache directory ($XDG_CACHE_HOME/neuron or ~/.cache/neuron),
+// created on first use. Returns an empty string if it cannot be created.
+std::string cache_dir();
+
+// Per-user data directory ($XDG_DATA_HOME/neuron or ~/.local/share/neuron)
+// for what cannot be regenerated, created on first use. Empty on failure.
+std::string data_dir();
+
+// Creates a directory and any missing parents
+bool make_dirs(const std::string& path);
+
+} // namespace neuron
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace neuron {
+
+// Opens the TCP connection for a process's first request while the rest
+// of startup (config, client setup, prompt and cache key) is still
+// running. A background thread sets up libcurl, resolves the endpoint's
+// host (or takes the address saved in dns_directory) and connects; the
+// first transfer to that endpoint takes the connected socket instead of
+// opening its own, waiting for the thread if it is not done yet. TLS and
+// the request itself then go out on it. libcurl never reuses a
+// CONNECT_ONLY connection, hence the bare socket.
+class Preconnect {
+public:
+    // Does nothing for a loopback host, which connects in microseconds
+    // anyway, or when a proxy is configured
+    Preconnect(std::string url, std::chrono::milliseconds timeout, std::string dns_directory = "");
+    ~Preconnect();  // Stops connecting and closes a socket nobody took
+
+    Preconnect(const Preconnect&) = delete;
+    Preconnect& operator=(const Preconnect&) = delete;
+
+    const std::string& url() const { return url_; }
+
+    // Lets handle's next connection use the socket, until one has
+    void attach(CURL* handle);
+
+private:
+    std::string url_;
+    std::string host_;
+    std::string port_;
+    std::thread worker_;
+    std::atomic<bool> cancelled_{false};
+
+    // Written by the worker, read only once it has been joined
+    int fd_ = -1;
+    int family_ = 0;
+
+    std::mutex mutex_;
+    int handed_ = -1;   // Given to libcurl, not yet marked connected
+    bool taken_ = false;
+
+    void connect(std::chrono::milliseconds timeout, const std::string& dns_directory);
+    int take(int family);
+
+    static curl_socket_t open_socket(void* self, curlsocktype purpose, curl_sockaddr* address);
+    static int socket_options(void* self, curl_socket_t fd, curlsocktype purpose);
+};
+
+} // namespace neuron
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace neuron {
+
+// A prompt whose whitespace was normalized at compile time; see minify_prompt
+template <size_t N>
+struct PromptText {
+    char data[N]{};
+    size_t size = 0;
+
+    constexpr std::string_view view() const { return {data, size}; }
+};
+
+constexpr bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Strips the indentation and trailing blanks of every line, folds runs of
+// blanks into one space and drops empty lines, so a template can be indented
+// with the surrounding code without the model being sent (and billed for)
+// the indentation. Runs in the compiler: the binary only holds the result.
+template <size_t N>
+consteval PromptText<N> minify_prompt(const char (&text)[N]) {
+    PromptText<N> out;
+    bool line_start = true;
+    bool pending_space = false;
+    for (size_t i = 0; i + 1 < N; ++i) {
+        char c = text[i];
+        if (c == '\n') {
+            if (!line_start) out.data[out.size++] = '\n';
+            line_start = true;
+            pending_space = false;
+        } else if (is_blank(c)) {
+            pending_space = !line_start;
+        } else {
+            if (pending_space) out.data[out.size++] = ' ';
+            out.data[out.size++] = c;
+            line_start = false;
+            pending_space = false;
+        }
+    }
+    if (out.size > 0 && out.data[out.size - 1] == '\n') --out.size;
+    return out;
+}
+
+// The template with every occurrence of placeholder replaced by value
+inline std::string fill_prompt(std::string_view text, std::string_view placeholder, std::string_view value) {
+    std::string filled;
+    filled.reserve(text.size() + value.size());
+    size_t from = 0;
+    for (size_t at; (at = text.find(placeholder, from)) != std::string_view::npos; from = at + placeholder.size()) {
+        filled.append(text.substr(from, at - from)).append(value);
+    }
+    filled.append(text.substr(from));
+    return filled;
+}
+
+} // namespace neuron
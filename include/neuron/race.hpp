@@ -0,0 +1,72 @@
+#pragma once
+
+#include "neuron/ai_client.hpp"
+#include "neuron/config.hpp"
+#include "neuron/safety.hpp"
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace neuron {
+
+enum class RaceStrategy {
+    FIRST, // The first valid answer wins; the rest are abandoned
+    RANK,  // Wait for every answer up to the deadline, then pick the best
+};
+
+struct RaceOptions {
+    std::vector<std::string> models;  // "model" or "model@base_url", raced against the configured model
+    std::vector<std::string> keys;    // API key for each of models, empty for the default
+    size_t candidates = 1;            // Requests per model
+    RaceStrategy strategy = RaceStrategy::FIRST;
+    std::chrono::milliseconds deadline{3000};  // RANK: answers later than this are not waited for
+    const SafetyAnalyzer* safety = nullptr;    // Used by RANK when set
+
+    // NEURON_RACE_MODELS, NEURON_RACE_KEY_<n>, NEURON_RACE_CANDIDATES, NEURON_RACE_STRATEGY,
+    // NEURON_RACE_DEADLINE_MS
+    static RaceOptions from_config(const Config& config);
+
+    bool enabled() const { return !models.empty() || candidates > 1; }
+};
+
+struct RaceCandidate {
+    std::string model;
+    std::optional<std::string> command;  // Empty if the request failed or was abandoned
+    std::string error;
+    std::chrono::milliseconds latency{0};
+    Severity severity = Severity::NONE;
+    double agreement = 0;  // Summed similarity to the other answers
+    size_t agreeing = 1;   // Answers that are essentially the same command, this one included
+};
+
+struct RaceResult {
+    std::optional<std::string> command;
+    std::optional<size_t> winner;          // Index into candidates
+    std::vector<RaceCandidate> candidates; // Empty when answered from the cache
+    bool cached = false;
+    std::optional<SemanticMatch> match;
+    std::string error;                     // Set when no candidate succeeded
+};
+
+// Sends one RUN request to several models, or several times to one, as
+// concurrent transfers on a single multi handle. Under FIRST, streamed
+// tokens pass through from whichever transfer produces text first, as
+// with hedging. Under RANK, nothing streams; answers are ranked by the
+// safety analyzer first and agreement with the others second. Either way
+// the chosen command is cached as the configured model's answer.
+class RaceRunner {
+public:
+    RaceRunner(AIClient& client, const RaceOptions& options);
+
+    RaceResult run(const std::string& prompt, const TokenCallback& on_token = nullptr);
+
+private:
+    AIClient& client_;
+    RaceOptions options_;
+
+    void rank(RaceResult& result) const;
+};
+
+} // namespace neuron
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace neuron {
+
+// Request rate limit shared by every neuron process using one API key and
+// model. The bucket is a single "theoretical arrival time" (GCRA) kept in
+// a memory-mapped file and advanced with compare-and-swap, so processes
+// coordinate without locks or syscalls once it is mapped. Each caller
+// reserves the next free slot and sleeps until it comes round, which
+// queues requests in the order they asked instead of letting them race
+// into 429s; a slot given up after reserving is simply left unused.
+class RateLimiter {
+public:
+    // per_minute requests on average with up to burst sent back to back
+    RateLimiter(const std::string& path, double per_minute, long burst);
+    ~RateLimiter();
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Reserves the next slot and returns how long to wait for it, or
+    // nothing, without reserving, if that would be longer than max_wait
+    std::optional<std::chrono::milliseconds> reserve(std::chrono::milliseconds max_wait);
+
+    // Keeps every process from sending for delay, as after a 429
+    void hold_off(std::chrono::milliseconds delay);
+
+    static std::string path_for(const std::string& api_key, const std::string& model);
+
+private:
+    int64_t* tat_ = nullptr;  // Mapped; nanoseconds since the epoch
+    int64_t interval_ns_;
+    int64_t burst_ns_;        // How far the arrival time may run ahead of now
+    int64_t local_tat_ = 0;   // Used when the file cannot be mapped
+};
+
+} // namespace neuron
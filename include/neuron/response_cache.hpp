@@ -0,0 +1,64 @@
+#pragma once
+
+#include "neuron/hash.hpp"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace neuron {
+
+// Persistent response cache shared by all neuron processes of a user.
+//
+// Layout under the cache directory:
+//   responses.idx  fixed-size open-addressing table, memory-mapped
+//   responses.dat  append-only log of response bodies
+//
+// Every operation holds an flock() on the index, so parallel invocations
+// see a consistent table. Entries expire after the TTL and the least
+// recently used ones are evicted once the live data exceeds max_bytes.
+// The data log is compacted when more than half of it is dead.
+class ResponseCache {
+public:
+    struct Options {
+        std::string directory;
+        std::chrono::seconds ttl{7 * 24 * 3600};
+        uint64_t max_bytes = 16 * 1024 * 1024;
+    };
+
+    // Throws std::runtime_error if the cache files cannot be opened
+    explicit ResponseCache(const Options& options);
+    ~ResponseCache();
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    std::optional<std::string> get(const Hash128& key);
+    void put(const Hash128& key, std::string_view value);
+
+private:
+    struct Header;
+    struct Slot;
+
+    Options options_;
+    std::string data_path_;
+    int index_fd_ = -1;
+    int data_fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    uint64_t generation_ = 0;
+
+    Header* header() const;
+    Slot* slots() const;
+
+    void init_index();
+    bool reopen_data_if_stale();
+    Slot* find(const Hash128& key) const;
+    void erase(Slot* slot);
+    void evict_until(uint64_t bytes, uint32_t count);
+    void compact();
+    static int64_t now();
+};
+
+} // namespace neuron
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "neuron/config.hpp"
+#include <chrono>
+#include <curl/curl.h>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace neuron {
+
+// How hard a single request tries before giving up. All knobs come from
+// NEURON_* settings so they can be tuned per machine without a rebuild.
+struct RetryPolicy {
+    int max_attempts = 3;
+    std::chrono::milliseconds base_delay{250};
+    std::chrono::milliseconds max_delay{4000};
+    std::chrono::milliseconds connect_timeout{3000};   // DNS + TCP + TLS, per attempt
+    std::chrono::milliseconds attempt_timeout{10000};  // Whole transfer, per attempt
+    std::chrono::milliseconds deadline{30000};         // Across all attempts and backoff
+
+    // Hedging: duplicate a request whose first byte is later than the
+    // observed p95 time-to-first-byte, then keep whichever answers first
+    bool hedge = false;
+    std::chrono::milliseconds min_hedge_delay{300};
+
+    static RetryPolicy from_config(const Config& config);
+
+    // Exponential backoff with full jitter for the given retry (1 = first retry)
+    std::chrono::milliseconds backoff(int retry, std::mt19937& rng) const;
+};
+
+// Transport failures and HTTP statuses worth another attempt
+bool is_retryable(CURLcode result, long status);
+
+// Parses a Retry-After value: delta-seconds or an HTTP-date
+std::optional<std::chrono::milliseconds> parse_retry_after(std::string_view value);
+
+// Rolling window of recent time-to-first-byte samples for one model,
+// persisted next to the response cache so short-lived processes share it.
+class LatencyTracker {
+public:
+    explicit LatencyTracker(const std::string& model);
+
+    void record(std::chrono::milliseconds ttfb);
+
+    // Nothing until enough samples exist for the percentile to mean something
+    std::optional<std::chrono::milliseconds> p95();
+
+private:
+    static constexpr size_t kWindow = 256;
+    static constexpr size_t kMinSamples = 20;
+
+    std::string path_;
+    std::vector<uint32_t> samples_;
+    bool loaded_ = false;
+
+    void load();
+};
+
+} // namespace neuron
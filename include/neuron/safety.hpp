@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace neuron {
+
+enum class Severity {
+    NONE,
+    LOW,      // Worth a note, runs without asking under --yes
+    MEDIUM,   // Hard to undo or privileged; always asks first
+    HIGH,     // Deletes data or changes the system
+    CRITICAL, // Can wipe a disk or the whole system
+};
+
+const char* severity_name(Severity severity);
+
+// One simple command from a shell line, after quote removal
+struct ShellCommand {
+    std::vector<std::string> words;        // Program first; sudo, env, nohup and similar wrappers removed
+    std::vector<std::string> redirects;    // Targets of output redirections
+    bool privileged = false;               // Runs under sudo or doas
+    std::string pipes_to;                  // Program reading this command's output, if piped
+    std::vector<std::string> substituted;  // Programs run by $(...), `...` or <(...) in its words
+};
+
+// Splits a command line into simple commands. Command substitutions,
+// sh -c and eval strings, find -exec and xargs are parsed as commands of
+// their own, so nothing hides behind quoting or nesting.
+std::vector<ShellCommand> parse_shell(std::string_view text);
+
+struct SafetyRule {
+    std::string id;
+    Severity severity = Severity::NONE;
+    std::string message;
+
+    // Every listed condition must hold; alternatives within one may use * and ? wildcards
+    std::vector<std::string> programs;
+    std::vector<std::vector<std::string>> flags;  // Each group needs one of its flags
+    std::vector<std::vector<std::string>> args;   // Each group needs one matching argument
+    std::vector<std::string> sources;             // Any operand but the last, as mv's
+    std::vector<std::string> destinations;        // The last operand, as rsync's
+    std::vector<std::string> redirects;
+    std::vector<std::string> pipes_to;
+    std::vector<std::string> substituted;         // Programs run by a substitution in the command
+    std::vector<std::string> texts;               // Literal anywhere in the line, quotes ignored
+    bool privileged = false;
+};
+
+struct SafetyFinding {
+    std::string_view id;
+    Severity severity;
+    std::string_view message;
+};
+
+struct SafetyReport {
+    Severity severity = Severity::NONE;
+    std::vector<SafetyFinding> findings;  // Most severe first
+
+    bool needs_confirmation() const { return severity >= Severity::MEDIUM; }
+};
+
+// Rule-based vetting of generated commands. Rules are compiled once: the
+// literal each rule keys on (usually the program name) goes into one
+// Aho-Corasick automaton, so a single pass over the text tells which rules
+// can apply at all and most commands are cleared without being parsed.
+// Those that are parsed are checked structurally, which keeps "format"
+// inside "information" or "> /dev/null" from raising alarms.
+class SafetyAnalyzer {
+public:
+    // Built-in rules, then any in rules_path. A rule file line is
+    //   <severity> <id> <condition>... [-- message]
+    // with conditions cmd=, flag=, arg=, redirect=, pipe-to=, subst=, text=
+    // (comma separated alternatives) and sudo. arg= skips options unless
+    // the alternative itself starts with '-'. A line reusing a built-in id
+    // replaces that rule; severity "off" removes it.
+    explicit SafetyAnalyzer(const std::string& rules_path = "");
+
+    SafetyReport analyze(std::string_view command) const;
+
+    size_t rule_count() const { return rules_.size(); }
+
+private:
+    std::vector<SafetyRule> rules_;
+
+    // Prefilter automaton over case-folded, quote-stripped text. Bytes are
+    // mapped to classes so the transition table stays small.
+    std::array<uint8_t, 256> classes_{};
+    size_t class_count_ = 1;
+    std::vector<int32_t> next_;                  // state * class_count_ + class
+    std::vector<std::vector<uint32_t>> outputs_; // Rules keyed on literals ending in each state
+    std::vector<uint32_t> unkeyed_;              // Rules without a literal to key on
+
+    void load(std::string_view text, std::string_view origin);
+    void compile();
+};
+
+} // namespace neuron
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "neuron/hash.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace neuron {
+
+// Cached RUN prompt that is close enough to the one being asked
+struct SemanticMatch {
+    Hash128 key;         // Response cache key of the matched prompt
+    std::string prompt;  // The earlier prompt, possibly truncated, for display
+    float similarity = 0;
+};
+
+// Fixed-size feature vector of a prompt. Words are normalized (case,
+// plurals, a few synonyms, filler words), then words and word pairs are
+// hashed into kDims signed buckets and the vector is scaled to unit length,
+// so cosine similarity is a plain dot product.
+struct PromptVector {
+    static constexpr size_t kDims = 256;
+
+    alignas(32) std::array<float, kDims> values{};
+    uint64_t anchors = 0;  // Hash of tokens that must match exactly
+    bool empty = true;
+
+    static PromptVector from(std::string_view prompt);
+};
+
+float dot(const float* a, const float* b);
+
+// Near-duplicate lookup for RUN prompts, stored next to the response cache.
+//
+// semantic.idx holds a header, a ring of kCapacity vectors and their
+// metadata, memory-mapped and scanned linearly. Only the response cache key
+// is stored; the command itself is read back from ResponseCache, so expiry
+// and eviction follow the exact-match cache. Entries only match within the
+// same scope (model, endpoint, OS, system prompt) and when their anchors
+// agree: numbers, paths, flags, extensions, negations, the kinds of action
+// named and the set of normalized words, so "delete *.log" never answers
+// "delete *.txt" nor "list *.log", and "sort by size" never "sort by date".
+// What is left to the similarity is mostly word order. Lookups take a
+// shared flock(), inserts an exclusive one.
+class SemanticCache {
+public:
+    // Throws std::runtime_error if the index cannot be opened
+    explicit SemanticCache(const std::string& directory);
+    ~SemanticCache();
+
+    SemanticCache(const SemanticCache&) = delete;
+    SemanticCache& operator=(const SemanticCache&) = delete;
+
+    std::optional<SemanticMatch> lookup(uint64_t scope, std::string_view prompt, float threshold);
+    void insert(uint64_t scope, std::string_view prompt, const Hash128& key);
+
+private:
+    struct Header;
+    struct Entry;
+
+    static constexpr uint32_t kCapacity = 2048;
+
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+
+    Header* header() const;
+    float* vectors() const;
+    Entry* entries() const;
+
+    // Best entry in scope with matching anchors, or -1
+    long best(uint64_t scope, const PromptVector& query, float& similarity) const;
+};
+
+} // namespace neuron
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "neuron/hash.hpp"
+#include <chrono>
+#include <string>
+
+namespace neuron {
+
+// Coalesces identical requests made at the same time by different
+// processes (or daemon workers). The first to ask for a key takes an
+// flock() on a lock file named after it and sends the request; everyone
+// else waits for that lock and then finds the answer in the response
+// cache. A leader that dies releases the lock with its last descriptor,
+// so the next waiter takes over and sends the request itself.
+class SingleFlight {
+public:
+    // Returns at once when no other process is sending key; otherwise
+    // waits until the leader finishes or fails, or until timeout
+    SingleFlight(const std::string& directory, const Hash128& key, std::chrono::milliseconds timeout);
+    ~SingleFlight();
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    // Another process was already sending this request when we arrived
+    bool waited() const { return waited_; }
+
+    // This process now holds the flight; false after a timeout
+    bool leader() const { return fd_ >= 0; }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    bool waited_ = false;
+};
+
+} // namespace neuron
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace neuron {
+
+// Incremental parser for text/event-stream bodies. Bytes can be fed in
+// arbitrary chunks as they come off the wire; the callback fires once per
+// complete event with the joined contents of its "data:" lines.
+class SseParser {
+public:
+    using EventCallback = std::function<void(std::string_view data)>;
+
+    explicit SseParser(EventCallback on_event);
+
+    void feed(const char* data, size_t size);
+    void finish(); // Flush a trailing event that was not terminated by a blank line
+
+private:
+    EventCallback on_event_;
+    std::string line_;
+    std::string data_;
+    bool has_data_ = false;
+    bool skip_lf_ = false;
+
+    void process_line();
+    void dispatch();
+};
+
+} // namespace neuron
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace neuron {
+
+// Phase timing for --trace. Disabled by default, in which case recording a
+// span costs one relaxed atomic load. Spans are kept in memory and either
+// summarized per phase or written as Chrome trace-event JSON, which
+// chrome://tracing and ui.perfetto.dev open directly.
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Tracer& global();
+
+    void enable();
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void add(std::string_view name, std::string_view category, Clock::time_point start,
+             Clock::time_point end, std::string detail = {});
+
+    // Breaks a finished transfer into DNS, connect, TLS, wait and download
+    // spans using curl's own timers, ending now
+    void add_transfer(CURL* curl, int attempt);
+
+    // A value shown under the summary, or as trace metadata; the last one
+    // set under a name wins
+    void note(std::string_view name, std::string value);
+
+    void print_summary(std::ostream& out) const;
+    bool write_chrome_trace(const std::string& path) const;
+
+private:
+    struct Span {
+        std::string name;
+        std::string category;
+        int64_t start_us;
+        int64_t duration_us;
+        int thread;
+        std::string detail;
+    };
+
+    std::atomic<bool> enabled_{false};
+    Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<Span> spans_;
+    std::vector<std::pair<std::string, std::string>> notes_;
+
+    int64_t since_origin(Clock::time_point t) const;
+};
+
+// Records the enclosing scope as one span when tracing is on
+class TraceSpan {
+public:
+    TraceSpan(std::string_view name, std::string_view category);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void set_detail(std::string detail) { detail_ = std::move(detail); }
+
+private:
+    std::string_view name_;
+    std::string_view category_;
+    std::string detail_;
+    Tracer::Clock::time_point start_;
+    bool active_;
+};
+
+} // namespace neuron
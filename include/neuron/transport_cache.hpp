@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+#include <map>
+#include <string>
+
+namespace neuron {
+
+// What one process learns about reaching the endpoint that the next one
+// can reuse, kept in the cache directory:
+//   dns.txt       resolved address per host:port, handed to later processes
+//                 through CURLOPT_RESOLVE until the TTL runs out
+//   tls.sessions  TLS session tickets exported from the share (libcurl
+//                 8.12 or newer), imported so the next handshake resumes
+//   altsvc.txt    libcurl's own Alt-Svc cache
+// A missing or unreadable file only means a cold start.
+class TransportCache {
+public:
+    TransportCache(std::string directory, std::chrono::seconds dns_ttl);
+    ~TransportCache();
+
+    TransportCache(const TransportCache&) = delete;
+    TransportCache& operator=(const TransportCache&) = delete;
+
+    // Options for a handle about to be used; the first call also imports
+    // the saved sessions into the share the handle is attached to
+    void apply(CURL* handle);
+
+    // Notes the address a finished transfer connected to, or forgets the
+    // saved one if it could not connect
+    void observe(CURL* handle);
+
+    // Writes what changed; the handle must be attached to the share
+    void save(CURL* handle);
+
+    // The unexpired address saved for "host:port" in directory, or empty
+    static std::string saved_address(const std::string& directory, const std::string& host_port);
+
+private:
+    struct Address {
+        std::string ip;
+        int64_t expires = 0;  // Seconds since the epoch
+    };
+
+    std::string directory_;
+    std::chrono::seconds dns_ttl_;
+    std::map<std::string, Address> addresses_;  // By "host:port"
+    curl_slist* resolve_ = nullptr;
+    std::string altsvc_path_;
+    bool sessions_imported_ = false;
+    bool dirty_ = false;
+
+    void load_addresses();
+    void save_addresses() const;
+    void import_sessions(CURL* handle);
+    void export_sessions(CURL* handle) const;
+};
+
+} // namespace neuron
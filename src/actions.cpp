@@ -0,0 +1,41 @@
+#include "neuron/actions.hpp"
+
+#include <unordered_map>
+
+namespace neuron {
+
+std::string_view action_kind(std::string_view word) {
+    static const std::unordered_map<std::string_view, std::string_view> words = {
+        {"delete", "delete"}, {"remove", "delete"}, {"erase", "delete"}, {"rm", "delete"},
+        {"rmdir", "delete"}, {"del", "delete"}, {"unlink", "delete"}, {"purge", "delete"},
+        {"wipe", "delete"}, {"shred", "delete"}, {"destroy", "delete"}, {"clean", "delete"},
+        {"cleanup", "delete"}, {"clear", "delete"}, {"prune", "delete"}, {"drop", "delete"},
+        {"truncate", "delete"},
+        {"kill", "stop"}, {"stop", "stop"}, {"terminate", "stop"}, {"halt", "stop"},
+        {"shutdown", "stop"}, {"poweroff", "stop"}, {"pause", "stop"}, {"suspend", "stop"},
+        {"disable", "stop"},
+        {"start", "start"}, {"launch", "start"}, {"resume", "start"}, {"enable", "start"},
+        {"restart", "restart"}, {"reboot", "restart"}, {"reload", "restart"},
+        {"create", "create"}, {"add", "create"}, {"touch", "create"}, {"mkdir", "create"},
+        {"move", "move"}, {"mv", "move"}, {"rename", "move"},
+        {"copy", "copy"}, {"cp", "copy"}, {"duplicate", "copy"}, {"backup", "copy"},
+        {"edit", "modify"}, {"change", "modify"}, {"modify", "modify"}, {"replace", "modify"},
+        {"overwrite", "modify"}, {"update", "modify"}, {"set", "modify"}, {"write", "modify"},
+        {"append", "modify"}, {"chmod", "modify"}, {"chown", "modify"},
+        {"format", "format"}, {"mkfs", "format"},
+        {"install", "install"}, {"upgrade", "install"}, {"downgrade", "install"},
+        {"uninstall", "uninstall"},
+        {"compress", "compress"}, {"zip", "compress"}, {"archive", "compress"}, {"pack", "compress"},
+        {"extract", "extract"}, {"unzip", "extract"}, {"decompress", "extract"}, {"unpack", "extract"},
+        {"untar", "extract"},
+        {"download", "download"}, {"fetch", "download"}, {"pull", "download"},
+        {"upload", "upload"}, {"push", "upload"}, {"send", "upload"},
+        {"mount", "mount"}, {"unmount", "unmount"}, {"umount", "unmount"}, {"eject", "unmount"},
+        {"encrypt", "encrypt"}, {"decrypt", "decrypt"},
+        {"lock", "lock"}, {"unlock", "unlock"},
+    };
+    auto it = words.find(word);
+    return it == words.end() ? std::string_view() : it->second;
+}
+
+} // namespace neuron
@@ -1,16 +1,69 @@
 #include "neuron/ai_client.hpp"
+#include "neuron/chat_json.hpp"
+#include "neuron/conversation.hpp"
+#include "neuron/metrics.hpp"
+#include "neuron/paths.hpp"
+#include "neuron/preconnect.hpp"
+#include "neuron/prompt_template.hpp"
+#include "neuron/single_flight.hpp"
+#include "neuron/sse_parser.hpp"
+#include "neuron/trace.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <curl/curl.h>
+#include <mutex>
 #include <sstream>
 #include <iostream>
-#include <nlohmann/json.hpp>
+#include <thread>
 #include <sys/utsname.h>
 
 namespace neuron {
 
-using json = nlohmann::json;
+// Sampling parameters per mode; part of the cache key
+static int max_tokens_for(Mode mode) {
+    return mode == Mode::RUN ? 150 : 500;  // Shorter for commands, longer for explanations
+}
+
+static double temperature_for(Mode mode) {
+    return mode == Mode::RUN ? 0.1 : 0.3;  // Lower temperature for commands (more deterministic)
+}
+
+static const char* mode_name(Mode mode) {
+    return mode == Mode::RUN ? "run" : "tell";
+}
+
+static std::string chat_endpoint(std::string base_url) {
+    while (!base_url.empty() && base_url.back() == '/') {
+        base_url.pop_back();
+    }
+    return base_url + "/chat/completions";
+}
+
+// "https://host:port" of a URL, which decides where a key may be sent
+static std::string_view url_origin(std::string_view url) {
+    size_t scheme = url.find("://");
+    size_t path = url.find_first_of("/?#", scheme == std::string_view::npos ? 0 : scheme + 3);
+    return url.substr(0, path);
+}
+
+std::string AIClient::configured_endpoint(const Config& config) {
+    // Any OpenAI-compatible server works; used by the benchmarks' mock server too.
+    // Not from .env: a cloned repository must not redirect the API key.
+    return chat_endpoint(config.getTrustedValue("NEURON_BASE_URL").value_or("https://models.github.ai/inference"));
+}
+
+std::shared_ptr<Preconnect> AIClient::preconnect(const Config& config) {
+    std::string dns_directory;
+    if (config.getFlag("NEURON_CONNECTION_CACHE", true) && config.getLong("NEURON_DNS_CACHE_TTL", 300) > 0) {
+        dns_directory = cache_dir();
+    }
+    return std::make_shared<Preconnect>(configured_endpoint(config), RetryPolicy::from_config(config).connect_timeout,
+                                        std::move(dns_directory));
+}
 
 AIClient::AIClient(const Config& config) {
+    TraceSpan span("client init", "setup");
     auto key = config.getNeuronApiKey();
     
     if (!key) {
@@ -23,6 +76,8 @@ AIClient::AIClient(const Config& config) {
     auto configured_model = config.getNeuronModel();
     model_ = configured_model ? *configured_model : "openai/gpt-4";
 
+    endpoint_ = configured_endpoint(config);
+
     // Detect OS
     struct utsname uts;
     if (uname(&uts) == 0) {
@@ -41,14 +96,47 @@ AIClient::AIClient(const Config& config) {
         std::cerr << "Warning: Unable to detect OS, defaulting to Linux." << std::endl;
         os_ = "Linux";
     }
+
+    // Response cache settings; the files themselves are opened on first use
+    if (!config.getFlag("NEURON_CACHE", true)) {
+        cache_policy_ = CachePolicy::DISABLED;
+    }
+    cache_options_.directory = cache_dir();
+    cache_options_.ttl = std::chrono::seconds(config.getLong("NEURON_CACHE_TTL", 7 * 24 * 3600));
+    cache_options_.max_bytes = static_cast<uint64_t>(config.getLong("NEURON_CACHE_MAX_MB", 16)) * 1024 * 1024;
+
+    // Near-duplicate RUN prompts reuse an earlier command
+    semantic_enabled_ = config.getFlag("NEURON_SEMANTIC_CACHE", true);
+    semantic_threshold_ = static_cast<float>(std::clamp(config.getDouble("NEURON_SEMANTIC_THRESHOLD", 0.9), 0.0, 1.0));
+
+    // Addresses and TLS sessions carry over between processes through the cache directory
+    std::unique_ptr<TransportCache> transport;
+    if (config.getFlag("NEURON_CONNECTION_CACHE", true) && !cache_options_.directory.empty()) {
+        transport = std::make_unique<TransportCache>(
+            cache_options_.directory, std::chrono::seconds(config.getLong("NEURON_DNS_CACHE_TTL", 300)));
+    }
+    handles_ = std::make_shared<HandlePool>(std::move(transport));
+
+    policy_ = RetryPolicy::from_config(config);
+
+    // Requests per minute across every process sharing this key and model
+    rate_per_minute_ = std::max(0.0, config.getDouble("NEURON_RATE_LIMIT", 0));
+    rate_burst_ = std::max(1L, config.getLong("NEURON_RATE_BURST", 1));
+
+    // Identical requests in flight from other processes are sent only once
+    coalesce_ = config.getFlag("NEURON_COALESCE", true);
+    latency_ = std::make_unique<LatencyTracker>(model_);
+
+    // The system prompts only depend on the OS, so build them once
+    run_system_ = build_system_message(Mode::RUN);
+    tell_system_ = build_system_message(Mode::TELL);
 }
 
-Prompt AIClient::build_prompt(const std::string& input, Mode mode) const {
-    Prompt prompt;
-    
-    switch (mode) {
-        case Mode::RUN:
-            prompt.system_message = "Note that the user is on a " + os_ + " system." + R"(You are an expert system administrator and command-line specialist with deep knowledge of Unix/Linux and macOS systems.
+// Prompt templates, minified by the compiler. Only {os} and {input} are
+// filled in at run time.
+static constexpr auto kRunSystem = minify_prompt(R"(
+                                    Note that the user is on a {os} system.
+                                    You are an expert system administrator and command-line specialist with deep knowledge of Unix/Linux and macOS systems.
                                     ROLE: Generate safe, efficient shell commands based on user requests.
                                     CONSTRAINTS:
                                         - Only output the command itself, no explanations unless requested
@@ -67,11 +155,11 @@ Prompt AIClient::build_prompt(const std::string& input, Mode mode) const {
                                     EXAMPLES:
                                         User: "list files in current directory" → "ls -la"
                                         User: "find large files" → "find . -type f -size +100M -exec ls -lh {} \;"
-                                        User: "install node" → "brew install node" (macOS) or "curl -fsSL https://deb.nodesource.com/setup_lts.x | sudo -E bash - && sudo apt-get install -y nodejs" (Linux))";
-            prompt.user_template = "Generate a shell command for: " + input;
-            break;
-        case Mode::TELL:
-            prompt.system_message = "Note that the user is on a " + os_ + " system." + R"(You are a knowledgeable technical assistant with expertise across software development, system administration, and general computing topics.
+                                        User: "install node" → "brew install node" (macOS) or "curl -fsSL https://deb.nodesource.com/setup_lts.x | sudo -E bash - && sudo apt-get install -y nodejs" (Linux))");
+
+static constexpr auto kTellSystem = minify_prompt(R"(
+                                    Note that the user is on a {os} system.
+                                    You are a knowledgeable technical assistant with expertise across software development, system administration, and general computing topics.
                                     ROLE: Provide clear, accurate, and helpful explanations tailored to the user's apparent technical level.
                                     RESPONSE STYLE:
                                         - Start with a concise direct answer
@@ -91,84 +179,857 @@ Prompt AIClient::build_prompt(const std::string& input, Mode mode) const {
                                         - Include code examples in backticks when relevant
                                         - Highlight important concepts
                                         - Provide actionable information when possible
-                                    TONE: Professional but approachable, like a senior colleague explaining something to a peer.)";
-            prompt.user_template = "Please explain: " + input;
+                                    TONE: Professional but approachable, like a senior colleague explaining something to a peer.)");
+
+static constexpr auto kRunUser = minify_prompt("Generate a shell command for: {input}");
+static constexpr auto kTellUser = minify_prompt("Please explain: {input}");
+
+static_assert(kRunSystem.view().find("  ") == std::string_view::npos, "indentation left in the RUN prompt");
+static_assert(kTellSystem.view().find("  ") == std::string_view::npos, "indentation left in the TELL prompt");
+
+std::string AIClient::build_system_message(Mode mode) const {
+    return fill_prompt(mode == Mode::RUN ? kRunSystem.view() : kTellSystem.view(), "{os}", os_);
+}
+
+Prompt AIClient::build_prompt(const std::string& input, Mode mode) const {
+    Prompt prompt;
+    switch (mode) {
+        case Mode::RUN:
+            prompt.system_message = run_system_;
+            prompt.user_template = fill_prompt(kRunUser.view(), "{input}", input);
+            if (!context_.empty()) prompt.user_template += "\n\n" + context_;
+            break;
+        case Mode::TELL:
+            prompt.system_message = tell_system_;
+            prompt.user_template = fill_prompt(kTellUser.view(), "{input}", input);
             break;
     }
-
     return prompt;
 }
 
+std::string AIClient::user_message(const std::string& input, Mode mode) const {
+    return build_prompt(input, mode).user_template;
+}
+
+// Per-request state shared with the curl write callback while streaming
+struct StreamState {
+    CURL* curl = nullptr;
+    const TokenCallback* on_token = nullptr;
+    std::string content;      // Accumulated delta text
+    std::string raw;          // Raw body, kept for error reporting
+    std::string finish_reason;
+    Usage usage;
+    bool saw_chunk = false;   // At least one well-formed chunk was parsed
+    bool bad_chunk = false;
+    CompletionFields chunk;   // Reused for every event
+    SseParser parser;
+
+    StreamState() : parser([this](std::string_view data) { on_event(data); }) {}
+
+    void on_event(std::string_view data) {
+        // End-of-stream sentinel; the transfer closes right after it
+        if (data == "[DONE]") return;
+
+        chunk.clear();
+        if (!extract_completion(data, chunk)) {
+            bad_chunk = true;
+            return;
+        }
+        if (chunk.usage.present) usage = chunk.usage;
+        if (!chunk.has_choices) return;
+
+        saw_chunk = true;
+        if (!chunk.finish_reason.empty()) finish_reason = chunk.finish_reason;
+        if (!chunk.content.empty()) {
+            content += chunk.content;
+            (*on_token)(chunk.content);
+        }
+    }
+};
+
+Exchange::Exchange() = default;
+
+Exchange::~Exchange() {
+    if (curl) {
+        if (pool) {
+            pool->release(curl);
+        } else {
+            curl_easy_cleanup(curl);
+        }
+    }
+    if (headers) curl_slist_free_all(headers);
+}
+
+// libcurl's global state loads the TLS library, about a millisecond that
+// --version, offline answers, cache hits and daemon requests never pay.
+// Explicit rather than left to the first curl_easy_init(), which is not
+// thread-safe.
+void init_curl() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        TraceSpan span("curl init", "setup");
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+    });
+}
+
+HandlePool::HandlePool(std::unique_ptr<TransportCache> disk) : disk_(std::move(disk)) {
+    share_ = curl_share_init();
+    if (share_) {
+        curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock_share);
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock_share);
+        curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+}
+
+HandlePool::~HandlePool() {
+    // Export through a handle still attached to the share; nothing to
+    // export if no handle was ever used
+    if (disk_ && share_ && used_) {
+        CURL* handle = idle_.empty() ? curl_easy_init() : nullptr;
+        if (handle) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+            idle_.push_back(handle);
+        }
+        if (!idle_.empty()) disk_->save(idle_.back());
+    }
+    for (CURL* handle : idle_) {
+        curl_easy_cleanup(handle);
+    }
+    if (share_) curl_share_cleanup(share_);
+}
+
+void HandlePool::lock_share(CURL*, curl_lock_data data, curl_lock_access, void* pool) {
+    static_cast<HandlePool*>(pool)->share_locks_[data].lock();
+}
+
+void HandlePool::unlock_share(CURL*, curl_lock_data data, void* pool) {
+    static_cast<HandlePool*>(pool)->share_locks_[data].unlock();
+}
+
+CURL* HandlePool::acquire() {
+    CURL* handle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            handle = idle_.back();
+            idle_.pop_back();
+        }
+    }
+    if (!handle) {
+        init_curl();
+        handle = curl_easy_init();
+        used_ = true;
+    }
+
+    // Reset drops the share along with every other option
+    if (handle && share_) curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+    if (handle && disk_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        disk_->apply(handle);
+    }
+    return handle;
+}
+
+void HandlePool::release(CURL* handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (disk_) disk_->observe(handle);
+
+    // Reset clears options; the connections stay in the share
+    curl_easy_reset(handle);
+
+    if (idle_.size() < kMaxIdle) {
+        idle_.push_back(handle);
+        return;
+    }
+    curl_easy_cleanup(handle);
+}
+
 static size_t curl_write_callback(void* contents, size_t size, size_t nmemb, std::string* output) {
     size_t total_size = size * nmemb;
     output->append(static_cast<char*>(contents), total_size);
     return total_size;
 }
 
-std::optional<std::string> AIClient::run(const std::string& user_input, Mode mode) {
+static size_t curl_stream_callback(void* contents, size_t size, size_t nmemb, StreamState* state) {
+    size_t total_size = size * nmemb;
+
+    // Error bodies are plain JSON, not an event stream
+    long response_code = 0;
+    curl_easy_getinfo(state->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (response_code != 200) {
+        state->raw.append(static_cast<char*>(contents), total_size);
+        return total_size;
+    }
+
+    state->parser.feed(static_cast<char*>(contents), total_size);
+    return total_size;
+}
+
+ResponseCache* AIClient::cache() {
+    if (!cache_opened_) {
+        cache_opened_ = true;
+        if (!cache_options_.directory.empty()) {
+            try {
+                cache_ = std::make_unique<ResponseCache>(cache_options_);
+            } catch (const std::exception&) {
+                // An unusable cache directory just means every call goes to the network
+                cache_.reset();
+            }
+        }
+    }
+    return cache_.get();
+}
+
+SemanticCache* AIClient::semantic() {
+    if (!semantic_opened_) {
+        semantic_opened_ = true;
+        if (semantic_enabled_ && !cache_options_.directory.empty()) {
+            try {
+                semantic_ = std::make_unique<SemanticCache>(cache_options_.directory);
+            } catch (const std::exception&) {
+                semantic_.reset();
+            }
+        }
+    }
+    return semantic_.get();
+}
+
+Hash128 AIClient::cache_key(const Prompt& prompt, Mode mode, std::span<const ChatMessage> history) const {
+    Hasher hasher;
+    hasher.feed(model_)
+        .feed(endpoint_)
+        .feed(mode_name(mode))
+        .feed(os_)
+        .feed(prompt.system_message);
+    for (const auto& message : history) {
+        hasher.feed(message.role).feed(message.content);
+    }
+    return hasher.feed(prompt.user_template)
+        .feed(std::to_string(max_tokens_for(mode)))
+        .feed(std::to_string(temperature_for(mode)))
+        .digest();
+}
+
+static size_t curl_header_callback(char* buffer, size_t size, size_t nitems, Exchange* exchange) {
+    size_t total_size = size * nitems;
+    std::string_view line(buffer, total_size);
+
+    // Retry-After (seconds or HTTP-date), or the millisecond variant some providers send
+    auto value_of = [&](std::string_view name) -> std::optional<std::string_view> {
+        if (line.size() <= name.size()) return std::nullopt;
+        for (size_t i = 0; i < name.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(line[i])) != name[i]) return std::nullopt;
+        }
+        return line.substr(name.size());
+    };
+
+    if (auto ms = value_of("retry-after-ms:")) {
+        if (auto parsed = parse_retry_after(*ms)) {
+            exchange->retry_after = std::chrono::duration_cast<std::chrono::milliseconds>(*parsed) / 1000;
+        }
+    } else if (auto value = value_of("retry-after:")) {
+        exchange->retry_after = parse_retry_after(*value);
+    }
+    return total_size;
+}
+
+std::optional<std::string> AIClient::run(const std::string& user_input, Mode mode,
+                                         const TokenCallback& on_token,
+                                         std::span<const ChatMessage> history) {
+    return complete(prepare(user_input, mode, on_token, history), std::nullopt);
+}
+
+std::optional<std::string> AIClient::complete(std::unique_ptr<Exchange> exchange,
+                                              std::optional<CURLcode> performed) {
+    last_from_cache_ = exchange->cached.has_value();
+    last_match_ = exchange->match;
+    last_usage_ = Usage{};
+    last_finish_reason_.clear();
+    last_error_.clear();
+
+    if (exchange->cached) {
+        if (exchange->on_token) exchange->on_token(*exchange->cached);
+        return exchange->cached;
+    }
+
+    // If another process is already sending this request, wait for it and
+    // take its answer from the cache. Held until the answer is stored.
+    std::optional<SingleFlight> flight;
+    if (coalesce_ && !performed && exchange->curl && exchange->store && cache_policy_ == CachePolicy::USE && cache()) {
+        TraceSpan span("coalesce", "cache");
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - exchange->started);
+        flight.emplace(cache_options_.directory + "/inflight", exchange->key, policy_.deadline - elapsed);
+        if (flight->waited()) {
+            if (auto hit = cache()->get(exchange->key)) {
+                span.set_detail("answered by another process");
+                Metrics::global().count("neuron_cache_lookups_total", {{"mode", mode_name(exchange->mode)}, {"result", "coalesced"}});
+                last_from_cache_ = true;
+                if (exchange->on_token) exchange->on_token(*hit);
+                return hit;
+            }
+            span.set_detail(flight->leader() ? "took over" : "timed out");
+        }
+    }
+
+    while (true) {
+        // The first attempt may already have been performed by the caller
+        CURLcode res = CURLE_FAILED_INIT;
+        if (performed) {
+            res = *performed;
+            performed.reset();
+        } else if (exchange->curl) {
+            if (!pace(*exchange)) break;
+            res = perform(exchange);
+        }
+
+        auto result = finish(*exchange, res);
+        if (result) {
+            last_usage_ = exchange->usage;
+            last_finish_reason_ = std::move(exchange->finish_reason);
+            return result;
+        }
+
+        auto delay = retry_delay(*exchange);
+        if (!delay) break;
+
+        {
+            TraceSpan span("retry backoff", "client");
+            std::this_thread::sleep_for(*delay);
+        }
+        exchange = retry(*exchange);
+    }
+
+    last_error_ = exchange->error;
+    if (exchange->attempt > 1) {
+        last_error_ += " (after " + std::to_string(exchange->attempt) + " attempts)";
+    }
+    std::cerr << last_error_ << std::endl;
+    return std::nullopt;
+}
+
+std::unique_ptr<PendingRequest> AIClient::start(const std::string& user_input, Mode mode) {
+    return std::make_unique<PendingRequest>(*this, prepare(user_input, mode));
+}
+
+PendingRequest::PendingRequest(AIClient& client, std::unique_ptr<Exchange> exchange)
+    : client_(client), exchange_(std::move(exchange)) {
+    // Cache hits and failed setups have nothing to transfer
+    if (!exchange_->curl) return;
+
+    // Without a slot in time nothing is sent here; get() tries once more and reports it
+    auto wait = client_.reserve(*exchange_);
+    if (!wait) return;
+    wait_ = *wait;
+
+    multi_ = curl_multi_init();
+    if (!multi_) return;
+    worker_ = std::thread([this] { transfer(); });
+}
+
+PendingRequest::~PendingRequest() {
+    cancel();
+}
+
+void PendingRequest::transfer() {
+    TraceSpan span("background request", "client");
+
+    // A private multi handle so cancel() can interrupt the wait; the pool's
+    // share still hands it the connection the last request used. It stays
+    // empty while waiting for a rate limit slot, so polling it just sleeps.
+    auto until = std::chrono::steady_clock::now() + wait_;
+    while (!cancelled_.load() && std::chrono::steady_clock::now() < until) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+        curl_multi_poll(multi_, nullptr, 0, static_cast<int>(std::clamp<long long>(left.count(), 1, 1000)), nullptr);
+    }
+    curl_multi_add_handle(multi_, exchange_->curl);
+
+    int running = 1;
+    while (running > 0 && !cancelled_.load()) {
+        if (curl_multi_perform(multi_, &running) != CURLM_OK) break;
+        if (running > 0) curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+    }
+
+    result_ = CURLE_ABORTED_BY_CALLBACK;
+    int queued = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+        if (msg->msg == CURLMSG_DONE) result_ = msg->data.result;
+    }
+    if (cancelled_.load()) span.set_detail("cancelled");
+}
+
+std::optional<std::string> PendingRequest::get() {
+    if (!exchange_) return std::nullopt;
+
+    if (worker_.joinable()) {
+        TraceSpan span("background wait", "client");
+        worker_.join();
+    }
+    std::optional<CURLcode> performed;
+    if (multi_) {
+        curl_multi_remove_handle(multi_, exchange_->curl);
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+        performed = result_;
+    }
+    return client_.complete(std::move(exchange_), performed);
+}
+
+void PendingRequest::cancel() {
+    cancelled_.store(true);
+    if (worker_.joinable()) {
+        curl_multi_wakeup(multi_);
+        worker_.join();
+    }
+    if (multi_) {
+        if (exchange_ && exchange_->curl) curl_multi_remove_handle(multi_, exchange_->curl);
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+    }
+    exchange_.reset();
+}
+
+std::unique_ptr<Exchange> AIClient::prepare(const std::string& user_input, Mode mode,
+                                            const TokenCallback& on_token,
+                                            std::span<const ChatMessage> history) {
+    auto exchange = std::make_unique<Exchange>();
     Prompt prompt = build_prompt(user_input, mode);
-    std::string response_string;
-
-    json request_body = {
-        {"model", model_},
-        {"messages", {
-            {{"role", "system"}, {"content", prompt.system_message}},
-            {{"role", "user"}, {"content", prompt.user_template}}
-        }},
-        {"max_tokens", mode == Mode::RUN ? 150 : 500},  // Shorter for commands, longer for explanations
-        {"temperature", mode == Mode::RUN ? 0.1 : 0.3}  // Lower temperature for commands (more deterministic)
+    exchange->mode = mode;
+    exchange->key = cache_key(prompt, mode, history);
+    exchange->input = user_input;
+    exchange->in_conversation = !history.empty();
+    exchange->on_token = on_token;
+    exchange->started = std::chrono::steady_clock::now();
+    exchange->target = ModelEndpoint{model_, endpoint_, api_key_};
+    if (mode == Mode::RUN) {
+        exchange->scope = Hasher().feed(model_).feed(endpoint_).feed(os_).feed(prompt.system_message).feed(context_).digest().lo;
+    }
+
+    if (cache_policy_ == CachePolicy::USE) {
+        TraceSpan span("cache lookup", "cache");
+        if (ResponseCache* c = cache()) {
+            if (auto hit = c->get(exchange->key)) {
+                span.set_detail("hit");
+                Metrics::global().count("neuron_cache_lookups_total", {{"mode", mode_name(mode)}, {"result", "hit"}});
+                exchange->cached = std::move(hit);
+                return exchange;
+            }
+
+            // Otherwise a reworded prompt asked before, if its answer is still cached
+            SemanticCache* s = mode == Mode::RUN && history.empty() ? semantic() : nullptr;
+            auto match = s ? s->lookup(exchange->scope, user_input, semantic_threshold_) : std::nullopt;
+            if (match) {
+                if (auto hit = c->get(match->key)) {
+                    span.set_detail("similar prompt hit");
+                    Metrics::global().count("neuron_cache_lookups_total", {{"mode", mode_name(mode)}, {"result", "similar"}});
+                    exchange->cached = std::move(hit);
+                    exchange->match = std::move(match);
+                    return exchange;
+                }
+            }
+            Metrics::global().count("neuron_cache_lookups_total", {{"mode", mode_name(mode)}, {"result", "miss"}});
+        }
+    }
+
+    build_request(*exchange, prompt, history);
+    setup_transfer(*exchange);
+    return exchange;
+}
+
+std::unique_ptr<Exchange> AIClient::prepare_for(const ModelEndpoint& target, const std::string& user_input,
+                                                Mode mode, const TokenCallback& on_token) {
+    auto exchange = std::make_unique<Exchange>();
+    exchange->mode = mode;
+    exchange->input = user_input;
+    exchange->on_token = on_token;
+    exchange->started = std::chrono::steady_clock::now();
+    exchange->target = target;
+    exchange->store = false;
+
+    build_request(*exchange, build_prompt(user_input, mode), {});
+    setup_transfer(*exchange);
+    return exchange;
+}
+
+void AIClient::build_request(Exchange& exchange, const Prompt& prompt, std::span<const ChatMessage> history) const {
+    TraceSpan span("request build", "client");
+    ChatRequest request;
+    request.model = exchange.target.model;
+    request.system_message = prompt.system_message;
+    request.history = history;
+    request.user_message = prompt.user_template;
+    request.max_tokens = max_tokens_for(exchange.mode);
+    request.temperature = temperature_for(exchange.mode);
+    request.stream = static_cast<bool>(exchange.on_token);
+    write_chat_request(exchange.body, request);
+
+    if (Tracer::global().enabled()) {
+        size_t system = estimate_tokens(request.system_message);
+        size_t user = estimate_tokens(request.user_message);
+        size_t earlier = 0;
+        for (const auto& message : history) earlier += estimate_tokens(message.content);
+        Tracer::global().note("prompt", "~" + std::to_string(system + user + earlier) + " tokens (system " +
+                                            std::to_string(system) + ", user " + std::to_string(user) +
+                                            ", history " + std::to_string(earlier) + "), " +
+                                            std::to_string(exchange.body.size()) + " byte body");
+    }
+}
+
+ModelEndpoint AIClient::resolve(std::string_view spec, std::string_view api_key) const {
+    size_t at = spec.find('@');
+    std::string_view model = spec.substr(0, at);
+    std::string_view base_url = at == std::string_view::npos ? std::string_view() : spec.substr(at + 1);
+    ModelEndpoint target{
+        model.empty() ? model_ : std::string(model),
+        base_url.empty() ? endpoint_ : chat_endpoint(std::string(base_url)),
+        std::string(api_key),
     };
+    if (target.api_key.empty() && url_origin(target.endpoint) == url_origin(endpoint_)) target.api_key = api_key_;
+    return target;
+}
 
-    CURL* curl = curl_easy_init();
-    if (!curl) return std::nullopt;
+bool AIClient::setup_transfer(Exchange& exchange) {
+    const bool streaming = static_cast<bool>(exchange.on_token);
+
+    CURL* curl = handles_->acquire();
+    if (!curl) return false;
+    exchange.curl = curl;
+    exchange.pool = handles_;
 
     struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + api_key_).c_str());
+    if (!exchange.target.api_key.empty()) {
+        headers = curl_slist_append(headers, ("Authorization: Bearer " + exchange.target.api_key).c_str());
+    }
     headers = curl_slist_append(headers, "Content-Type: application/json");
+    if (streaming) {
+        headers = curl_slist_append(headers, "Accept: text/event-stream");
+    }
+    exchange.headers = headers;
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://models.github.ai/inference/chat/completions");
+    curl_easy_setopt(curl, CURLOPT_URL, exchange.target.endpoint.c_str());
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, exchange.body.c_str());
+
+    if (streaming) {
+        exchange.stream = std::make_unique<StreamState>();
+        exchange.stream->curl = curl;
+        exchange.stream->on_token = &exchange.on_token;
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_stream_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, exchange.stream.get());
+    } else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &exchange.response);
+    }
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &exchange);
+
+    // Separate connect and transfer budgets; never run past the overall deadline
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - exchange.started);
+    auto remaining = std::max(std::chrono::milliseconds(1), policy_.deadline - elapsed);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(policy_.connect_timeout.count()));
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(std::min(policy_.attempt_timeout, remaining).count()));
+
+    // Lets concurrent exchanges share one HTTP/2 connection when driven by a multi handle
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    // The first connection may already be open
+    if (preconnect_ && exchange.target.endpoint == preconnect_->url()) preconnect_->attach(curl);
+
+    return true;
+}
+
+std::unique_ptr<Exchange> AIClient::clone(const Exchange& exchange) {
+    auto copy = std::make_unique<Exchange>();
+    copy->mode = exchange.mode;
+    copy->key = exchange.key;
+    copy->input = exchange.input;
+    copy->in_conversation = exchange.in_conversation;
+    copy->scope = exchange.scope;
+    copy->target = exchange.target;
+    copy->store = exchange.store;
+    copy->on_token = exchange.on_token;
+    copy->body = exchange.body;
+    copy->attempt = exchange.attempt;
+    copy->started = exchange.started;
+    setup_transfer(*copy);
+    return copy;
+}
+
+std::unique_ptr<Exchange> AIClient::retry(const Exchange& exchange) {
+    auto next = clone(exchange);
+    next->attempt = exchange.attempt + 1;
+    return next;
+}
+
+std::optional<std::chrono::milliseconds> AIClient::retry_delay(const Exchange& exchange) {
+    if (exchange.cached || exchange.attempt >= policy_.max_attempts) return std::nullopt;
+    if (!is_retryable(exchange.result, exchange.status)) return std::nullopt;
 
-    std::string body_str = request_body.dump();
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L); // Set timeout to 10 seconds
+    // Text already shown to the user cannot be taken back
+    if (exchange.stream && !exchange.stream->content.empty()) return std::nullopt;
 
-    CURLcode res = curl_easy_perform(curl);
+    auto delay = policy_.backoff(exchange.attempt, rng_);
+    if (exchange.retry_after) {
+        delay = std::max(delay, *exchange.retry_after);
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - exchange.started;
+    if (elapsed + delay >= policy_.deadline) return std::nullopt;
+    return delay;
+}
+
+CURLcode AIClient::perform(std::unique_ptr<Exchange>& exchange) {
+    std::optional<std::chrono::milliseconds> hedge_after;
+    if (policy_.hedge) {
+        if (auto p95 = latency_->p95()) {
+            hedge_after = std::max(*p95, policy_.min_hedge_delay);
+        }
+    }
+    if (!hedge_after) {
+        return curl_easy_perform(exchange->curl);
+    }
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) return curl_easy_perform(exchange->curl);
+
+    // Both copies stream through a gate: the first one to produce text wins
+    // and only its tokens reach the caller
+    TokenCallback user_callback = exchange->on_token;
+    Exchange* winner = nullptr;
+    auto gate = [&](Exchange* owner) {
+        return [&, owner](std::string_view token) {
+            if (!winner) winner = owner;
+            if (winner == owner) user_callback(token);
+        };
+    };
+    if (user_callback) exchange->on_token = gate(exchange.get());
+
+    std::unique_ptr<Exchange> hedge;
+    std::vector<Exchange*> running = {exchange.get()};
+    curl_multi_add_handle(multi, exchange->curl);
+
+    const auto start = std::chrono::steady_clock::now();
+    CURLcode result = CURLE_OK;
+    Exchange* finished = nullptr;
+
+    while (!finished) {
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE || finished) continue;
+
+            auto it = std::find_if(running.begin(), running.end(),
+                                   [&](Exchange* e) { return e->curl == msg->easy_handle; });
+            if (it == running.end()) continue;
+
+            Exchange* done = *it;
+            long status = 0;
+            curl_easy_getinfo(done->curl, CURLINFO_RESPONSE_CODE, &status);
+            curl_multi_remove_handle(multi, done->curl);
+            running.erase(it);
+
+            // A clean 200 wins outright; a failure only counts once nothing else is left
+            bool succeeded = msg->data.result == CURLE_OK && status == 200;
+            if (succeeded || winner == done || running.empty()) {
+                finished = done;
+                result = msg->data.result;
+            }
+        }
+        if (finished) break;
+
+        // Once one copy is streaming, the other is wasted work
+        if (winner) {
+            for (auto it = running.begin(); it != running.end();) {
+                if (*it != winner) {
+                    curl_multi_remove_handle(multi, (*it)->curl);
+                    it = running.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        // Fire the hedge if no response headers arrived within the p95 budget
+        auto waited = std::chrono::steady_clock::now() - start;
+        if (!hedge && !winner && waited >= *hedge_after) {
+            long status = 0;
+            curl_easy_getinfo(exchange->curl, CURLINFO_RESPONSE_CODE, &status);
+            // A hedge is only worth it if the rate limit has a slot to spare right now
+            if (status == 0 && reserve(*exchange, std::chrono::milliseconds(0))) {
+                hedge = clone(*exchange);
+                if (user_callback) hedge->on_token = gate(hedge.get());
+                if (hedge->curl) {
+                    // Open a fresh connection rather than queueing behind the slow one
+                    curl_easy_setopt(hedge->curl, CURLOPT_PIPEWAIT, 0L);
+                    curl_easy_setopt(hedge->curl, CURLOPT_FRESH_CONNECT, 1L);
+                    curl_multi_add_handle(multi, hedge->curl);
+                    running.push_back(hedge.get());
+                }
+            }
+        }
+
+        int timeout_ms = 100;
+        if (!hedge) {
+            auto until_hedge = std::chrono::duration_cast<std::chrono::milliseconds>(*hedge_after - waited);
+            timeout_ms = static_cast<int>(std::clamp<long long>(until_hedge.count(), 1, 100));
+        }
+        curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+    }
+
+    for (Exchange* e : running) {
+        curl_multi_remove_handle(multi, e->curl);
+    }
+    curl_multi_cleanup(multi);
+
+    if (finished == hedge.get()) {
+        exchange = std::move(hedge);
+    }
+    exchange->on_token = user_callback;
+    return result;
+}
+
+std::optional<std::string> AIClient::finish(Exchange& exchange, CURLcode res) {
+    if (exchange.cached) return exchange.cached;
 
     // Get HTTP response code
-    long response_code;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-    
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    exchange.result = res;
+    if (exchange.curl) {
+        curl_easy_getinfo(exchange.curl, CURLINFO_RESPONSE_CODE, &exchange.status);
+        Tracer::global().add_transfer(exchange.curl, exchange.attempt);
+    }
 
+    const char* mode = mode_name(exchange.mode);
+    const std::string& model = exchange.target.model;
     if (res != CURLE_OK) {
-        std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+        exchange.error = std::string("CURL error: ") + curl_easy_strerror(res);
+        Metrics::global().count("neuron_request_errors_total",
+                                {{"mode", mode}, {"model", model}, {"type", "curl"}, {"code", std::to_string(res)}});
         return std::nullopt;
     }
+    if (exchange.status != 200) {
+        Metrics::global().count("neuron_request_errors_total",
+                                {{"mode", mode}, {"model", model}, {"type", "http"}, {"code", std::to_string(exchange.status)}});
+    }
+
+    StreamState* stream = exchange.stream.get();
+    std::string& response_string = stream ? stream->raw : exchange.response;
 
     // Check for HTTP errors before parsing JSON
-    if (response_code == 401) {
-        std::cerr << "Authentication failed. Please check your API key." << std::endl;
+    if (exchange.status == 401) {
+        exchange.error = "Authentication failed. Please check your API key.";
         return std::nullopt;
-    } else if (response_code != 200) {
-        std::cerr << "HTTP Error " << response_code << ": " << response_string << std::endl;
+    } else if (exchange.status != 200) {
+        exchange.error = "HTTP Error " + std::to_string(exchange.status) + ": " + response_string;
+
+        // Over the limit anyway: every process sharing it backs off, not just this one
+        if (exchange.status == 429 && rate_per_minute_ > 0) {
+            auto it = limiters_.find(exchange.target.model);
+            if (it != limiters_.end()) it->second->hold_off(exchange.retry_after.value_or(policy_.base_delay));
+        }
         return std::nullopt;
     }
 
-    try {
-        json response_json = json::parse(response_string);
-        if (response_json.contains("choices") && !response_json["choices"].empty()) {
-            return response_json["choices"][0]["message"]["content"].get<std::string>();
-        } else {
-            std::cerr << "Unexpected response format: " << response_string << std::endl;
+    std::optional<std::string> content;
+    if (stream) {
+        stream->parser.finish();
+        if (!stream->saw_chunk) {
+            exchange.error = "Unexpected response format: no completion chunks received";
             return std::nullopt;
         }
-    } catch (const json::parse_error& e) {
-        std::cerr << "JSON parse error: " << e.what() << std::endl;
-        return std::nullopt;
+        if (stream->bad_chunk) {
+            std::cerr << "Warning: skipped malformed stream chunk" << std::endl;
+        }
+        exchange.finish_reason = std::move(stream->finish_reason);
+        exchange.usage = stream->usage;
+        content = std::move(stream->content);
+    } else {
+        TraceSpan span("response parse", "client");
+        CompletionFields fields;
+        if (!extract_completion(response_string, fields)) {
+            exchange.error = "JSON parse error: malformed response body";
+            return std::nullopt;
+        }
+        if (!fields.has_choices) {
+            exchange.error = "Unexpected response format: " + response_string;
+            return std::nullopt;
+        }
+        exchange.finish_reason = std::move(fields.finish_reason);
+        exchange.usage = fields.usage;
+        content = std::move(fields.content);
+    }
+
+    // Feed the hedging percentile with this request's time to first byte;
+    // other models raced against this one have latencies of their own
+    curl_off_t ttfb_us = 0;
+    if (exchange.target.model == model_ &&
+        curl_easy_getinfo(exchange.curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb_us) == CURLE_OK && ttfb_us > 0) {
+        latency_->record(std::chrono::milliseconds(ttfb_us / 1000));
+    }
+
+    if (Metrics::global().enabled()) {
+        Metrics::global().observe("neuron_request_duration_seconds", {{"mode", mode}, {"model", model}},
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - exchange.started));
+        if (exchange.usage.present) {
+            Metrics::global().count("neuron_tokens_total", {{"mode", mode}, {"model", model}, {"type", "prompt"}},
+                                    static_cast<double>(exchange.usage.prompt_tokens));
+            Metrics::global().count("neuron_tokens_total", {{"mode", mode}, {"model", model}, {"type", "completion"}},
+                                    static_cast<double>(exchange.usage.completion_tokens));
+        }
+    }
+
+    if (exchange.store) store(exchange, *content);
+    return content;
+}
+
+std::optional<std::chrono::milliseconds> AIClient::reserve(Exchange& exchange,
+                                                           std::optional<std::chrono::milliseconds> max_wait) {
+    if (rate_per_minute_ <= 0) return std::chrono::milliseconds(0);
+
+    if (!max_wait) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - exchange.started);
+        max_wait = std::max(std::chrono::milliseconds(0), policy_.deadline - elapsed);
+    }
+
+    auto& limiter = limiters_[exchange.target.model];
+    if (!limiter) {
+        limiter = std::make_unique<RateLimiter>(RateLimiter::path_for(exchange.target.api_key, exchange.target.model),
+                                                rate_per_minute_, rate_burst_);
+    }
+    auto wait = limiter->reserve(*max_wait);
+    if (!wait) {
+        exchange.error = "Rate limit: no request slot for " + exchange.target.model + " before the deadline";
+    }
+    return wait;
+}
+
+bool AIClient::pace(Exchange& exchange) {
+    auto wait = reserve(exchange);
+    if (!wait) return false;
+    if (wait->count() > 0) {
+        TraceSpan span("rate limit wait", "client");
+        std::this_thread::sleep_for(*wait);
+    }
+    return true;
+}
+
+void AIClient::store(const Exchange& exchange, const std::string& content) {
+    if (content.empty() || cache_policy_ == CachePolicy::DISABLED) return;
+    if (ResponseCache* c = cache()) {
+        c->put(exchange.key, content);
+        if (exchange.mode == Mode::RUN && !exchange.in_conversation) {
+            if (SemanticCache* s = semantic()) {
+                s->insert(exchange.scope, exchange.input, exchange.key);
+            }
+        }
     }
 }
 
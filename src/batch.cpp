@@ -0,0 +1,300 @@
+#include "neuron/batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace neuron {
+
+using json = nlohmann::json;
+
+namespace {
+
+// In order, results finished behind a slow item wait for it; past this many
+// per slot of the window no more input is read until it is done
+constexpr size_t kHeldPerSlot = 4;
+
+struct Pending {
+    size_t index = 0;
+    json item;
+    std::unique_ptr<Exchange> exchange;
+    std::chrono::steady_clock::time_point started;
+};
+
+// An item waiting out a retry backoff or for its rate limit slot
+struct Delayed {
+    std::chrono::steady_clock::time_point ready;
+    Pending pending;
+    bool paced = false;  // Holds a rate limit slot for ready
+};
+
+// Writes finished results either immediately or in input order
+class ResultWriter {
+public:
+    ResultWriter(const BatchRunner::LineSink& out, bool ordered) : out_(out), ordered_(ordered) {}
+
+    void emit(size_t index, const json& result) {
+        if (!ordered_) {
+            out_(result.dump());
+            return;
+        }
+
+        held_.emplace(index, result.dump());
+        while (!held_.empty() && held_.begin()->first == next_) {
+            out_(held_.begin()->second);
+            held_.erase(held_.begin());
+            ++next_;
+        }
+    }
+
+    size_t held() const { return held_.size(); }
+
+private:
+    const BatchRunner::LineSink& out_;
+    bool ordered_;
+    size_t next_ = 0;
+    std::map<size_t, std::string> held_;
+};
+
+// Severity and matching rule ids for a generated command
+void add_safety(json& result, const SafetyAnalyzer* safety, Mode mode, const std::string& content) {
+    if (!safety || mode != Mode::RUN) return;
+    SafetyReport report = safety->analyze(content);
+    result["safety"] = severity_name(report.severity);
+    if (!report.findings.empty()) {
+        json rules = json::array();
+        for (const auto& finding : report.findings) {
+            rules.push_back(finding.id);
+        }
+        result["safety_rules"] = std::move(rules);
+    }
+}
+
+json make_result(size_t index, const json& item) {
+    json result = {{"index", index}};
+    if (item.is_object()) {
+        if (item.contains("id")) result["id"] = item["id"];
+        if (item.contains("mode")) result["mode"] = item["mode"];
+        if (item.contains("prompt")) result["prompt"] = item["prompt"];
+    }
+    return result;
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(AIClient& client, const BatchOptions& options)
+    : client_(client), options_(options) {
+    if (options_.concurrency == 0) {
+        options_.concurrency = 1;
+    }
+}
+
+size_t BatchRunner::run(std::istream& in, std::ostream& out) {
+    return run([&](std::string& line) { return static_cast<bool>(std::getline(in, line)); },
+               [&](const std::string& line) { out << line << '\n' << std::flush; });
+}
+
+size_t BatchRunner::run(const LineSource& next_line, const LineSink& out) {
+    ResultWriter writer(out, options_.ordered);
+    std::unordered_map<CURL*, Pending> active;
+    std::vector<Delayed> delayed;
+    size_t next_index = 0;
+    size_t failures = 0;
+    bool eof = false;
+    std::string line;
+
+    auto fail = [&](size_t index, const json& item, const std::string& error) {
+        json result = make_result(index, item);
+        result["ok"] = false;
+        result["error"] = error;
+        writer.emit(index, result);
+        ++failures;
+    };
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        // Without a multi handle nothing can be sent, so every item fails
+        while (next_line(line)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            json item = json::parse(line, nullptr, false);
+            fail(next_index++, item.is_discarded() ? json() : item, "Failed to initialize transfers");
+        }
+        return failures;
+    }
+
+    // Multiplex over a single HTTP/2 connection when the server allows it
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(options_.concurrency));
+
+    while (true) {
+        // Retries whose backoff has elapsed go back in flight first
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = delayed.begin(); it != delayed.end() && active.size() < options_.concurrency;) {
+            if (it->ready > now) {
+                ++it;
+                continue;
+            }
+            if (!it->paced) {
+                auto wait = client_.reserve(*it->pending.exchange);
+                if (!wait) {
+                    fail(it->pending.index, it->pending.item, it->pending.exchange->error);
+                    it = delayed.erase(it);
+                    continue;
+                }
+                it->paced = true;
+                if (wait->count() > 0) {
+                    it->ready = now + *wait;
+                    ++it;
+                    continue;
+                }
+            }
+            CURL* handle = it->pending.exchange->curl;
+            if (handle) {
+                curl_multi_add_handle(multi, handle);
+                active.emplace(handle, std::move(it->pending));
+            } else {
+                fail(it->pending.index, it->pending.item, "Failed to initialize request");
+            }
+            it = delayed.erase(it);
+        }
+
+        // Top up the in-flight window from the input
+        const size_t max_held = options_.concurrency * kHeldPerSlot;
+        while (!eof && active.size() + delayed.size() < options_.concurrency &&
+               active.size() + delayed.size() + writer.held() < max_held) {
+            if (!next_line(line)) {
+                eof = true;
+                break;
+            }
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+            size_t index = next_index++;
+            json item = json::parse(line, nullptr, false);
+            if (item.is_discarded() || !item.is_object() || !item.contains("prompt") || !item["prompt"].is_string()) {
+                fail(index, json(), "Invalid batch item: expected {\"mode\": ..., \"prompt\": ...}");
+                continue;
+            }
+
+            if (item.contains("mode") && !item["mode"].is_string()) {
+                fail(index, item, "Invalid mode: expected \"run\" or \"tell\"");
+                continue;
+            }
+            std::string mode_str = item.value("mode", "run");
+            if (mode_str != "run" && mode_str != "tell") {
+                fail(index, item, "Invalid mode: " + mode_str);
+                continue;
+            }
+
+            Mode mode = mode_str == "run" ? Mode::RUN : Mode::TELL;
+            auto exchange = client_.prepare(item["prompt"].get<std::string>(), mode);
+
+            if (exchange->cached) {
+                json result = make_result(index, item);
+                result["ok"] = true;
+                result["content"] = *exchange->cached;
+                result["cached"] = true;
+                if (exchange->match) {
+                    result["similar_to"] = exchange->match->prompt;
+                }
+                add_safety(result, options_.safety, mode, *exchange->cached);
+                result["latency_ms"] = 0;
+                writer.emit(index, result);
+                continue;
+            }
+            if (!exchange->curl) {
+                fail(index, item, "Failed to initialize request");
+                continue;
+            }
+
+            // Under a rate limit the item waits its turn without holding up the others
+            auto wait = client_.reserve(*exchange);
+            if (!wait) {
+                fail(index, item, exchange->error);
+                continue;
+            }
+            Pending pending{index, std::move(item), std::move(exchange), std::chrono::steady_clock::now()};
+            if (wait->count() > 0) {
+                delayed.push_back(Delayed{pending.started + *wait, std::move(pending), true});
+                continue;
+            }
+
+            CURL* handle = pending.exchange->curl;
+            curl_multi_add_handle(multi, handle);
+            active.emplace(handle, std::move(pending));
+        }
+
+        if (active.empty() && delayed.empty() && eof) break;
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            auto it = active.find(msg->easy_handle);
+            if (it == active.end()) continue;
+
+            Pending& pending = it->second;
+            curl_multi_remove_handle(multi, msg->easy_handle);
+
+            auto content = client_.finish(*pending.exchange, msg->data.result);
+            auto elapsed = std::chrono::steady_clock::now() - pending.started;
+
+            if (!content) {
+                if (auto delay = client_.retry_delay(*pending.exchange)) {
+                    Pending again{pending.index, std::move(pending.item), client_.retry(*pending.exchange), pending.started};
+                    delayed.push_back(Delayed{std::chrono::steady_clock::now() + *delay, std::move(again)});
+                    active.erase(it);
+                    continue;
+                }
+            }
+
+            json result = make_result(pending.index, pending.item);
+            result["ok"] = content.has_value();
+            if (content) {
+                result["content"] = *content;
+                result["cached"] = false;
+                const Exchange& done = *pending.exchange;
+                if (!done.finish_reason.empty()) {
+                    result["finish_reason"] = done.finish_reason;
+                }
+                add_safety(result, options_.safety, done.mode, *content);
+                if (done.usage.present) {
+                    result["usage"] = {
+                        {"prompt_tokens", done.usage.prompt_tokens},
+                        {"completion_tokens", done.usage.completion_tokens},
+                        {"total_tokens", done.usage.total_tokens},
+                    };
+                }
+            } else {
+                result["error"] = pending.exchange->error;
+                ++failures;
+            }
+            result["latency_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+            writer.emit(pending.index, result);
+
+            active.erase(it);
+        }
+
+        // Sleep until there is network activity or the next retry is due
+        int timeout_ms = 1000;
+        for (const auto& d : delayed) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(d.ready - std::chrono::steady_clock::now());
+            timeout_ms = std::min<int>(timeout_ms, static_cast<int>(std::max<long long>(wait.count(), 0)));
+        }
+        if (running > 0 || !delayed.empty()) {
+            curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+        }
+    }
+
+    curl_multi_cleanup(multi);
+    return failures;
+}
+
+} // namespace neuron
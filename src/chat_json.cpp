@@ -0,0 +1,380 @@
+#include "neuron/chat_json.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace neuron {
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+
+void append_utf8(std::string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+// Single-pass reader over one JSON document. Values neuron does not need
+// are stepped over; strings are only decoded when a destination is given.
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : p_(text.data()), end_(text.data() + text.size()) {}
+
+    bool document(CompletionFields& out) {
+        // Any other value is still a valid body, just one without fields
+        if (!peek('{')) {
+            if (!skip(0)) return false;
+        } else if (!object([&](std::string_view key) {
+                       if (key == "choices") return choices(out);
+                       if (key == "usage") return usage(out.usage);
+                       return skip(0);
+                   })) {
+            return false;
+        }
+        ws();
+        return p_ == end_;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    std::string key_;  // Decoded key when it contains escapes
+
+    void ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    bool consume(char c) {
+        ws();
+        if (p_ < end_ && *p_ == c) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t len = std::strlen(word);
+        if (static_cast<size_t>(end_ - p_) < len || std::memcmp(p_, word, len) != 0) return false;
+        p_ += len;
+        return true;
+    }
+
+    // Whether the next value starts with c, without consuming it
+    bool peek(char c) {
+        ws();
+        return p_ < end_ && *p_ == c;
+    }
+
+    bool digits() {
+        const char* start = p_;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') ++p_;
+        return p_ != start;
+    }
+
+    // Steps over one UTF-8 sequence, rejecting overlong forms, surrogates
+    // and code points past U+10FFFF as a JSON parser must
+    bool utf8() {
+        auto c = static_cast<unsigned char>(*p_);
+        int extra;
+        unsigned char low = 0x80, high = 0xbf;  // Bounds for the second byte
+        if (c >= 0xc2 && c <= 0xdf) extra = 1;
+        else if (c == 0xe0) extra = 2, low = 0xa0;
+        else if (c == 0xed) extra = 2, high = 0x9f;
+        else if (c >= 0xe1 && c <= 0xef) extra = 2;
+        else if (c == 0xf0) extra = 3, low = 0x90;
+        else if (c == 0xf4) extra = 3, high = 0x8f;
+        else if (c >= 0xf1 && c <= 0xf3) extra = 3;
+        else return false;
+        if (end_ - p_ <= extra) return false;
+        for (int i = 1; i <= extra; ++i) {
+            auto next = static_cast<unsigned char>(p_[i]);
+            if (next < (i == 1 ? low : 0x80) || next > (i == 1 ? high : 0xbf)) return false;
+        }
+        p_ += extra + 1;
+        return true;
+    }
+
+    bool hex4(unsigned long& value) {
+        if (end_ - p_ < 4) return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p_++;
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= static_cast<unsigned long>(c - '0');
+            else if (c >= 'a' && c <= 'f') value |= static_cast<unsigned long>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') value |= static_cast<unsigned long>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    // Reads a string, appending its decoded text to out when non-null
+    bool string(std::string* out) {
+        if (!consume('"')) return false;
+        while (p_ < end_) {
+            // Copy the run up to the next quote or escape in one go
+            const char* run = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') {
+                auto c = static_cast<unsigned char>(*p_);
+                if (c < 0x20) return false;
+                if (c < 0x80) {
+                    ++p_;
+                } else if (!utf8()) {
+                    return false;
+                }
+            }
+            if (out) out->append(run, static_cast<size_t>(p_ - run));
+            if (p_ == end_) return false;
+            if (*p_++ == '"') return true;
+
+            if (p_ == end_) return false;
+            char esc = *p_++;
+            char decoded;
+            switch (esc) {
+                case '"': decoded = '"'; break;
+                case '\\': decoded = '\\'; break;
+                case '/': decoded = '/'; break;
+                case 'b': decoded = '\b'; break;
+                case 'f': decoded = '\f'; break;
+                case 'n': decoded = '\n'; break;
+                case 'r': decoded = '\r'; break;
+                case 't': decoded = '\t'; break;
+                case 'u': {
+                    unsigned long cp;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xd800 && cp < 0xdc00) {
+                        // A high surrogate must be followed by a low one
+                        if (end_ - p_ < 6 || p_[0] != '\\' || p_[1] != 'u') return false;
+                        p_ += 2;
+                        unsigned long low;
+                        if (!hex4(low) || low < 0xdc00 || low >= 0xe000) return false;
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    } else if (cp >= 0xdc00 && cp < 0xe000) {
+                        return false;  // Unpaired low surrogate
+                    }
+                    if (out) append_utf8(*out, cp);
+                    continue;
+                }
+                default:
+                    return false;
+            }
+            if (out) *out += decoded;
+        }
+        return false;
+    }
+
+    // Keys are usually plain ASCII and can be viewed in place
+    bool key(std::string_view& out) {
+        ws();
+        if (p_ >= end_ || *p_ != '"') return false;
+        const char* start = p_ + 1;
+        const char* close = start;
+        // Stops at escapes, control characters and non-ASCII bytes, which
+        // the full string reader validates
+        while (close < end_ && *close != '"' && *close >= 0x20 && *close != '\\') ++close;
+        if (close < end_ && *close == '"') {
+            p_ = close + 1;
+            out = std::string_view(start, static_cast<size_t>(close - start));
+            return true;
+        }
+        key_.clear();
+        if (!string(&key_)) return false;
+        out = key_;
+        return true;
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? as in RFC 8259; out
+    // receives the integer part
+    bool number(long* out) {
+        ws();
+        const char* start = p_;
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (p_ < end_ && *p_ == '0') {
+            ++p_;
+        } else if (p_ == end_ || *p_ < '1' || *p_ > '9' || !digits()) {
+            return false;
+        }
+        if (p_ < end_ && *p_ == '.') {
+            ++p_;
+            if (!digits()) return false;
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (!digits()) return false;
+        }
+        if (out) std::from_chars(start, p_, *out);
+        return true;
+    }
+
+    template <typename OnMember>
+    bool object(OnMember&& on_member) {
+        if (!consume('{')) return false;
+        if (consume('}')) return true;
+        do {
+            std::string_view name;
+            if (!key(name) || !consume(':')) return false;
+            if (!on_member(name)) return false;
+        } while (consume(','));
+        return consume('}');
+    }
+
+    template <typename OnElement>
+    bool array(OnElement&& on_element) {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        size_t index = 0;
+        do {
+            if (!on_element(index++)) return false;
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool skip(int depth) {
+        if (depth > kMaxDepth) return false;
+        ws();
+        if (p_ >= end_) return false;
+        switch (*p_) {
+            case '{': return object([&](std::string_view) { return skip(depth + 1); });
+            case '[': return array([&](size_t) { return skip(depth + 1); });
+            case '"': return string(nullptr);
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            default: return number(nullptr);
+        }
+    }
+
+    // Values of an unexpected type are well-formed JSON too; they are
+    // stepped over so the field reads as absent
+    bool optional_string(std::string& out) {
+        return peek('"') ? string(&out) : skip(0);
+    }
+
+    bool optional_number(long& out) {
+        return peek('-') || (p_ < end_ && *p_ >= '0' && *p_ <= '9') ? number(&out) : skip(0);
+    }
+
+    bool choices(CompletionFields& out) {
+        if (!peek('[')) return skip(0);
+        return array([&](size_t index) {
+            if (index > 0 || !peek('{')) return skip(0);
+            out.has_choices = true;
+            return object([&](std::string_view key) {
+                if (key == "message" || key == "delta") {
+                    if (!peek('{')) return skip(0);
+                    return object([&](std::string_view field) {
+                        if (field == "content") return optional_string(out.content);
+                        return skip(0);
+                    });
+                }
+                if (key == "finish_reason") return optional_string(out.finish_reason);
+                return skip(0);
+            });
+        });
+    }
+
+    bool usage(Usage& out) {
+        if (!peek('{')) return skip(0);
+        out.present = true;
+        return object([&](std::string_view key) {
+            if (key == "prompt_tokens") return optional_number(out.prompt_tokens);
+            if (key == "completion_tokens") return optional_number(out.completion_tokens);
+            if (key == "total_tokens") return optional_number(out.total_tokens);
+            return skip(0);
+        });
+    }
+};
+
+} // namespace
+
+void CompletionFields::clear() {
+    content.clear();
+    finish_reason.clear();
+    usage = Usage{};
+    has_choices = false;
+}
+
+void append_json_string(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out.append(value.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+        }
+    }
+    out.append(value.data() + run, value.size() - run);
+    out += '"';
+}
+
+void write_chat_request(std::string& out, const ChatRequest& request) {
+    // Worst case every character is escaped as \u00XX; typical prompts need
+    // only a few, so this is one allocation for the whole body.
+    out.clear();
+    size_t text = request.system_message.size() + request.user_message.size();
+    for (const auto& message : request.history) {
+        text += message.content.size() + 32;
+    }
+    out.reserve(request.model.size() + text * 11 / 10 + 192);
+
+    char number[32];
+    out += "{\"model\":";
+    append_json_string(out, request.model);
+    out += ",\"messages\":[{\"role\":\"system\",\"content\":";
+    append_json_string(out, request.system_message);
+    for (const auto& message : request.history) {
+        out += "},{\"role\":";
+        append_json_string(out, message.role);
+        out += ",\"content\":";
+        append_json_string(out, message.content);
+    }
+    out += "},{\"role\":\"user\",\"content\":";
+    append_json_string(out, request.user_message);
+    out += "}],\"max_tokens\":";
+    out.append(number, std::to_chars(number, number + sizeof(number), request.max_tokens).ptr);
+    out += ",\"temperature\":";
+    // Shortest round-trip form, with a '.' whatever the locale
+    out.append(number, std::to_chars(number, number + sizeof(number), request.temperature).ptr);
+    if (request.stream) {
+        // Streamed answers only carry token usage when asked for it
+        out += ",\"stream\":true,\"stream_options\":{\"include_usage\":true}";
+    }
+    out += '}';
+}
+
+bool extract_completion(std::string_view body, CompletionFields& out) {
+    return Scanner(body).document(out);
+}
+
+} // namespace neuron
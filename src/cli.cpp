@@ -1,31 +1,260 @@
 #include "neuron/cli.hpp"
+#include "neuron/batch.hpp"
+#include "neuron/chat_json.hpp"
+#include "neuron/conversation.hpp"
+#include "neuron/daemon.hpp"
+#include "neuron/directory_context.hpp"
+#include "neuron/ingest.hpp"
+#include "neuron/metrics.hpp"
+#include "neuron/paths.hpp"
+#include "neuron/trace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <ctime>
 #include <cxxopts.hpp>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
 
 namespace neuron {
 
+namespace {
+
+// Explanation requested while the user is still reading the command. Goes
+// through the daemon if it answered the RUN request, otherwise through the
+// in-process client, whose pool still holds the connection just used.
+class ExplainPrefetch {
+public:
+    ExplainPrefetch(AIClient& client, const std::string& prompt)
+        : pending_(client.start(prompt, Mode::TELL)) {}
+
+    ExplainPrefetch(const std::string& socket_path, std::chrono::milliseconds timeout, std::string prompt,
+                    CachePolicy policy)
+        : daemon_(std::make_unique<DaemonClient>(socket_path, timeout)) {
+        worker_ = std::thread([this, prompt = std::move(prompt), policy] {
+            reply_ = daemon_->run(prompt, Mode::TELL, policy, nullptr);
+        });
+    }
+
+    ~ExplainPrefetch() { cancel(); }
+
+    // Sets fallback when the daemon went away and the caller should ask again
+    std::optional<std::string> get(bool& fallback) {
+        fallback = false;
+        if (pending_) return pending_->get();
+
+        {
+            TraceSpan span("background wait", "daemon");
+            if (worker_.joinable()) worker_.join();
+        }
+        if (!reply_) {
+            fallback = true;
+            return std::nullopt;
+        }
+        if (!reply_->content) {
+            std::cerr << reply_->error << std::endl;
+        }
+        return reply_->content;
+    }
+
+    void cancel() {
+        if (pending_) pending_->cancel();
+        if (daemon_) daemon_->cancel();
+        if (worker_.joinable()) worker_.join();
+    }
+
+private:
+    std::unique_ptr<PendingRequest> pending_;
+    std::unique_ptr<DaemonClient> daemon_;
+    std::optional<DaemonReply> reply_;
+    std::thread worker_;
+};
+
+// End of a command's output for a follow-up prompt: terminal escapes and
+// carriage returns removed, cut to whole lines within max_bytes
+std::string prompt_tail(const std::string& output, size_t max_bytes) {
+    std::string clean;
+    clean.reserve(output.size());
+    for (size_t i = 0; i < output.size(); ++i) {
+        char c = output[i];
+        if (c == '\033' && i + 1 < output.size() && output[i + 1] == '[') {
+            i += 2;
+            while (i < output.size() && !(output[i] >= '@' && output[i] <= '~')) ++i;
+            continue;
+        }
+        if (c != '\r') clean += c;
+    }
+    if (clean.size() > max_bytes) {
+        size_t start = clean.find('\n', clean.size() - max_bytes);
+        clean.erase(0, start == std::string::npos ? clean.size() - max_bytes : start + 1);
+    }
+    while (!clean.empty() && (clean.back() == '\n' || clean.back() == ' ')) clean.pop_back();
+    return clean;
+}
+
+// The first line of text, cut to max_bytes for one-line listings
+std::string first_line(std::string_view text, size_t max_bytes) {
+    std::string line(text.substr(0, text.find('\n')));
+    if (line.size() > max_bytes) line = line.substr(0, max_bytes - 3) + "...";
+    return line;
+}
+
+// Runs a callable when the scope ends, however it ends
+template <typename F>
+class ScopeExit {
+public:
+    explicit ScopeExit(F f) : f_(std::move(f)) {}
+    ~ScopeExit() { f_(); }
+
+    ScopeExit(const ScopeExit&) = delete;
+    ScopeExit& operator=(const ScopeExit&) = delete;
+
+private:
+    F f_;
+};
+
+uint32_t elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+// "30m", "12h", "7d", "2w" ago, or a local "YYYY-MM-DD[ HH:MM]"; -1 if unreadable
+int64_t parse_when(const std::string& text) {
+    char unit = text.empty() ? '\0' : text.back();
+    if (std::strchr("mhdw", unit) && text.size() > 1 &&
+        std::all_of(text.begin(), text.end() - 1, [](unsigned char c) { return std::isdigit(c); })) {
+        int64_t count = 0;
+        const char* last = text.data() + text.size() - 1;
+        auto [ptr, error] = std::from_chars(text.data(), last, count);
+        if (error != std::errc() || ptr != last) return -1;
+        int64_t unit_us = int64_t{1000000} * (unit == 'm' ? 60 : unit == 'h' ? 3600 : unit == 'd' ? 86400 : 604800);
+        auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        // Further back than the epoch is everything
+        return count > now / unit_us ? 0 : now - count * unit_us;
+    }
+
+    std::tm tm{};
+    const char* end = strptime(text.c_str(), "%Y-%m-%d", &tm);
+    if (!end) return -1;
+    if (*end == ' ' || *end == 'T') end = strptime(end + 1, "%H:%M", &tm);
+    if (!end || *end) return -1;
+    tm.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&tm)) * 1000000;
+}
+
+std::string format_time(int64_t time_us, const char* format, bool utc) {
+    std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+    std::tm tm{};
+    if (utc) {
+        gmtime_r(&seconds, &tm);
+    } else {
+        localtime_r(&seconds, &tm);
+    }
+    char text[32];
+    std::strftime(text, sizeof(text), format, &tm);
+    return text;
+}
+
+// Case-insensitive; needle must already be lowercase
+bool contains_folded(std::string_view haystack, std::string_view needle) {
+    return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == b;
+    }) != haystack.end();
+}
+
+std::string format_seconds(std::chrono::microseconds duration) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2fs", static_cast<double>(duration.count()) / 1e6);
+    return text;
+}
+
+void print_version() {
+    std::cout << "Neuron AI v1.0.0\n"
+              << "AI-powered command-line assistant" << std::endl;
+}
+
+} // namespace
+
 CLI::CLI(int argc, char** argv)
     : argc_(argc), argv_(argv) {}
 
 int CLI::run() {
+    // --trace prints a per-phase breakdown on exit, --trace=FILE writes a Chrome trace
+    for (int i = 1; i < argc_; ++i) {
+        std::string_view arg = argv_[i];
+        if (arg == "--trace" || arg.rfind("--trace=", 0) == 0) {
+            Tracer::global().enable();
+            trace_path_ = arg.size() > 8 ? std::string(arg.substr(8)) : "";
+        }
+    }
+
+    int exit_code = dispatch();
+    Metrics::global().flush();
+
+    if (Tracer::global().enabled()) {
+        if (trace_path_.empty()) {
+            Tracer::global().print_summary(std::cerr);
+        } else if (Tracer::global().write_chrome_trace(trace_path_)) {
+            std::cerr << "\033[2;37m⏱  Trace written to " << trace_path_ << "\033[0m" << std::endl;
+        } else {
+            std::cerr << "Error: cannot write trace to " << trace_path_ << std::endl;
+        }
+    }
+    return exit_code;
+}
+
+int CLI::dispatch() {
+    // Scripts call this often; answer before building the option parser
+    if (argc_ == 2 && (std::string_view(argv_[1]) == "--version" || std::string_view(argv_[1]) == "-v")) {
+        print_version();
+        return 0;
+    }
+
     if (argc_ >= 3 && std::string(argv_[1]) == "run") {
         // check for --yes or -y flag
-        bool auto_execute = false;
-        for (int i = 2; i < argc_; ++i) {
-            if (std::string(argv_[i]) == "--yes" || std::string(argv_[i]) == "-y") {
-                auto_execute = true;
-                break;
-            }
-        }
+        bool auto_execute = has_flag(2, {"--yes", "-y"});
+        bool offline = has_flag(2, {"--offline"});
+        parse_cache_flags(2);
+        if (!offline) start_preconnect();
 
         std::string command = join_args(2);
-        return handle_run(command, auto_execute);
+        return handle_run(command, auto_execute, offline);
     }
 
     if (argc_ >= 3 && std::string(argv_[1]) == "tell") {
+        // Only when asked, so a tell inside a `while read` loop leaves the loop's input alone
+        bool read_stdin = has_flag(2, {"-", "--stdin"});
+        parse_cache_flags(2);
+        start_preconnect();
         std::string command = join_args(2);
-        return handle_tell(command);
+        return handle_tell(command, read_stdin);
+    }
+
+    if (argc_ >= 2 && std::string(argv_[1]) == "chat") {
+        parse_cache_flags(2);
+        return handle_chat();
+    }
+
+    if (argc_ >= 2 && std::string(argv_[1]) == "batch") {
+        parse_cache_flags(2);
+        return handle_batch(2);
+    }
+
+    if (argc_ >= 2 && std::string(argv_[1]) == "history") {
+        return handle_history(2);
+    }
+
+    if (argc_ >= 2 && std::string(argv_[1]) == "daemon") {
+        return handle_daemon(argc_ >= 3 ? argv_[2] : "");
     }
 
     if (argc_ >= 2 && std::string(argv_[1]) == "setup") {
@@ -46,13 +275,17 @@ int CLI::run() {
             ("v,version", "Print version")
             ("m,mode", "Mode: run or tell", cxxopts::value<std::string>())
             ("p,prompt", "Prompt to send", cxxopts::value<std::string>())
-            ("y,yes", "Auto execute the command without confirmation");
+            ("y,yes", "Auto execute the command without confirmation")
+            ("no-cache", "Bypass the response cache")
+            ("refresh", "Ignore cached responses but store the new one")
+            ("offline", "Answer run prompts from the local command index only")
+            ("trace", "Print a timing breakdown, or write a Chrome trace with --trace=FILE",
+             cxxopts::value<std::string>()->implicit_value(""));
 
         auto result = options.parse(argc_, argv_);
 
         if (result.count("version")) {
-            std::cout << "Neuron AI v1.0.0" << std::endl;
-            std::cout << "AI-powered command-line assistant" << std::endl;
+            print_version();
             return 0;
         }
 
@@ -65,6 +298,13 @@ int CLI::run() {
             std::cout << "  \033[1;36mneuron run\033[0m \"find large files\"          \033[2;37m# Generate & execute commands\033[0m" << std::endl;
             std::cout << "  \033[1;36mneuron run\033[0m \"install docker\" \033[1;33m--yes\033[0m     \033[2;37m# Auto-execute without confirmation\033[0m" << std::endl;
             std::cout << "  \033[1;36mneuron tell\033[0m \"explain git rebase\"       \033[2;37m# Get explanations\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron tell\033[0m \033[1;33m-\033[0m \"why did it fail\" < build.log \033[2;37m# Ask about input read from stdin\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron chat\033[0m                            \033[2;37m# Interactive session that remembers earlier turns\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron daemon\033[0m                           \033[2;37m# Keep warm connections for faster calls\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron history\033[0m docker \033[1;33m--since 7d\033[0m        \033[2;37m# Search past requests (--json to export)\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron batch\033[0m prompts.jsonl \033[1;33m-j 16\033[0m       \033[2;37m# Run a JSONL file of prompts concurrently\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron run\033[0m \"show disk usage\" \033[1;33m--refresh\033[0m    \033[2;37m# Skip cached answer (or --no-cache)\033[0m" << std::endl;
+            std::cout << "  \033[1;36mneuron run\033[0m \"show disk usage\" \033[1;33m--offline\033[0m    \033[2;37m# Answer from the local command index, no network\033[0m" << std::endl;
             std::cout << std::endl;
             std::cout << "\033[1;32mLegacy flag syntax:\033[0m" << std::endl;
             std::cout << options.help() << std::endl;
@@ -79,11 +319,17 @@ int CLI::run() {
         std::string mode_str = result["mode"].as<std::string>();
         std::string prompt = result["prompt"].as<std::string>();
         bool auto_execute = result.count("yes") > 0;
+        bool offline = result.count("offline") > 0;
+        if (result.count("no-cache")) {
+            cache_policy_ = CachePolicy::DISABLED;
+        } else if (result.count("refresh")) {
+            cache_policy_ = CachePolicy::REFRESH;
+        }
 
         if (mode_str == "run") {
-            return handle_run(prompt, auto_execute);
+            return handle_run(prompt, auto_execute, offline);
         } else if (mode_str == "tell") {
-            return handle_tell(prompt);
+            return handle_tell(prompt, false);
         } else {
             std::cerr << "Invalid mode: " << mode_str << std::endl;
             return 1;
@@ -96,42 +342,288 @@ int CLI::run() {
 
 std::string CLI::join_args(int start_index) const {
     std::ostringstream ss;
+    bool first = true;
     for (int i = start_index; i < argc_; ++i) {
-        // skip --yes or -y flags
-        if (std::string(argv_[i]) == "--yes" || std::string(argv_[i]) == "-y") {
+        // skip flags such as --yes or --no-cache
+        if (is_flag(argv_[i])) {
             continue;
         }
 
         // add other arguments to the prompt
-        if (i > start_index) {
+        if (!first) {
             ss << " ";
         }
         ss << argv_[i];
+        first = false;
     }
     return ss.str();
 }
 
-bool CLI::is_potentially_dangerous(const std::string& command) const {
-    std::vector<std::string> dangerous_patterns = {
-        "sudo", "rm -rf", "rm -r", "rm -f", "dd if=", "mkfs",
-        "fdisk", "format", "del /", "rmdir /s", "> /dev/"
+bool CLI::is_flag(const std::string& arg) const {
+    static const std::unordered_set<std::string> flags = {
+        "--yes", "-y", "--no-cache", "--refresh", "--trace", "--offline", "--stdin", "-"
     };
+    return flags.count(arg) > 0 || arg.rfind("--trace=", 0) == 0;
+}
 
-    for (const auto& pattern : dangerous_patterns) {
-        if (command.find(pattern) != std::string::npos) {
-            return true;
+bool CLI::has_flag(int start_index, std::initializer_list<std::string_view> names) const {
+    for (int i = start_index; i < argc_; ++i) {
+        for (auto name : names) {
+            if (argv_[i] == name) return true;
         }
     }
     return false;
 }
 
-int CLI::handle_run(const std::string& prompt, const bool auto_execute) {
-    neuron::Config config;
-    neuron::AIClient client(config);
+void CLI::parse_cache_flags(int start_index) {
+    if (has_flag(start_index, {"--no-cache"})) {
+        cache_policy_ = CachePolicy::DISABLED;
+    } else if (has_flag(start_index, {"--refresh"})) {
+        cache_policy_ = CachePolicy::REFRESH;
+    }
+}
+
+const Config& CLI::load_config() {
+    if (!config_) {
+        TraceSpan span("config", "setup");
+        config_ = std::make_unique<Config>();
+        Metrics::global().enable(MetricsOptions::from_config(*config_));
+    }
+    return *config_;
+}
+
+void CLI::start_preconnect() {
+    const Config& config = load_config();
+    if (!config.getFlag("NEURON_PRECONNECT", true)) return;
+
+    // A listening daemon already holds a warm connection
+    if (config.getFlag("NEURON_DAEMON", true) && access(daemon_socket_path(config).c_str(), F_OK) == 0) return;
+
+    preconnect_ = AIClient::preconnect(config);
+}
 
-    std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[2;37mis generating your command...\033[0m" << std::endl;
+const SafetyAnalyzer& CLI::safety(const Config& config) {
+    if (!safety_) {
+        TraceSpan span("safety rules", "setup");
+        safety_ = std::make_unique<SafetyAnalyzer>(config.getValue("NEURON_SAFETY_RULES").value_or(""));
+    }
+    return *safety_;
+}
+
+void CLI::print_race(const RaceResult& race) const {
+    size_t answered = 0;
+    for (const auto& candidate : race.candidates) {
+        if (candidate.command) ++answered;
+    }
+    const RaceCandidate& winner = race.candidates[*race.winner];
+    std::cout << "\033[2;37m🏁 " << winner.model << " (" << winner.latency.count() << "ms) ";
+    if (answered > 1) {
+        std::cout << "picked from " << race.candidates.size() << " requests; " << winner.agreeing << " of "
+                  << answered << " answers agree";
+    } else {
+        std::cout << "answered first of " << race.candidates.size() << " requests";
+    }
+    std::cout << "\033[0m" << std::endl;
+
+    // With several answers to choose from, show what the others said
+    if (answered < 2) return;
+    for (size_t i = 0; i < race.candidates.size(); ++i) {
+        const RaceCandidate& candidate = race.candidates[i];
+        std::cout << "\033[2;37m   " << (i == *race.winner ? "✓ " : candidate.command ? "· " : "✗ ")
+                  << candidate.model;
+        if (candidate.command) {
+            std::cout << " (" << candidate.latency.count() << "ms";
+            if (candidate.severity != Severity::NONE) std::cout << ", " << severity_name(candidate.severity);
+            std::cout << "): " << first_line(*candidate.command, 80);
+        } else {
+            std::cout << ": " << first_line(candidate.error, 80);
+        }
+        std::cout << "\033[0m" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+void CLI::print_safety_report(const SafetyReport& report) const {
+    if (report.findings.empty()) return;
+
+    if (!report.needs_confirmation()) {
+        for (const auto& finding : report.findings) {
+            std::cout << "\n\033[2;37mℹ️  " << finding.message << "\033[0m" << std::endl;
+        }
+        return;
+    }
+
+    std::cout << "\n\033[1;31m⚠️  WARNING (" << severity_name(report.severity) << "):\033[0m "
+              << report.findings.front().message << std::endl;
+    for (size_t i = 1; i < report.findings.size(); ++i) {
+        std::cout << "\033[2;37m   • " << report.findings[i].message << "\033[0m" << std::endl;
+    }
+    std::cout << "\033[2;37m   Please review carefully before proceeding.\033[0m\n" << std::endl;
+}
+
+OfflineIndex* CLI::offline_index() {
+    if (!offline_) {
+        std::string directory = cache_dir();
+        if (directory.empty()) return nullptr;
+        TraceSpan span("offline index", "setup");
+        try {
+            offline_ = std::make_unique<OfflineIndex>(directory, data_dir());
+        } catch (const std::exception& e) {
+            span.set_detail(e.what());
+            return nullptr;
+        }
+    }
+    return offline_.get();
+}
+
+void CLI::record_history(const Config& config, const HistoryEntry& entry) {
+    if (!history_) {
+        if (!config.getFlag("NEURON_HISTORY", true)) return;
+        std::string directory = data_dir();
+        if (directory.empty()) return;
+        history_ = std::make_unique<HistoryWriter>(history_path(directory));
+    }
+    history_->append(entry);
+}
+
+std::optional<OfflineMatch> CLI::offline_lookup(const Config& config, const std::string& prompt) {
+    OfflineIndex* index = offline_index();
+    if (!index) return std::nullopt;
+    TraceSpan span("offline lookup", "client");
+    float threshold = static_cast<float>(std::clamp(config.getDouble("NEURON_OFFLINE_THRESHOLD", 0.7), 0.0, 1.0));
+    return index->lookup(prompt, threshold);
+}
+
+CachePolicy CLI::daemon_policy(const Config& config) const {
+    // The daemon has its own config, so a disabled cache is passed along
+    if (cache_policy_ == CachePolicy::USE && !config.getFlag("NEURON_CACHE", true)) {
+        return CachePolicy::DISABLED;
+    }
+    return cache_policy_;
+}
+
+AIClient& CLI::in_process_client(const Config& config) {
+    if (!client_) {
+        client_ = std::make_unique<AIClient>(config);
+        if (preconnect_) client_->set_preconnect(preconnect_);
+        if (cache_policy_ != CachePolicy::USE) {
+            client_->set_cache_policy(cache_policy_);
+        }
+    }
+    return *client_;
+}
+
+std::optional<std::string> CLI::ask(const Config& config, const std::string& prompt, Mode mode,
+                                    const TokenCallback& on_token) {
+    last_from_cache_ = false;
+    last_from_daemon_ = false;
+    last_match_.reset();
+    last_race_.reset();
+
+    // Racing sends several requests from this process, so it skips the daemon
+    RaceOptions race = mode == Mode::RUN ? RaceOptions::from_config(config) : RaceOptions{};
+
+    std::string context;
+    if (mode == Mode::RUN) {
+        std::error_code ec;
+        context = collect_directory_context(std::filesystem::current_path(ec).string(),
+                                            ContextOptions::from_config(config));
+    }
+
+    // Forward to a resident daemon when one is listening
+    if (!race.enabled() && config.getFlag("NEURON_DAEMON", true)) {
+        TraceSpan span("daemon request", "daemon");
+        DaemonClient daemon(daemon_socket_path(config), daemon_timeout(config));
+        if (auto reply = daemon.run(prompt, mode, daemon_policy(config), on_token, context)) {
+            last_from_daemon_ = true;
+            if (!reply->content) {
+                std::cerr << reply->error << std::endl;
+                return std::nullopt;
+            }
+            last_from_cache_ = reply->cached;
+            last_match_ = reply->match;
+            return reply->content;
+        }
+        span.set_detail("no daemon answer");
+    }
+
+    in_process_client(config).set_context(context);
+
+    if (race.enabled()) {
+        if (race.strategy == RaceStrategy::RANK) race.safety = &safety(config);
+        RaceResult raced = RaceRunner(*client_, race).run(prompt, on_token);
+        if (!raced.command) std::cerr << raced.error << std::endl;
+        last_from_cache_ = raced.cached;
+        last_match_ = raced.match;
+        auto command = raced.command;
+        last_race_ = std::move(raced);
+        return command;
+    }
+
+    auto result = client_->run(prompt, mode, on_token);
+    last_from_cache_ = client_->last_from_cache();
+    last_match_ = client_->last_match();
+    return result;
+}
+
+int CLI::handle_run(const std::string& prompt, const bool auto_execute, const bool offline) {
+    const Config& config = load_config();
+
+    HistoryEntry entry;
+    entry.mode = Mode::RUN;
+    entry.prompt = prompt;
+    ScopeExit record([&] { record_history(config, entry); });
+
+    // A local answer costs microseconds, so it is ready before the first byte
+    // of the network one; --offline stops there
+    std::optional<OfflineMatch> local;
+    if (offline || config.getFlag("NEURON_OFFLINE_SUGGEST", true)) {
+        local = offline_lookup(config, prompt);
+    }
+
+    bool streamed = false;
+    bool from_offline = false;
+    std::optional<std::string> result;
+    if (offline) {
+        if (!local) {
+            entry.offline = true;
+            std::cout << "\n\033[1;31m📴 No offline answer for this request\033[0m" << std::endl;
+            std::cout << "\033[2;37m💡 Run it once without --offline; commands you run are remembered.\033[0m" << std::endl;
+            return 1;
+        }
+        result = local->command;
+        from_offline = true;
+    } else {
+        std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[2;37mis generating your command...\033[0m" << std::endl;
+        if (local) {
+            std::cout << "\033[2;37m📴 Offline suggestion:\033[0m \033[36m" << local->command << "\033[0m" << std::endl;
+        }
+
+        // Print the command as it streams in
+        auto asked = std::chrono::steady_clock::now();
+        result = ask(config, prompt, neuron::Mode::RUN, [&](std::string_view token) {
+            if (!streamed) {
+                std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[1;32mgenerated command:\033[0m\n" << std::endl;
+                std::cout << "\033[1;36m";
+                streamed = true;
+            }
+            std::cout << token << std::flush;
+        });
+        if (streamed) {
+            std::cout << "\033[0m" << std::endl << std::endl;
+        }
+        entry.latency_ms = elapsed_ms(asked);
+        entry.cached = last_from_cache_ || last_match_.has_value();
+        entry.daemon = last_from_daemon_;
+
+        // No network answer: the local one is better than none
+        if (!result && local) {
+            std::cout << "\n\033[1;33m⚠️  Neuron AI is unreachable; using the offline suggestion\033[0m" << std::endl;
+            result = local->command;
+            from_offline = true;
+        }
+    }
 
-    auto result = client.run(prompt, neuron::Mode::RUN);
     if (!result) {
         std::cout << "\n\033[1;31m❌ Failed to get response from Neuron AI\033[0m" << std::endl;
         std::cout << "\033[2;37m💡 Possible issues:\033[0m" << std::endl;
@@ -142,34 +634,84 @@ int CLI::handle_run(const std::string& prompt, const bool auto_execute) {
     }
 
     std::string command = result.value();
+    entry.response = command;
+    entry.offline = from_offline;
+    if (from_offline) {
+        int percent = static_cast<int>(local->similarity * 100.0f + 0.5f);
+        std::cout << "\n\033[2;37m📴 Offline answer (" << percent << "% match for \"" << local->prompt << "\")\033[0m" << std::endl;
+    } else if (last_match_) {
+        int percent = static_cast<int>(last_match_->similarity * 100.0f + 0.5f);
+        std::cout << "\033[2;37m⚡ Cached match for a similar request (" << percent << "%): \""
+                  << last_match_->prompt << "\" (use --refresh for a new one)\033[0m\n" << std::endl;
+    } else if (last_from_cache_) {
+        std::cout << "\033[2;37m⚡ Cached response (use --refresh for a new one)\033[0m\n" << std::endl;
+    }
     
     // Enhanced output with better formatting
-    std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[1;32mgenerated command:\033[0m\n" << std::endl;
-    std::cout << "\033[1;36m" << command << "\033[0m" << std::endl << std::endl;
+    if (!streamed) {
+        std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[1;32mgenerated command:\033[0m\n" << std::endl;
+        std::cout << "\033[1;36m" << command << "\033[0m" << std::endl << std::endl;
+    }
     
+    if (last_race_ && !last_race_->candidates.empty()) {
+        print_race(*last_race_);
+    }
+
     // Show command breakdown if it's complex
     if (command.find('|') != std::string::npos || command.find("&&") != std::string::npos) {
         std::cout << "\n\033[2;37m💡 This command chains multiple operations\033[0m" << std::endl;
     }
 
     // Check for potentially dangerous commands
-    bool is_dangerous = is_potentially_dangerous(command);
-    
-    if (!auto_execute || is_dangerous) {
-        if (is_dangerous) {
-            std::cout << "\n\033[1;31m⚠️  WARNING:\033[0m This command might be destructive or require elevated privileges." << std::endl;
-            std::cout << "\033[2;37m   Please review carefully before proceeding.\033[0m\n" << std::endl;
+    SafetyReport report;
+    {
+        TraceSpan span("safety check", "client");
+        report = safety(config).analyze(command);
+    }
+    bool is_dangerous = report.needs_confirmation();
+    print_safety_report(report);
+
+    // A command remembered for a similar request may not do what this one
+    // asks, so --yes does not run it unseen
+    bool approximate = from_offline || last_match_.has_value();
+    if (auto_execute && approximate && !is_dangerous) {
+        std::cout << "\033[2;37m💡 Answered from " << (from_offline ? "the offline index" : "a similar request")
+                  << ", so --yes does not apply\033[0m" << std::endl;
+    }
+
+    if (!auto_execute || is_dangerous || approximate) {
+
+        // Fetch the explanation while the user reads the command, so "e" shows it at once
+        const std::string explain_prompt = "Explain this command: " + command;
+        std::unique_ptr<ExplainPrefetch> prefetch;
+        if (is_dangerous || config.getFlag("NEURON_PREFETCH_EXPLAIN", false)) {
+            if (last_from_daemon_) {
+                prefetch = std::make_unique<ExplainPrefetch>(daemon_socket_path(config), daemon_timeout(config),
+                                                             explain_prompt, daemon_policy(config));
+            } else if (client_) {
+                prefetch = std::make_unique<ExplainPrefetch>(*client_, explain_prompt);
+            }
         }
         
         std::cout << "\033[1;33mExecute this command?\033[0m \033[2;37m[y/N/e(xplain)]\033[0m: ";
         std::string choice;
-        std::getline(std::cin, choice);
+        {
+            TraceSpan span("confirmation", "user");
+            std::getline(std::cin, choice);
+        }
 
         if (choice == "e" || choice == "explain") {
             std::cout << "\n\033[1;34m📚 Command Explanation:\033[0m" << std::endl;
             // Try to get explanation from AI
-            neuron::AIClient explain_client(config);
-            auto explanation = explain_client.run("Explain this command: " + command, neuron::Mode::TELL);
+            std::optional<std::string> explanation;
+            bool fallback = true;
+            if (prefetch) {
+                explanation = prefetch->get(fallback);
+                prefetch.reset();
+            }
+            if (fallback) {
+                explanation = ask(config, explain_prompt, neuron::Mode::TELL);
+            }
             if (explanation) {
                 std::cout << explanation.value() << std::endl;
             } else {
@@ -179,6 +721,9 @@ int CLI::handle_run(const std::string& prompt, const bool auto_execute) {
             std::getline(std::cin, choice);
         }
 
+        // Answered without asking for it; drop the explanation in flight
+        prefetch.reset();
+
         if (choice != "y" && choice != "yes" && choice != "Y" && choice != "YES") {
             std::cout << "\n\033[2;37m🚫 Command execution cancelled.\033[0m" << std::endl;
             return 0;
@@ -186,41 +731,573 @@ int CLI::handle_run(const std::string& prompt, const bool auto_execute) {
     }
 
     std::cout << "\n\033[1;32m🚀 Executing...\033[0m" << std::endl;
+    ExecResult execution = execute(config, command);
+    entry.executed = execution.started;
+    entry.exit_code = execution.exit_code;
+    if (!execution.started) {
+        return 1;
+    }
+
+    if (execution.succeeded()) {
+        std::cout << "\033[1;32m✅ Command completed successfully!\033[0m" << std::endl;
+
+        // Remembered for --offline and for suggestions on similar prompts
+        if (!from_offline && config.getFlag("NEURON_OFFLINE_LEARN", true)) {
+            if (OfflineIndex* index = offline_index()) {
+                try {
+                    index->add(prompt, command);
+                } catch (const std::exception&) {
+                    // Not worth failing a successful run over
+                }
+            }
+        }
+    } else {
+        diagnose_failure(config, command, execution);
+    }
+
+    return 0;
+}
+
+ExecResult CLI::execute(const Config& config, const std::string& command) {
+    ExecOptions options;
+    options.timeout = std::chrono::seconds(std::max(0L, config.getLong("NEURON_EXEC_TIMEOUT", 0)));
+    options.capture_bytes = static_cast<size_t>(std::max(1L, config.getLong("NEURON_CAPTURE_KB", 64))) * 1024;
+
     std::cout << "\033[2;37m" << std::string(50, '-') << "\033[0m" << std::endl;
-    
-    int exit_code = std::system(command.c_str());
-    
+    ExecResult result;
+    {
+        TraceSpan span("execute", "command");
+        result = execute_command(command, options);
+    }
     std::cout << "\033[2;37m" << std::string(50, '-') << "\033[0m" << std::endl;
 
-    if (exit_code != 0) {
-        std::cout << "\033[1;31m❌ Command failed\033[0m \033[2;37m(exit code: " << exit_code << ")\033[0m" << std::endl;
+    if (!result.started) {
+        std::cout << "\033[1;31m❌ Could not start command:\033[0m " << result.error << std::endl;
+        return result;
+    }
+
+    std::cout << "\033[2;37m⏱  " << format_seconds(result.wall) << " wall, " << format_seconds(result.user_cpu)
+              << " user, " << format_seconds(result.system_cpu) << " sys, "
+              << (result.max_rss_kb + 512) / 1024 << " MB max RSS\033[0m" << std::endl;
+    return result;
+}
+
+void CLI::diagnose_failure(const Config& config, const std::string& command, const ExecResult& result) {
+    std::string reason;
+    if (result.timed_out) {
+        reason = "timed out after " + std::to_string(config.getLong("NEURON_EXEC_TIMEOUT", 0)) + "s";
+    } else if (result.signal) {
+        reason = std::string("killed by ") + strsignal(result.signal);
+    } else {
+        reason = "exit code: " + std::to_string(result.exit_code);
+    }
+    std::cout << "\033[1;31m❌ Command failed\033[0m \033[2;37m(" << reason << ")\033[0m" << std::endl;
+
+    // Only offer to ask when someone is there to answer
+    if (!isatty(STDIN_FILENO)) {
         std::cout << "\n\033[1;33m💡 Tip:\033[0m Try asking Neuron: \033[2;37m\"why did this command fail?\"\033[0m" << std::endl;
+        return;
+    }
+    std::cout << "\n\033[1;33mAsk Neuron why it failed?\033[0m \033[2;37m[y/N]\033[0m: ";
+    std::string choice;
+    std::getline(std::cin, choice);
+    if (choice != "y" && choice != "yes" && choice != "Y" && choice != "YES") return;
+
+    // The captured output goes along so the answer can be specific
+    std::string prompt = "I ran this shell command and it failed (" + reason + "):\n" + command + "\n";
+    std::string output = prompt_tail(result.output_tail, 4096);
+    if (output.empty()) {
+        prompt += "\nIt printed nothing.\n";
     } else {
-        std::cout << "\033[1;32m✅ Command completed successfully!\033[0m" << std::endl;
+        prompt += "\nThe end of its output was:\n" + output + "\n";
     }
+    prompt += "\nWhat went wrong, and how do I fix it?";
 
-    return 0;
+    bool streamed = false;
+    auto answer = ask(config, prompt, Mode::TELL, [&](std::string_view token) {
+        if (!streamed) {
+            std::cout << "\n\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl;
+            streamed = true;
+        }
+        std::cout << token << std::flush;
+    });
+    if (!answer) {
+        std::cout << "\nUnable to get an answer at this time." << std::endl;
+        return;
+    }
+    if (!streamed) {
+        std::cout << "\n\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl << *answer;
+    }
+    std::cout << std::endl << "\033[2;37m" << std::string(60, '-') << "\033[0m\n" << std::endl;
 }
 
-int CLI::handle_tell(const std::string& prompt) {
-    neuron::Config config;
-    neuron::AIClient client(config);
+int CLI::handle_tell(const std::string& prompt, bool read_stdin) {
+    const Config& config = load_config();
 
     std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[2;37mis thinking...\033[0m" << std::endl;
     
-    auto result = client.run(prompt, neuron::Mode::TELL);
+    // Stream the explanation straight to the terminal
+    bool streamed = false;
+    auto on_token = [&](std::string_view token) {
+        if (!streamed) {
+            std::cout << "\n\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl;
+            streamed = true;
+        }
+        std::cout << token << std::flush;
+    };
+    auto asked = std::chrono::steady_clock::now();
+
+    // Input read with - or --stdin is what the question is about. One part
+    // goes along with the question; more are mapped and reduced in this process.
+    std::optional<std::string> result;
+    std::string parts_summary;
+    if (read_stdin) {
+        IngestOptions ingest = IngestOptions::from_config(config);
+        ChunkReader reader(std::cin, ingest.chunk_tokens * 4);
+        std::optional<Chunk> first;
+        {
+            TraceSpan span("stdin read", "setup");
+            first = reader.next();
+        }
+        if (!first) {
+            result = ask(config, prompt, Mode::TELL, on_token);
+        } else if (reader.done()) {
+            result = ask(config, stdin_question(prompt, first->text), Mode::TELL, on_token);
+        } else {
+            AIClient* client = nullptr;
+            try {
+                client = &in_process_client(config);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            IngestRunner runner(*client, ingest);
+            result = runner.run(prompt, std::move(*first), reader, on_token);
+            parts_summary = "📄 Read " + std::to_string(reader.bytes_read() / 1024) + " KB in " +
+                            std::to_string(runner.parts()) + " parts";
+            if (runner.merges() > 0) parts_summary += ", notes merged " + std::to_string(runner.merges()) + "x";
+            if (runner.failed() > 0) parts_summary += "; " + std::to_string(runner.failed()) + " failed and were left out";
+            if (runner.dropped() > 0) parts_summary += "; " + std::to_string(runner.dropped()) + " notes dropped when merging failed";
+        }
+    } else {
+        result = ask(config, prompt, Mode::TELL, on_token);
+    }
+
+    HistoryEntry entry;
+    entry.mode = Mode::TELL;
+    entry.prompt = prompt;
+    entry.response = result.value_or("");
+    entry.latency_ms = elapsed_ms(asked);
+    entry.cached = last_from_cache_;
+    entry.daemon = last_from_daemon_;
+    record_history(config, entry);
+
     if (result.has_value()) {
-        std::cout << "\n\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl;
-        std::cout << result.value() << std::endl;
-        std::cout << "\033[2;37m" << std::string(60, '-') << "\033[0m\n" << std::endl;
+        if (!streamed) {
+            std::cout << "\n\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl;
+            std::cout << result.value();
+        }
+        std::cout << std::endl;
+        std::cout << "\033[2;37m" << std::string(60, '-') << "\033[0m" << std::endl;
+        if (!parts_summary.empty()) std::cout << "\033[2;37m" << parts_summary << "\033[0m" << std::endl;
+        std::cout << std::endl;
         return 0;
     } else {
+        if (streamed) {
+            std::cout << std::endl;
+        }
         std::cout << "\n\033[1;31m❌ Failed to get response from Neuron AI\033[0m" << std::endl;
         std::cout << "\033[2;37m💡 Check your internet connection and API key\033[0m" << std::endl;
         return 1;
     }
 }
 
+int CLI::handle_chat() {
+    const Config& config = load_config();
+    try {
+        client_ = std::make_unique<AIClient>(config);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (cache_policy_ != CachePolicy::USE) {
+        client_->set_cache_policy(cache_policy_);
+    }
+
+    // One client for the whole session, so every turn after the first
+    // reuses its connection; history stays within the token budget
+    Conversation conversation(static_cast<size_t>(std::max(256L, config.getLong("NEURON_CHAT_TOKEN_BUDGET", 3000))));
+    Conversation::Summarizer summarize;
+    if (config.getFlag("NEURON_CHAT_SUMMARIZE", true)) {
+        summarize = [&](const std::string& text) {
+            return client_->run("Summarize this conversation in a few sentences for your own later reference. "
+                                "Keep commands, file names, paths and decisions; drop pleasantries.\n\n" + text,
+                                Mode::TELL);
+        };
+    }
+
+    std::cout << "\n\033[1;35m🧬 Neuron AI\033[0m \033[2;37mchat session. Ask a question, or start a line with\033[0m" << std::endl;
+    std::cout << "\033[2;37m   /run (or !) to get a command. /clear forgets the history, /history shows it, /exit quits.\033[0m\n" << std::endl;
+
+    std::string line;
+    while (true) {
+        std::cout << "\033[1;35m🧬 ›\033[0m " << std::flush;
+        if (!std::getline(std::cin, line)) {
+            std::cout << std::endl;
+            break;
+        }
+
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) continue;
+        line.erase(0, start);
+
+        if (line == "/exit" || line == "/quit") break;
+        if (line == "/clear") {
+            conversation.clear();
+            std::cout << "\033[2;37m🧹 History cleared\033[0m\n" << std::endl;
+            continue;
+        }
+        if (line == "/history") {
+            if (!conversation.summary().empty()) {
+                std::cout << "\033[2;37m📝 " << conversation.summary() << "\033[0m" << std::endl;
+            }
+            for (const auto& message : conversation.messages()) {
+                if (message.role == "system") continue;
+                std::cout << (message.role == "user" ? "\033[1;33m› \033[0m" : "\033[2;37m  ") << message.content
+                          << "\033[0m" << std::endl;
+            }
+            std::cout << "\033[2;37m" << conversation.turns() << " turn(s), ~" << conversation.tokens() << " of "
+                      << conversation.budget() << " tokens\033[0m\n" << std::endl;
+            continue;
+        }
+
+        Mode mode = Mode::TELL;
+        std::string input = line;
+        if (input.rfind("/run ", 0) == 0) {
+            mode = Mode::RUN;
+            input.erase(0, 5);
+        } else if (input[0] == '!') {
+            mode = Mode::RUN;
+            input.erase(0, 1);
+        } else if (input.rfind("/tell ", 0) == 0) {
+            input.erase(0, 6);
+        } else if (input[0] == '/') {
+            std::cout << "\033[2;37mCommands: /run <request>, /tell <question>, /history, /clear, /exit\033[0m\n" << std::endl;
+            continue;
+        }
+
+        auto history = conversation.messages();
+        bool streamed = false;
+        auto asked = std::chrono::steady_clock::now();
+        auto result = client_->run(input, mode, [&](std::string_view token) {
+            if (!streamed) {
+                std::cout << std::endl << (mode == Mode::RUN ? "\033[1;36m" : "");
+                streamed = true;
+            }
+            std::cout << token << std::flush;
+        }, history);
+        std::cout << "\033[0m" << std::endl;
+
+        HistoryEntry entry;
+        entry.mode = mode;
+        entry.prompt = input;
+        entry.response = result.value_or("");
+        entry.latency_ms = elapsed_ms(asked);
+        entry.cached = client_->last_from_cache();
+        entry.chat = true;
+        ScopeExit record([&] { record_history(config, entry); });
+
+        if (!result) {
+            std::cout << "\033[1;31m❌ Failed to get response from Neuron AI\033[0m\n" << std::endl;
+            continue;
+        }
+        if (const auto& match = client_->last_match()) {
+            int percent = static_cast<int>(match->similarity * 100.0f + 0.5f);
+            std::cout << "\033[2;37m⚡ Cached match for a similar request (" << percent << "%): \""
+                      << match->prompt << "\"\033[0m" << std::endl;
+        } else if (client_->last_from_cache()) {
+            std::cout << "\033[2;37m⚡ Cached response\033[0m" << std::endl;
+        }
+
+        conversation.add_turn(client_->user_message(input, mode), *result);
+        if (size_t folded = conversation.fit(summarize)) {
+            std::cout << "\033[2;37m📝 " << (summarize ? "Summarized " : "Dropped ") << folded
+                      << " earlier turn(s) to stay within the context budget\033[0m" << std::endl;
+        }
+
+        if (mode == Mode::RUN) {
+            print_safety_report(safety(config).analyze(*result));
+            std::cout << "\n\033[1;33mExecute this command?\033[0m \033[2;37m[y/N]\033[0m: ";
+            std::string choice;
+            if (!std::getline(std::cin, choice)) break;
+            if (choice == "y" || choice == "yes" || choice == "Y" || choice == "YES") {
+                ExecResult execution = execute(config, *result);
+                entry.executed = execution.started;
+                entry.exit_code = execution.exit_code;
+                if (execution.started && !execution.succeeded()) {
+                    std::cout << "\033[1;31m❌ Command failed\033[0m \033[2;37m(exit code: " << execution.exit_code
+                              << ")\033[0m" << std::endl;
+
+                    // Keep the failure in the conversation so the next question can refer to it
+                    std::string output = prompt_tail(execution.output_tail, 2048);
+                    conversation.add_turn("I ran it and it failed with exit code " + std::to_string(execution.exit_code) +
+                                          (output.empty() ? "." : ". The end of its output was:\n" + output),
+                                          "Understood, I will take that output into account.");
+                }
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int CLI::handle_batch(int start_index) {
+    const Config& config = load_config();
+    std::unique_ptr<neuron::AIClient> client;
+    try {
+        client = std::make_unique<neuron::AIClient>(config);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (cache_policy_ != CachePolicy::USE) {
+        client->set_cache_policy(cache_policy_);
+    }
+
+    BatchOptions options;
+    options.safety = &safety(config);
+    options.concurrency = static_cast<size_t>(std::max(1L, config.getLong("NEURON_BATCH_CONCURRENCY", 8)));
+    std::string input_path = "-";
+
+    for (int i = start_index; i < argc_; ++i) {
+        std::string arg = argv_[i];
+        if ((arg == "-j" || arg == "--concurrency") && i + 1 < argc_) {
+            try {
+                options.concurrency = static_cast<size_t>(std::max(1, std::stoi(argv_[++i])));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid concurrency: " << argv_[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--unordered") {
+            options.ordered = false;
+        } else if (arg == "--ordered") {
+            options.ordered = true;
+        } else if (is_flag(arg)) {
+            continue;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown batch option: " << arg << std::endl;
+            std::cerr << "Usage: neuron batch [FILE|-] [-j N] [--unordered] [--no-cache|--refresh]" << std::endl;
+            return 1;
+        } else {
+            input_path = arg;
+        }
+    }
+
+    BatchRunner runner(*client, options);
+    size_t failures = 0;
+
+    if (input_path == "-") {
+        failures = runner.run(std::cin, std::cout);
+    } else {
+        std::ifstream input(input_path);
+        if (!input.is_open()) {
+            std::cerr << "Cannot open batch file: " << input_path << std::endl;
+            return 1;
+        }
+        failures = runner.run(input, std::cout);
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " batch item(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int CLI::handle_history(int start_index) {
+    const char* usage = "Usage: neuron history [TEXT] [--since WHEN] [--until WHEN] [-n N] [--run|--tell] [--failed] [--json]";
+    std::string text;
+    int64_t since = 0;
+    int64_t until = INT64_MAX;
+    size_t limit = 0;
+    bool json_output = false;
+    bool failed_only = false;
+    std::optional<Mode> mode;
+
+    for (int i = start_index; i < argc_; ++i) {
+        std::string arg = argv_[i];
+        if ((arg == "--since" || arg == "--until") && i + 1 < argc_) {
+            int64_t when = parse_when(argv_[++i]);
+            if (when < 0) {
+                std::cerr << "Invalid time: " << argv_[i] << " (use 30m, 12h, 7d, 2w or YYYY-MM-DD [HH:MM])" << std::endl;
+                return 1;
+            }
+            (arg == "--since" ? since : until) = when;
+        } else if ((arg == "-n" || arg == "--limit") && i + 1 < argc_) {
+            try {
+                limit = static_cast<size_t>(std::max(1, std::stoi(argv_[++i])));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid limit: " << argv_[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--json") {
+            json_output = true;
+        } else if (arg == "--failed") {
+            failed_only = true;
+        } else if (arg == "--run" || arg == "--tell") {
+            mode = arg == "--run" ? Mode::RUN : Mode::TELL;
+        } else if (is_flag(arg)) {
+            continue;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown history option: " << arg << std::endl;
+            std::cerr << usage << std::endl;
+            return 1;
+        } else {
+            if (!text.empty()) text += ' ';
+            text += arg;
+        }
+    }
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    // Records are only roughly in time order, so the scan stops a minute past until
+    const int64_t stop = until > INT64_MAX - 60LL * 1000 * 1000 ? INT64_MAX : until + 60LL * 1000 * 1000;
+
+    std::string directory = data_dir();
+    if (directory.empty()) {
+        std::cerr << "Cannot find a data directory (set HOME or XDG_DATA_HOME)" << std::endl;
+        return 1;
+    }
+    std::unique_ptr<HistoryReader> reader;
+    try {
+        reader = std::make_unique<HistoryReader>(history_path(directory));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    auto matches = [&](const HistoryRecord& record) {
+        if (record.time_us > until) return false;
+        if (mode && record.mode != *mode) return false;
+        if (failed_only && !(record.response.empty() || (record.executed && record.exit_code != 0))) return false;
+        return text.empty() || contains_folded(record.prompt, text) || contains_folded(record.response, text);
+    };
+
+    // Written by hand; an export of millions of records should not build a DOM each
+    std::string out;
+    auto append_json = [&out](const HistoryRecord& record) {
+        out += "{\"time\":\"";
+        out += format_time(record.time_us, "%Y-%m-%dT%H:%M:%SZ", true);
+        out += record.mode == Mode::RUN ? "\",\"mode\":\"run\",\"prompt\":" : "\",\"mode\":\"tell\",\"prompt\":";
+        append_json_string(out, record.prompt);
+        out += ",\"response\":";
+        append_json_string(out, record.response);
+        out += ",\"latency_ms\":" + std::to_string(record.latency_ms);
+        out += record.cached ? ",\"cached\":true" : ",\"cached\":false";
+        out += record.offline ? ",\"offline\":true" : ",\"offline\":false";
+        out += record.daemon ? ",\"daemon\":true" : ",\"daemon\":false";
+        out += record.chat ? ",\"chat\":true" : ",\"chat\":false";
+        out += record.executed ? ",\"executed\":true,\"exit_code\":" + std::to_string(record.exit_code)
+                               : std::string(",\"executed\":false");
+        out += "}\n";
+        if (out.size() >= 64 * 1024) {
+            std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+            out.clear();
+        }
+    };
+
+    // Without a limit an export streams every match; otherwise only the
+    // newest ones are kept while scanning
+    if (json_output && limit == 0) {
+        reader->scan(since, [&](const HistoryRecord& record) {
+            if (record.time_us > stop) return false;
+            if (matches(record)) append_json(record);
+            return true;
+        });
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+        std::cout.flush();
+        return 0;
+    }
+
+    if (limit == 0) limit = 20;
+    std::deque<HistoryRecord> newest;
+    size_t total = 0;
+    reader->scan(since, [&](const HistoryRecord& record) {
+        if (record.time_us > stop) return false;
+        if (!matches(record)) return true;
+        ++total;
+        newest.push_back(record);
+        if (newest.size() > limit) newest.pop_front();
+        return true;
+    });
+
+    if (json_output) {
+        for (const auto& record : newest) append_json(record);
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+        std::cout.flush();
+        return 0;
+    }
+
+    if (newest.empty()) {
+        std::cout << "\033[2;37mNo matching history\033[0m" << std::endl;
+        return 0;
+    }
+    for (const auto& record : newest) {
+        const char* status = record.response.empty()          ? "\033[1;31m✗\033[0m"
+                             : !record.executed                ? "\033[2;37m·\033[0m"
+                             : record.exit_code == 0           ? "\033[1;32m✓\033[0m"
+                                                               : "\033[1;31m✗\033[0m";
+        std::string response = first_line(record.response, 100);
+
+        std::cout << "\033[2;37m" << format_time(record.time_us, "%Y-%m-%d %H:%M", false) << "\033[0m " << status
+                  << " \033[1;36m" << (record.mode == Mode::RUN ? "run " : "tell") << "\033[0m "
+                  << record.prompt;
+        std::cout << "\033[2;37m  (" << (record.cached ? "cached" : record.offline ? "offline" : std::to_string(record.latency_ms) + " ms");
+        if (record.executed && record.exit_code != 0) std::cout << ", exit " << record.exit_code;
+        std::cout << ")\033[0m" << std::endl;
+        if (!response.empty()) {
+            std::cout << "                   \033[2;37m→ " << response << "\033[0m" << std::endl;
+        }
+    }
+    if (total > newest.size()) {
+        std::cout << "\033[2;37m" << newest.size() << " of " << total << " matches shown (-n for more)\033[0m" << std::endl;
+    }
+    return 0;
+}
+
+int CLI::handle_daemon(const std::string& option) {
+    const Config& config = load_config();
+    std::string socket_path = daemon_socket_path(config);
+    DaemonClient client(socket_path);
+
+    if (option == "--stop") {
+        if (client.shutdown()) {
+            std::cout << "🧬 Neuron daemon stopping" << std::endl;
+            return 0;
+        }
+        std::cout << "No neuron daemon is running" << std::endl;
+        return 1;
+    } else if (option == "--status") {
+        if (client.ping()) {
+            std::cout << "🧬 Neuron daemon is running on " << socket_path << std::endl;
+            return 0;
+        }
+        std::cout << "No neuron daemon is running" << std::endl;
+        return 1;
+    } else if (!option.empty()) {
+        std::cout << "Unknown daemon option: " << option << std::endl;
+        std::cout << "Available options: --status, --stop" << std::endl;
+        return 1;
+    }
+
+    try {
+        Daemon daemon(config, socket_path);
+        return daemon.serve();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
 int CLI::handle_setup(const std::string& option) {
     if (option == "--api-key") {
         setup_api_key();
@@ -1,5 +1,6 @@
 #include "neuron/config.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 
@@ -19,7 +20,7 @@ void Config::load() {
             if (delimiterPos != std::string::npos) {
                 std::string key = line.substr(0, delimiterPos);
                 std::string value = line.substr(delimiterPos + 1);
-                _configMap[key] = value;
+                _localMap[key] = value;
             }
         }
     }
@@ -40,30 +41,36 @@ void Config::load() {
 }
 
 std::optional<std::string> Config::getNeuronApiKey() const {
-    // Get the API key from the environment variables first
-    const char* apiKey = std::getenv(NEURON_API_KEY_ENV);
-    if (apiKey && strlen(apiKey) > 0) {
-        return std::optional<std::string>(apiKey);
+    return getValue(NEURON_API_KEY_ENV);
+}
+
+std::optional<std::string> Config::getNeuronModel() const {
+    return getValue(NEURON_MODEL_ENV);
+}
+
+std::optional<std::string> Config::getValue(const std::string& key) const {
+    if (auto value = getTrustedValue(key)) {
+        return value;
     }
 
-    // If not found, check the config map
-    auto it = _configMap.find(NEURON_API_KEY_ENV);
-    if (it != _configMap.end() && !it->second.empty()) {
+    // The user config file overrides .env
+    auto it = _localMap.find(key);
+    if (it != _localMap.end() && !it->second.empty()) {
         return std::optional<std::string>(it->second);
     }
 
     return std::nullopt;
 }
 
-std::optional<std::string> Config::getNeuronModel() const {
-    // Get the model from the environment variables first
-    const char* model = std::getenv(NEURON_MODEL_ENV);
-    if (model && strlen(model) > 0) {
-        return std::optional<std::string>(model);
+std::optional<std::string> Config::getTrustedValue(const std::string& key) const {
+    // Environment variables take precedence
+    const char* value = std::getenv(key.c_str());
+    if (value && strlen(value) > 0) {
+        return std::optional<std::string>(value);
     }
 
     // If not found, check the config map
-    auto it = _configMap.find(NEURON_MODEL_ENV);
+    auto it = _configMap.find(key);
     if (it != _configMap.end() && !it->second.empty()) {
         return std::optional<std::string>(it->second);
     }
@@ -71,6 +78,34 @@ std::optional<std::string> Config::getNeuronModel() const {
     return std::nullopt;
 }
 
+long Config::getLong(const std::string& key, long fallback) const {
+    auto value = getValue(key);
+    if (!value) return fallback;
+
+    char* end = nullptr;
+    long parsed = std::strtol(value->c_str(), &end, 10);
+    return (end && *end == '\0') ? parsed : fallback;
+}
+
+double Config::getDouble(const std::string& key, double fallback) const {
+    auto value = getValue(key);
+    if (!value) return fallback;
+
+    char* end = nullptr;
+    double parsed = std::strtod(value->c_str(), &end);
+    return (end && end != value->c_str() && *end == '\0') ? parsed : fallback;
+}
+
+bool Config::getFlag(const std::string& key, bool fallback) const {
+    auto value = getValue(key);
+    if (!value) return fallback;
+
+    const std::string& v = *value;
+    if (v == "1" || v == "true" || v == "yes" || v == "on") return true;
+    if (v == "0" || v == "false" || v == "no" || v == "off") return false;
+    return fallback;
+}
+
 bool Config::setApiKey(const std::string& api_key) {
     _configMap[NEURON_API_KEY_ENV] = api_key;
     return saveToFile();
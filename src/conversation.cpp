@@ -0,0 +1,97 @@
+#include "neuron/conversation.hpp"
+
+namespace neuron {
+
+namespace {
+
+// Role and framing overhead the API adds per message
+constexpr size_t kMessageOverhead = 4;
+
+// Cuts text to at most max_bytes without splitting a UTF-8 sequence
+void truncate_utf8(std::string& text, size_t max_bytes) {
+    if (text.size() <= max_bytes) return;
+    size_t cut = max_bytes;
+    while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xc0) == 0x80) --cut;
+    text.resize(cut);
+}
+
+} // namespace
+
+size_t estimate_tokens(std::string_view text) {
+    return (text.size() + 3) / 4;
+}
+
+Conversation::Conversation(size_t token_budget) : budget_(token_budget) {}
+
+void Conversation::add_turn(std::string user, std::string assistant) {
+    size_t tokens = estimate_tokens(user) + estimate_tokens(assistant) + 2 * kMessageOverhead;
+    turn_tokens_ += tokens;
+    turns_.push_back(Turn{std::move(user), std::move(assistant), tokens});
+}
+
+void Conversation::clear() {
+    turns_.clear();
+    turn_tokens_ = 0;
+    set_summary("");
+}
+
+size_t Conversation::tokens() const {
+    size_t total = turn_tokens_;
+    if (!summary_message_.empty()) total += estimate_tokens(summary_message_) + kMessageOverhead;
+    return total;
+}
+
+size_t Conversation::fit(const Summarizer& summarize) {
+    if (tokens() <= budget_ || turns_.size() <= 1) return 0;
+
+    // Trim down to three quarters of the budget so the summary has room and
+    // the next few turns do not each trigger another round
+    const size_t summary_budget = budget_ / 4;
+    const size_t target = budget_ - summary_budget;
+
+    std::string folded;
+    size_t removed = 0;
+    while (turns_.size() > 1 && turn_tokens_ > target) {
+        Turn& oldest = turns_.front();
+        folded += "User: " + oldest.user + "\nAssistant: " + oldest.assistant + "\n\n";
+        turn_tokens_ -= oldest.tokens;
+        turns_.pop_front();
+        ++removed;
+    }
+
+    std::optional<std::string> condensed;
+    if (summarize && removed > 0) {
+        std::string text;
+        if (!summary_.empty()) {
+            text = "Earlier summary: " + summary_ + "\n\n";
+        }
+        text += folded;
+        condensed = summarize(text);
+    }
+
+    // Without a fresh summary the old one still describes what came before
+    std::string summary = condensed ? std::move(*condensed) : summary_;
+    truncate_utf8(summary, summary_budget * 4);
+    set_summary(std::move(summary));
+    return removed;
+}
+
+std::vector<ChatMessage> Conversation::messages() const {
+    std::vector<ChatMessage> out;
+    out.reserve(turns_.size() * 2 + 1);
+    if (!summary_message_.empty()) {
+        out.push_back(ChatMessage{"system", summary_message_});
+    }
+    for (const auto& turn : turns_) {
+        out.push_back(ChatMessage{"user", turn.user});
+        out.push_back(ChatMessage{"assistant", turn.assistant});
+    }
+    return out;
+}
+
+void Conversation::set_summary(std::string summary) {
+    summary_ = std::move(summary);
+    summary_message_ = summary_.empty() ? "" : "Summary of the conversation so far: " + summary_;
+}
+
+} // namespace neuron
@@ -0,0 +1,565 @@
+#include "neuron/daemon.hpp"
+#include "neuron/metrics.hpp"
+#include "neuron/paths.hpp"
+#include "neuron/retry.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <netdb.h>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace neuron {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr std::chrono::milliseconds kRequestTimeout{500};  // For a client to send its request line
+
+std::atomic<bool> g_signalled{false};
+
+void on_terminate_signal(int) {
+    g_signalled = true;
+}
+
+bool write_line(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// TCP listener for Prometheus scrapes on "host:port" (or "[v6]:port"), or -1
+// with error set. "0.0.0.0" or "[::]" is every interface.
+int listen_tcp(const std::string& address, std::string& error) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        error = "expected host:port";
+        return -1;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &found); status != 0) {
+        error = gai_strerror(status);
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* a = found; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || listen(fd, 16) != 0) {
+            error = std::strerror(errno);
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    return fd;
+}
+
+// Answers one HTTP request: GET /metrics gets the exposition, anything else
+// 404. The whole exchange must finish within two seconds, however slowly
+// the client sends or reads, so one scraper cannot hold up the next.
+void serve_metrics(int fd) {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(2);
+    auto wait_for = [&](short events) {
+        while (true) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) return false;
+            pollfd pfd{fd, events, 0};
+            int ready = poll(&pfd, 1, static_cast<int>(left));
+            if (ready < 0 && errno == EINTR) continue;
+            return ready > 0;
+        }
+    };
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192 && wait_for(POLLIN)) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    bool found = request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0;
+    std::string body = found ? Metrics::global().exposition() : "Not found\n";
+    std::string response = std::string("HTTP/1.1 ") + (found ? "200 OK" : "404 Not Found") + "\r\n" +
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" +
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                           "Connection: close\r\n\r\n" + body;
+    const char* p = response.data();
+    size_t left = response.size();
+    while (left > 0 && wait_for(POLLOUT)) {
+        ssize_t n = send(fd, p, left, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+}
+
+// request[key] if it is a string, fallback if it is absent, nullopt if it is
+// anything else
+std::optional<std::string> string_field(const json& request, const char* key, const char* fallback) {
+    auto it = request.find(key);
+    if (it == request.end()) return fallback;
+    if (!it->is_string()) return std::nullopt;
+    return it->get<std::string>();
+}
+
+std::optional<bool> bool_field(const json& request, const char* key, bool fallback) {
+    auto it = request.find(key);
+    if (it == request.end()) return fallback;
+    if (!it->is_boolean()) return std::nullopt;
+    return it->get<bool>();
+}
+
+// Buffered newline-delimited reader over a socket
+class LineReader {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LineReader(int fd, Clock::time_point deadline = Clock::time_point::max())
+        : fd_(fd), deadline_(deadline) {}
+
+    bool next(std::string& line) {
+        while (true) {
+            size_t newline = buffer_.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer_.substr(0, newline);
+                buffer_.erase(0, newline + 1);
+                return true;
+            }
+
+            if (deadline_ != Clock::time_point::max()) {
+                auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline_ - Clock::now());
+                pollfd pfd{fd_, POLLIN, 0};
+                int ready = left.count() > 0 ? poll(&pfd, 1, static_cast<int>(left.count())) : 0;
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready == 0) timed_out_ = true;
+                if (ready <= 0) return false;
+            }
+
+            char chunk[4096];
+            ssize_t n = read(fd_, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    bool timed_out() const { return timed_out_; }
+
+private:
+    int fd_;
+    Clock::time_point deadline_;
+    std::string buffer_;
+    bool timed_out_ = false;
+};
+
+bool fill_address(const std::string& path, sockaddr_un& addr) {
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+const char* policy_name(CachePolicy policy) {
+    switch (policy) {
+        case CachePolicy::REFRESH: return "refresh";
+        case CachePolicy::DISABLED: return "disabled";
+        case CachePolicy::USE: break;
+    }
+    return "use";
+}
+
+} // namespace
+
+std::string daemon_socket_path(const Config& config) {
+    if (auto path = config.getValue("NEURON_DAEMON_SOCKET")) {
+        return *path;
+    }
+
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/neuron.sock";
+    }
+
+    std::string dir = cache_dir();
+    return dir.empty() ? "" : dir + "/daemon.sock";
+}
+
+std::chrono::milliseconds daemon_timeout(const Config& config) {
+    return RetryPolicy::from_config(config).deadline + std::chrono::milliseconds(2000);
+}
+
+DaemonClient::DaemonClient(std::string socket_path, std::chrono::milliseconds timeout)
+    : socket_path_(std::move(socket_path)), timeout_(timeout) {}
+
+int DaemonClient::connect_socket() const {
+    sockaddr_un addr;
+    if (!fill_address(socket_path_, addr)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    // Bounds connect() when the daemon stopped accepting and its backlog is
+    // full, and each write of the request
+    timeval send_timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return fd;
+}
+
+std::optional<DaemonReply> DaemonClient::run(const std::string& prompt, Mode mode,
+                                             CachePolicy policy, const TokenCallback& on_token,
+                                             const std::string& context) {
+    int fd = connect_socket();
+    if (fd < 0) return std::nullopt;
+
+    {
+        std::lock_guard<std::mutex> lock(active_mutex_);
+        if (cancelled_) {
+            close(fd);
+            return std::nullopt;
+        }
+        active_fd_ = fd;
+    }
+    auto finish = [&] {
+        std::lock_guard<std::mutex> lock(active_mutex_);
+        active_fd_ = -1;
+        close(fd);
+    };
+
+    json request = {
+        {"op", "run"},
+        {"mode", mode == Mode::RUN ? "run" : "tell"},
+        {"prompt", prompt},
+        {"cache", policy_name(policy)},
+        {"stream", static_cast<bool>(on_token)}
+    };
+    if (!context.empty()) request["context"] = context;
+
+    if (!write_line(fd, request.dump())) {
+        finish();
+        return std::nullopt;
+    }
+
+    LineReader reader(fd, std::chrono::steady_clock::now() + timeout_);
+    std::string line;
+    bool streamed = false;
+
+    while (reader.next(line)) {
+        json message = json::parse(line, nullptr, false);
+        if (message.is_discarded()) continue;
+
+        if (message.contains("token")) {
+            streamed = true;
+            on_token(message["token"].get<std::string>());
+            continue;
+        }
+
+        DaemonReply reply;
+        if (message.value("ok", false)) {
+            reply.content = message.value("content", "");
+            reply.cached = message.value("cached", false);
+            if (message.contains("similar_to")) {
+                reply.match = SemanticMatch{{}, message.value("similar_to", ""), message.value("similarity", 0.0f)};
+            }
+        } else {
+            reply.error = message.value("error", "Daemon request failed");
+        }
+        finish();
+        return reply;
+    }
+
+    finish();
+
+    // Nothing was shown yet, so the caller can still retry in-process
+    if (!streamed) return std::nullopt;
+
+    DaemonReply reply;
+    reply.error = reader.timed_out() ? "Timed out waiting for neuron daemon" : "Lost connection to neuron daemon";
+    return reply;
+}
+
+void DaemonClient::cancel() {
+    // Shutting the socket down wakes the blocked read; the daemon finishes
+    // and caches the answer on its own
+    std::lock_guard<std::mutex> lock(active_mutex_);
+    cancelled_ = true;
+    if (active_fd_ >= 0) ::shutdown(active_fd_, SHUT_RDWR);
+}
+
+std::optional<std::string> DaemonClient::simple_request(const std::string& op) {
+    int fd = connect_socket();
+    if (fd < 0) return std::nullopt;
+
+    std::string line;
+    bool ok = write_line(fd, json{{"op", op}}.dump()) &&
+              LineReader(fd, std::chrono::steady_clock::now() + timeout_).next(line);
+    close(fd);
+    return ok ? std::optional<std::string>(line) : std::nullopt;
+}
+
+bool DaemonClient::ping() {
+    return simple_request("ping").has_value();
+}
+
+bool DaemonClient::shutdown() {
+    return simple_request("shutdown").has_value();
+}
+
+Daemon::Daemon(const Config& config, std::string socket_path)
+    : config_(config), socket_path_(std::move(socket_path)) {}
+
+void Daemon::handle_connection(int fd, AIClient& client, CachePolicy default_policy) {
+    // Clients send their request as soon as they connect; one that sends
+    // nothing must not hold a worker
+    LineReader reader(fd, LineReader::Clock::now() + kRequestTimeout);
+    std::string line;
+    if (!reader.next(line)) return;
+
+    json request = json::parse(line, nullptr, false);
+    if (request.is_discarded() || !request.is_object()) {
+        write_line(fd, json{{"ok", false}, {"error", "Malformed request"}}.dump());
+        return;
+    }
+
+    auto op = string_field(request, "op", "");
+    auto mode_name = string_field(request, "mode", "run");
+    auto cache = string_field(request, "cache", "use");
+    auto context = string_field(request, "context", "");
+    auto stream = bool_field(request, "stream", false);
+    if (!op || !mode_name || !cache || !context || !stream) {
+        write_line(fd, json{{"ok", false}, {"error", "Malformed request: a field has the wrong type"}}.dump());
+        return;
+    }
+
+    if (*op == "ping") {
+        write_line(fd, json{{"ok", true}, {"pid", getpid()}}.dump());
+        return;
+    }
+    if (*op == "shutdown") {
+        stopping_ = true;
+        write_line(fd, json{{"ok", true}}.dump());
+        return;
+    }
+    if (*op != "run" || !request.contains("prompt") || !request["prompt"].is_string()) {
+        write_line(fd, json{{"ok", false}, {"error", "Unknown request"}}.dump());
+        return;
+    }
+
+    Mode mode = *mode_name == "tell" ? Mode::TELL : Mode::RUN;
+
+    if (*cache == "refresh") {
+        client.set_cache_policy(CachePolicy::REFRESH);
+    } else if (*cache == "disabled") {
+        client.set_cache_policy(CachePolicy::DISABLED);
+    } else {
+        client.set_cache_policy(default_policy);
+    }
+
+    // A client that hangs up mid-stream just stops receiving tokens; the
+    // transfer still completes so the response lands in the cache.
+    TokenCallback on_token;
+    if (*stream) {
+        on_token = [fd](std::string_view token) {
+            write_line(fd, json{{"token", token}}.dump());
+        };
+    }
+
+    // Directory context is the caller's, not the daemon's
+    client.set_context(mode == Mode::RUN ? *context : "");
+
+    auto result = client.run(request["prompt"].get<std::string>(), mode, on_token);
+
+    json reply = {{"ok", result.has_value()}};
+    if (result) {
+        reply["content"] = *result;
+        reply["cached"] = client.last_from_cache();
+        if (const auto& match = client.last_match()) {
+            reply["similar_to"] = match->prompt;
+            reply["similarity"] = match->similarity;
+        }
+    } else {
+        reply["error"] = client.last_error();
+    }
+    write_line(fd, reply.dump());
+}
+
+int Daemon::serve() {
+    sockaddr_un addr;
+    if (!fill_address(socket_path_, addr)) {
+        std::cerr << "Invalid daemon socket path: " << socket_path_ << std::endl;
+        return 1;
+    }
+
+    // Must happen before any worker thread touches curl
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Validate configuration once up front; AIClient throws without an API key
+    AIClient probe(config_);
+
+    if (DaemonClient(socket_path_).ping()) {
+        std::cerr << "A neuron daemon is already listening on " << socket_path_ << std::endl;
+        return 1;
+    }
+    unlink(socket_path_.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // Only the owning user may talk to the daemon (it holds their API key)
+    mode_t old_mask = umask(0077);
+    int bound = bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    umask(old_mask);
+
+    if (bound != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "Cannot listen on " << socket_path_ << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, on_terminate_signal);
+    std::signal(SIGTERM, on_terminate_signal);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> queue;
+    bool draining = false;
+
+    const long worker_count = std::max(1L, config_.getLong("NEURON_DAEMON_WORKERS", 4));
+    std::vector<std::thread> workers;
+    for (long i = 0; i < worker_count; ++i) {
+        workers.emplace_back([&] {
+            AIClient client(config_);
+            CachePolicy default_policy = client.cache_policy();
+
+            while (true) {
+                int fd;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&] { return draining || !queue.empty(); });
+                    if (queue.empty()) return;
+                    fd = queue.front();
+                    queue.pop_front();
+                }
+                handle_connection(fd, client, default_policy);
+                close(fd);
+                Metrics::global().flush();
+            }
+        });
+    }
+
+    std::cerr << "🧬 Neuron daemon listening on " << socket_path_
+              << " (" << worker_count << " workers, pid " << getpid() << ")" << std::endl;
+
+    // Scrapes are answered one at a time on a thread of their own, so a
+    // slow scraper never holds up requests
+    std::thread metrics_thread;
+    const MetricsOptions metrics = MetricsOptions::from_config(config_);
+    if (Metrics::global().enabled() && !metrics.listen.empty()) {
+        std::string error;
+        int metrics_fd = listen_tcp(metrics.listen, error);
+        if (metrics_fd < 0) {
+            std::cerr << "Cannot serve metrics on " << metrics.listen << ": " << error << std::endl;
+        } else {
+            std::cerr << "🧬 Metrics at http://" << metrics.listen << "/metrics" << std::endl;
+            metrics_thread = std::thread([this, metrics_fd] {
+                while (!stopping_ && !g_signalled) {
+                    pollfd pfd{metrics_fd, POLLIN, 0};
+                    if (poll(&pfd, 1, 250) <= 0) continue;
+                    int fd = accept4(metrics_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (fd < 0) continue;
+                    serve_metrics(fd);
+                    close(fd);
+                }
+                close(metrics_fd);
+            });
+        }
+    }
+
+    // Poll with a timeout so shutdown requests and signals are noticed promptly
+    while (!stopping_ && !g_signalled) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 250) <= 0) continue;
+
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(fd);
+        ready.notify_one();
+    }
+
+    if (metrics_thread.joinable()) metrics_thread.join();
+    close(listen_fd);
+    unlink(socket_path_.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        draining = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::cerr << "🧬 Neuron daemon stopped" << std::endl;
+    return 0;
+}
+
+} // namespace neuron
@@ -0,0 +1,419 @@
+#include "neuron/directory_context.hpp"
+#include "neuron/hash.hpp"
+#include "neuron/paths.hpp"
+#include "neuron/trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <poll.h>
+#include <spawn.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace neuron {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kMaxEntries = 2000;      // Listing entries looked at
+constexpr size_t kMaxProbeOutput = 16 * 1024;
+
+// Project files worth naming, and the tool whose version matters next to them
+struct Marker {
+    const char* file;
+    const char* tool;  // Null: nothing to ask
+    const char* version_arg;
+};
+
+constexpr Marker kMarkers[] = {
+    {"package.json", "node", "--version"},
+    {"pnpm-lock.yaml", "pnpm", "--version"},
+    {"yarn.lock", "yarn", "--version"},
+    {"pyproject.toml", "python3", "--version"},
+    {"requirements.txt", "python3", "--version"},
+    {"setup.py", "python3", "--version"},
+    {"Cargo.toml", "cargo", "--version"},
+    {"go.mod", "go", "version"},
+    {"Gemfile", "ruby", "--version"},
+    {"composer.json", "php", "--version"},
+    {"CMakeLists.txt", "cmake", "--version"},
+    {"Makefile", "make", "--version"},
+    {"meson.build", "meson", "--version"},
+    {"Dockerfile", "docker", "--version"},
+    {"docker-compose.yml", "docker", "--version"},
+    {"compose.yaml", "docker", "--version"},
+    {"main.tf", "terraform", "version"},
+    {"pom.xml", nullptr, nullptr},
+    {"build.gradle", nullptr, nullptr},
+    {"flake.nix", nullptr, nullptr},
+};
+
+constexpr const char* kPackageManagers[] = {
+    "apt", "dnf", "yum", "pacman", "zypper", "apk", "brew", "port", "nix", "snap", "flatpak",
+    "npm", "pnpm", "yarn", "pip3", "pipx", "uv", "poetry", "cargo", "gem", "composer",
+};
+
+int64_t mtime_ns(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string env_or_empty(const char* name) {
+    const char* value = std::getenv(name);
+    return value ? value : "";
+}
+
+std::string first_line(const std::string& text, size_t max_bytes = 80) {
+    std::string line = text.substr(0, text.find('\n'));
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+    return line.size() > max_bytes ? line.substr(0, max_bytes) : line;
+}
+
+// The nearest directory at or above directory that holds .git, or empty
+std::string git_root(std::string directory) {
+    struct stat st;
+    while (!directory.empty()) {
+        if (stat((directory + "/.git").c_str(), &st) == 0) return directory;
+        size_t slash = directory.rfind('/');
+        if (slash == std::string::npos || directory == "/") break;
+        directory = slash == 0 ? "/" : directory.substr(0, slash);
+    }
+    return "";
+}
+
+// What args print on stdout and stderr, or empty if it could not start or
+// failed. Nullopt if it was still running at the deadline, which kills it.
+std::optional<std::string> probe(const std::vector<std::string>& args, char* const* envp,
+                                 Clock::time_point deadline) {
+    if (Clock::now() >= deadline) return std::nullopt;
+    int out[2];
+    if (pipe(out) != 0) return "";
+    fcntl(out[0], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, out[1]);
+
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    int spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), envp);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out[1]);
+    if (spawned != 0) {
+        close(out[0]);
+        return "";
+    }
+
+    std::string output;
+    bool timed_out = false;
+    pollfd watch{out[0], POLLIN, 0};
+    char buffer[4096];
+    while (true) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) {
+            timed_out = true;
+            break;
+        }
+        int ready = poll(&watch, 1, static_cast<int>(left.count()));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) continue;
+        ssize_t n = read(out[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (output.size() < kMaxProbeOutput) output.append(buffer, static_cast<size_t>(n));
+    }
+    close(out[0]);
+
+    if (timed_out) kill(pid, SIGKILL);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (timed_out) return std::nullopt;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return "";
+    return output;
+}
+
+struct Listing {
+    size_t files = 0;
+    size_t directories = 0;
+    bool truncated = false;
+    std::vector<const Marker*> markers;
+    std::vector<std::pair<std::string, size_t>> extensions;  // Most common first
+};
+
+Listing list_directory(const std::string& directory) {
+    Listing listing;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) return listing;
+
+    std::map<std::string, size_t> extensions;
+    std::vector<bool> seen(std::size(kMarkers), false);
+    while (dirent* entry = readdir(dir)) {
+        std::string_view name = entry->d_name;
+        if (name.empty() || name[0] == '.') continue;
+        if (listing.files + listing.directories >= kMaxEntries) {
+            listing.truncated = true;
+            break;
+        }
+        if (entry->d_type == DT_DIR) {
+            ++listing.directories;
+            continue;
+        }
+        ++listing.files;
+        for (size_t i = 0; i < std::size(kMarkers); ++i) {
+            if (!seen[i] && name == kMarkers[i].file) seen[i] = true;
+        }
+        size_t dot = name.rfind('.');
+        if (dot != std::string_view::npos && dot > 0 && name.size() - dot <= 8) {
+            ++extensions[std::string(name.substr(dot))];
+        }
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < std::size(kMarkers); ++i) {
+        if (seen[i]) listing.markers.push_back(&kMarkers[i]);
+    }
+    listing.extensions.assign(extensions.begin(), extensions.end());
+    std::stable_sort(listing.extensions.begin(), listing.extensions.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    if (listing.extensions.size() > 4) listing.extensions.resize(4);
+    return listing;
+}
+
+std::vector<std::string> package_managers() {
+    std::vector<std::string> dirs;
+    std::istringstream path(env_or_empty("PATH"));
+    for (std::string dir; std::getline(path, dir, ':');) {
+        if (!dir.empty()) dirs.push_back(dir);
+    }
+
+    std::vector<std::string> found;
+    for (const char* name : kPackageManagers) {
+        for (const auto& dir : dirs) {
+            if (access((dir + "/" + name).c_str(), X_OK) == 0) {
+                found.emplace_back(name);
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+// "## main...origin/main [ahead 1]" and one line per changed file
+std::string describe_git(const std::string& status) {
+    std::istringstream lines(status);
+    std::string line, branch;
+    size_t changed = 0;
+    while (std::getline(lines, line)) {
+        if (line.rfind("## ", 0) == 0) {
+            branch = line.substr(3);
+        } else if (!line.empty()) {
+            ++changed;
+        }
+    }
+    if (branch.rfind("No commits yet on ", 0) == 0) branch = branch.substr(18) + " (no commits yet)";
+    if (branch.empty()) return "";
+
+    std::string text = "branch " + branch;
+    text += changed == 0 ? ", clean" : ", " + std::to_string(changed) + " uncommitted change" + (changed == 1 ? "" : "s");
+    return text;
+}
+
+// Everything that, when it changes, makes a saved collection stale
+uint64_t stamp(const std::string& directory, const std::string& root) {
+    Hasher hasher;
+    hasher.feed(directory)
+        .feed(std::to_string(mtime_ns(directory)))
+        .feed(env_or_empty("PATH"))
+        .feed(env_or_empty("SHELL"));
+    if (!root.empty()) {
+        hasher.feed(std::to_string(mtime_ns(root + "/.git")))
+            .feed(std::to_string(mtime_ns(root + "/.git/HEAD")))
+            .feed(std::to_string(mtime_ns(root + "/.git/index")));
+    }
+    return hasher.digest().lo;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Saved as "<stamp> <expires>\n<context>", replaced in one rename
+std::optional<std::string> load_cached(const std::string& path, uint64_t expected) {
+    std::ifstream in(path, std::ios::binary);
+    unsigned long long saved = 0;
+    long long expires = 0;
+    if (!(in >> saved >> expires) || saved != expected || expires <= now_seconds()) return std::nullopt;
+    in.get();
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void save_cached(const std::string& path, uint64_t value, std::chrono::seconds ttl, const std::string& context) {
+    std::string contents = std::to_string(value) + " " + std::to_string(now_seconds() + ttl.count()) + "\n" + context;
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    bool written = write_all(fd, contents.data(), contents.size());
+    close(fd);
+    if (!written || rename(temp.c_str(), path.c_str()) != 0) unlink(temp.c_str());
+}
+
+// complete is cleared when a probe ran out of time
+std::string collect(const std::string& directory, const std::string& root, std::chrono::milliseconds budget,
+                    bool& complete) {
+    const auto deadline = Clock::now() + budget;
+
+    // git status takes no locks it does not need, so it never races the user's own git
+    std::vector<std::string> env;
+    for (char** entry = environ; *entry; ++entry) env.emplace_back(*entry);
+    env.emplace_back("GIT_OPTIONAL_LOCKS=0");
+    env.emplace_back("LC_ALL=C");
+    std::vector<char*> envp;
+    for (auto& entry : env) envp.push_back(entry.data());
+    envp.push_back(nullptr);
+
+    // Names come first, since they decide which versions are asked for
+    Listing listing = list_directory(directory);
+
+    std::vector<std::vector<std::string>> commands;
+    const std::string shell = env_or_empty("SHELL");
+    if (!shell.empty()) commands.push_back({shell, "--version"});
+    for (const Marker* marker : listing.markers) {
+        if (!marker->tool) continue;
+        std::vector<std::string> command = {marker->tool, marker->version_arg};
+        if (std::find(commands.begin(), commands.end(), command) == commands.end()) commands.push_back(command);
+    }
+    if (!root.empty()) {
+        commands.push_back({"git", "-C", directory, "status", "--porcelain=v1", "--branch", "--untracked-files=no"});
+    }
+
+    // One thread per process; each is bounded by the deadline
+    std::vector<std::optional<std::string>> outputs(commands.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        workers.emplace_back([&, i] { outputs[i] = probe(commands[i], envp.data(), deadline); });
+    }
+    std::vector<std::string> managers = package_managers();
+    for (auto& worker : workers) worker.join();
+    complete = std::all_of(outputs.begin(), outputs.end(), [](const auto& output) { return output.has_value(); });
+
+    std::string text;
+    auto add = [&](const std::string& label, const std::string& value) {
+        if (!value.empty()) text += "- " + label + ": " + value + "\n";
+    };
+
+    std::string summary = std::to_string(listing.files) + (listing.truncated ? "+" : "") + " files, " +
+                          std::to_string(listing.directories) + " directories";
+    if (!listing.markers.empty()) {
+        summary += "; project files:";
+        for (size_t i = 0; i < listing.markers.size(); ++i) {
+            summary += std::string(i == 0 ? " " : ", ") + listing.markers[i]->file;
+        }
+    }
+    if (!listing.extensions.empty()) {
+        summary += "; mostly";
+        for (size_t i = 0; i < listing.extensions.size(); ++i) {
+            summary += std::string(i == 0 ? " " : ", ") + listing.extensions[i].first;
+        }
+    }
+    add("Directory", summary);
+
+    size_t next = 0;
+    if (!shell.empty()) add("Shell", first_line(outputs[next++].value_or("")));
+    std::string versions;
+    for (; next < outputs.size() - (root.empty() ? 0 : 1); ++next) {
+        std::string version = first_line(outputs[next].value_or(""));
+        if (!version.empty()) versions += (versions.empty() ? "" : "; ") + version;
+    }
+    add("Tools", versions);
+    if (!root.empty()) add("Git", describe_git(outputs.back().value_or("")));
+
+    std::string joined;
+    for (const auto& name : managers) joined += (joined.empty() ? "" : ", ") + name;
+    add("Package managers", joined);
+
+    return text.empty() ? "" : "Working directory context:\n" + text;
+}
+
+} // namespace
+
+ContextOptions ContextOptions::from_config(const Config& config) {
+    ContextOptions options;
+    options.enabled = config.getFlag("NEURON_CONTEXT", false);
+    options.budget = std::chrono::milliseconds(std::max(1L, config.getLong("NEURON_CONTEXT_BUDGET_MS", 40)));
+    options.ttl = std::chrono::seconds(std::max(0L, config.getLong("NEURON_CONTEXT_TTL", 600)));
+    if (options.ttl.count() > 0) options.cache_directory = cache_dir();
+    return options;
+}
+
+std::string collect_directory_context(const std::string& directory, const ContextOptions& options) {
+    if (!options.enabled || directory.empty()) return "";
+    TraceSpan span("directory context", "setup");
+
+    const std::string root = git_root(directory);
+    const uint64_t current = stamp(directory, root);
+
+    std::string path;
+    if (!options.cache_directory.empty() && make_dirs(options.cache_directory + "/context")) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%016llx.txt",
+                      static_cast<unsigned long long>(Hasher().feed(directory).digest().lo));
+        path = options.cache_directory + "/context" + name;
+        if (auto cached = load_cached(path, current)) {
+            span.set_detail("cached");
+            return *cached;
+        }
+    }
+
+    bool complete = true;
+    std::string context = collect(directory, root, options.budget, complete);
+    span.set_detail(complete ? "collected" : "over budget");
+
+    // A partial answer is used once, not kept
+    if (!path.empty() && complete) save_cached(path, current, options.ttl, context);
+    return context;
+}
+
+} // namespace neuron
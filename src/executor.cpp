@@ -0,0 +1,432 @@
+#include "neuron/executor.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace neuron {
+
+namespace {
+
+constexpr int kForwarded[] = {SIGINT, SIGQUIT, SIGTERM, SIGHUP, SIGCHLD, SIGWINCH};
+constexpr auto kKillGrace = std::chrono::seconds(2);
+
+volatile sig_atomic_t g_child = 0;            // Also the child's process group
+volatile sig_atomic_t g_child_has_terminal = 0;
+volatile sig_atomic_t g_wake_fd = -1;
+
+void on_signal(int sig, siginfo_t* info, void*) {
+    int saved_errno = errno;
+
+    // Ctrl-C and Ctrl-\ reach the child directly while its group is in the
+    // foreground; only pass on what was sent to neuron alone
+    bool from_terminal = (sig == SIGINT || sig == SIGQUIT) && info && info->si_code != SI_USER;
+    if (g_child > 0 && sig != SIGCHLD && sig != SIGWINCH && !(from_terminal && g_child_has_terminal)) {
+        kill(-static_cast<pid_t>(g_child), sig);
+    }
+
+    // Wake the event loop; a full pipe already means it will wake
+    if (g_wake_fd >= 0) {
+        char byte = static_cast<char>(sig);
+        if (write(g_wake_fd, &byte, 1) < 0) {}
+    }
+    errno = saved_errno;
+}
+
+// Installs the forwarding handlers for the lifetime of one child
+class SignalScope {
+public:
+    explicit SignalScope(int wake_fd) {
+        g_wake_fd = wake_fd;
+        struct sigaction action {};
+        action.sa_sigaction = on_signal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        for (size_t i = 0; i < std::size(kForwarded); ++i) {
+            sigaction(kForwarded[i], &action, &previous_[i]);
+        }
+    }
+
+    ~SignalScope() {
+        for (size_t i = 0; i < std::size(kForwarded); ++i) {
+            sigaction(kForwarded[i], &previous_[i], nullptr);
+        }
+        g_child = 0;
+        g_wake_fd = -1;
+    }
+
+    SignalScope(const SignalScope&) = delete;
+    SignalScope& operator=(const SignalScope&) = delete;
+
+private:
+    struct sigaction previous_[std::size(kForwarded)];
+};
+
+// Gives the terminal to the child's process group while it runs, as a shell
+// does for a foreground job, so it gets Ctrl-C, Ctrl-Z and terminal input.
+// Only when neuron itself is in the foreground of its terminal.
+class TerminalHandoff {
+public:
+    TerminalHandoff() : active_(isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp()) {}
+
+    ~TerminalHandoff() { take_back(); }
+
+    TerminalHandoff(const TerminalHandoff&) = delete;
+    TerminalHandoff& operator=(const TerminalHandoff&) = delete;
+
+    bool active() const { return active_; }
+
+    // Also continues the group, in case it read the terminal before it was its own
+    void give(pid_t group) {
+        if (!active_) return;
+        set_foreground(group);
+        g_child_has_terminal = 1;
+        kill(-group, SIGCONT);
+    }
+
+    void take_back() {
+        if (!active_ || !g_child_has_terminal) return;
+        g_child_has_terminal = 0;
+        set_foreground(getpgrp());
+    }
+
+private:
+    bool active_;
+
+    // From the background tcsetpgrp() raises SIGTTOU unless it is blocked
+    static void set_foreground(pid_t group) {
+        sigset_t block, previous;
+        sigemptyset(&block);
+        sigaddset(&block, SIGTTOU);
+        sigprocmask(SIG_BLOCK, &block, &previous);
+        tcsetpgrp(STDIN_FILENO, group);
+        sigprocmask(SIG_SETMASK, &previous, nullptr);
+    }
+};
+
+void set_flags(int fd, bool nonblocking) {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    if (nonblocking) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+bool make_pipe(int fds[2]) {
+    if (pipe(fds) != 0) return false;
+    set_flags(fds[0], true);
+    set_flags(fds[1], false);
+    return true;
+}
+
+void close_fd(int& fd) {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+void write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;  // Terminal gone; keep capturing regardless
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+// Pseudo-terminal for the child's output, sized like ours. Output
+// post-processing is off so newlines reach our terminal unchanged.
+bool open_pty(int& master, int& slave) {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0) return false;
+    const char* name = nullptr;
+    if (grantpt(master) != 0 || unlockpt(master) != 0 || !(name = ptsname(master))) {
+        close_fd(master);
+        return false;
+    }
+    slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        close_fd(master);
+        return false;
+    }
+    set_flags(master, true);
+    set_flags(slave, false);
+
+    struct winsize size {};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) ioctl(master, TIOCSWINSZ, &size);
+    struct termios attributes {};
+    if (tcgetattr(slave, &attributes) == 0) {
+        attributes.c_oflag &= ~static_cast<tcflag_t>(OPOST);
+        tcsetattr(slave, TCSANOW, &attributes);
+    }
+    return true;
+}
+
+// Words of a command with no shell syntax at all, which can skip the shell
+std::optional<std::vector<std::string>> plain_words(const std::string& command) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : command) {
+        if (c == ' ') {
+            if (!word.empty()) words.push_back(std::move(word));
+            word.clear();
+        } else if (std::isalnum(static_cast<unsigned char>(c)) || std::strchr("_-./=:,+@%", c)) {
+            word += c;
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (!word.empty()) words.push_back(std::move(word));
+    if (words.empty() || words[0].find('=') != std::string::npos) return std::nullopt;
+    return words;
+}
+
+std::chrono::microseconds to_micros(const timeval& tv) {
+    return std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec);
+}
+
+} // namespace
+
+RingBuffer::RingBuffer(size_t capacity) : data_(capacity) {}
+
+void RingBuffer::append(std::string_view data) {
+    const size_t capacity = data_.size();
+    if (capacity == 0) return;
+    total_ += data.size();
+    if (data.size() > capacity) data = data.substr(data.size() - capacity);
+
+    size_t first = std::min(data.size(), capacity - head_);
+    std::memcpy(data_.data() + head_, data.data(), first);
+    std::memcpy(data_.data(), data.data() + first, data.size() - first);
+    head_ = (head_ + data.size()) % capacity;
+}
+
+std::string RingBuffer::str() const {
+    if (total_ < data_.size()) return std::string(data_.data(), head_);
+    std::string out(data_.begin() + static_cast<long>(head_), data_.end());
+    out.append(data_.data(), head_);
+    return out;
+}
+
+ExecResult execute_command(const std::string& command, const ExecOptions& options) {
+    ExecResult result;
+    std::cout.flush();
+    std::cerr.flush();
+
+    // Child output: one pseudo-terminal for both streams when we are on a
+    // terminal, else a pipe each
+    int out_read = -1, out_write = -1, err_read = -1, err_write = -1;
+    bool pty = options.echo && isatty(STDOUT_FILENO) && open_pty(out_read, out_write);
+    if (!pty) {
+        int out_pipe[2], err_pipe[2];
+        if (!make_pipe(out_pipe)) {
+            result.error = std::string("pipe: ") + std::strerror(errno);
+            return result;
+        }
+        if (!make_pipe(err_pipe)) {
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+            result.error = std::string("pipe: ") + std::strerror(errno);
+            return result;
+        }
+        out_read = out_pipe[0];
+        out_write = out_pipe[1];
+        err_read = err_pipe[0];
+        err_write = err_pipe[1];
+    }
+
+    int wake[2];
+    if (!make_pipe(wake)) {
+        close_fd(out_read);
+        close_fd(out_write);
+        close_fd(err_read);
+        close_fd(err_write);
+        result.error = std::string("pipe: ") + std::strerror(errno);
+        return result;
+    }
+    set_flags(wake[1], true);
+    SignalScope signals(wake[1]);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out_write, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pty ? out_write : err_write, STDERR_FILENO);
+
+    // The child starts with default handlers and nothing blocked, in a
+    // process group of its own so a timeout or a forwarded signal reaches
+    // everything it starts, not just the shell
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t defaults, empty;
+    sigemptyset(&defaults);
+    for (int sig : kForwarded) sigaddset(&defaults, sig);
+    sigaddset(&defaults, SIGPIPE);
+    sigemptyset(&empty);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setsigmask(&attributes, &empty);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    const auto start = std::chrono::steady_clock::now();
+    pid_t pid = -1;
+    int spawn_error = ENOENT;
+    if (auto words = plain_words(command)) {
+        std::vector<char*> argv;
+        for (auto& w : *words) argv.push_back(w.data());
+        argv.push_back(nullptr);
+        spawn_error = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+    }
+    if (spawn_error == ENOENT) {
+        // Shell syntax, builtins, or a program we could not find directly
+        std::string shell_command = command;
+        char sh[] = "/bin/sh", dash_c[] = "-c";
+        char* argv[] = {sh, dash_c, shell_command.data(), nullptr};
+        spawn_error = posix_spawn(&pid, "/bin/sh", &actions, &attributes, argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close_fd(out_write);
+    close_fd(err_write);
+
+    if (spawn_error != 0) {
+        close_fd(out_read);
+        close_fd(err_read);
+        close(wake[0]);
+        close(wake[1]);
+        result.error = std::string("posix_spawn: ") + std::strerror(spawn_error);
+        return result;
+    }
+    result.started = true;
+    g_child = pid;
+    TerminalHandoff terminal;
+    terminal.give(pid);
+
+    RingBuffer tail(options.capture_bytes);
+    const bool has_deadline = options.timeout.count() > 0;
+    const auto deadline = start + options.timeout;
+    std::chrono::steady_clock::time_point kill_at;
+
+    pollfd fds[3] = {{wake[0], POLLIN, 0}, {out_read, POLLIN, 0}, {err_read, POLLIN, 0}};
+    const int echo_to[3] = {-1, STDOUT_FILENO, STDERR_FILENO};
+    char buffer[64 * 1024];
+
+    // Returns false once the stream has ended
+    auto pump = [&](size_t i) {
+        while (true) {
+            ssize_t n = read(fds[i].fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                if (options.echo) write_all(echo_to[i], buffer, static_cast<size_t>(n));
+                tail.append(std::string_view(buffer, static_cast<size_t>(n)));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            return false;  // EOF, or EIO from a pty whose last writer closed
+        }
+    };
+
+    int status = 0;
+    struct rusage usage {};
+    bool exited = false;
+    while (!exited) {
+        exited = wait4(pid, &status, WNOHANG | WUNTRACED, &usage) == pid;
+        if (exited && WIFSTOPPED(status)) {
+            // Ctrl-Z: suspend along with it, and continue it when resumed
+            exited = false;
+            if (terminal.active()) {
+                terminal.take_back();
+                kill(0, SIGTSTP);
+                terminal.give(pid);
+            }
+            continue;
+        }
+        if (exited) break;
+
+        int timeout_ms = -1;
+        auto now = std::chrono::steady_clock::now();
+        if (has_deadline) {
+            auto until = result.timed_out ? kill_at : deadline;
+            if (now >= until) {
+                // Ask politely first, then insist
+                kill(-pid, result.timed_out ? SIGKILL : SIGTERM);
+                if (!result.timed_out) {
+                    result.timed_out = true;
+                    kill_at = now + kKillGrace;
+                    until = kill_at;
+                } else {
+                    until = now + kKillGrace;
+                }
+            }
+            timeout_ms = static_cast<int>(
+                std::max<long long>(1, std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count()));
+        }
+
+        if (poll(fds, 3, timeout_ms) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            char signals_seen[64];
+            ssize_t n = read(fds[0].fd, signals_seen, sizeof(signals_seen));
+            bool resized = n > 0 && std::memchr(signals_seen, SIGWINCH, static_cast<size_t>(n));
+            if (resized && pty) {
+                struct winsize size {};
+                if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) ioctl(fds[1].fd, TIOCSWINSZ, &size);
+                kill(-pid, SIGWINCH);
+            }
+        }
+        for (size_t i = 1; i < 3; ++i) {
+            if (fds[i].fd >= 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !pump(i)) {
+                close(fds[i].fd);
+                fds[i].fd = -1;  // poll skips negative descriptors
+            }
+        }
+    }
+    if (!exited) wait4(pid, &status, 0, &usage);
+    terminal.take_back();
+    g_child = 0;
+    result.wall = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    // Whatever the child wrote just before exiting. Background jobs it left
+    // behind may hold the pipes open, so only take what is already there.
+    for (size_t i = 1; i < 3; ++i) {
+        if (fds[i].fd < 0) continue;
+        pump(i);
+        close(fds[i].fd);
+    }
+    close(wake[0]);
+    close(wake[1]);
+
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.signal = WTERMSIG(status);
+        result.exit_code = 128 + result.signal;
+    }
+    result.user_cpu = to_micros(usage.ru_utime);
+    result.system_cpu = to_micros(usage.ru_stime);
+#ifdef __APPLE__
+    result.max_rss_kb = usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    result.max_rss_kb = usage.ru_maxrss;
+#endif
+    result.output_tail = tail.str();
+    result.truncated = tail.overflowed();
+    return result;
+}
+
+} // namespace neuron
@@ -0,0 +1,262 @@
+#include "neuron/history.hpp"
+#include "neuron/file_lock.hpp"
+#include "neuron/hash.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace neuron {
+
+namespace {
+
+constexpr uint32_t kRecordMagic = 0x3148524e;  // "NRH1"
+constexpr size_t kMaxResponse = 64 * 1024;     // Longer answers are cut
+constexpr int64_t kOrderSlack = 60LL * 1000 * 1000;
+
+enum RecordFlags : uint8_t {
+    CACHED = 1,
+    OFFLINE = 2,
+    DAEMON = 4,
+    CHAT = 8,
+    EXECUTED = 16,
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;           // Whole record including padding, a multiple of 8
+    int64_t time_us;
+    uint32_t latency_ms;
+    int32_t exit_code;
+    uint32_t prompt_length;
+    uint32_t response_length;
+    uint8_t mode;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t checksum;         // Over the header with this field zero, then the text
+};
+
+static_assert(sizeof(RecordHeader) == 40, "records must stay 8-byte aligned");
+
+uint64_t record_length(uint64_t prompt_length, uint64_t response_length) {
+    return (sizeof(RecordHeader) + prompt_length + response_length + 7) & ~uint64_t{7};
+}
+
+// Word-at-a-time multiplicative hash; catches torn and overwritten records
+// at a fraction of the cost of a bytewise one
+uint64_t hash_bytes(const char* data, size_t size, uint64_t h) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return mix64((h ^ tail ^ size) * 0x9e3779b97f4a7c15ULL);
+}
+
+uint32_t checksum(const RecordHeader& header, std::string_view prompt, std::string_view response) {
+    RecordHeader copy = header;
+    copy.checksum = 0;
+    uint64_t h = hash_bytes(reinterpret_cast<const char*>(&copy), sizeof(copy), 0xcbf29ce484222325ULL);
+    h = hash_bytes(prompt.data(), prompt.size(), h);
+    return static_cast<uint32_t>(hash_bytes(response.data(), response.size(), h));
+}
+
+void encode(const HistoryEntry& entry, std::string& out) {
+    std::string_view response = entry.response;
+    if (response.size() > kMaxResponse) {
+        response = response.substr(0, kMaxResponse);
+        while (!response.empty() && (static_cast<unsigned char>(response.back()) & 0xc0) == 0x80) {
+            response.remove_suffix(1);
+        }
+        if (!response.empty() && static_cast<unsigned char>(response.back()) >= 0xc0) response.remove_suffix(1);
+    }
+
+    RecordHeader header{};
+    header.magic = kRecordMagic;
+    header.length = static_cast<uint32_t>(record_length(entry.prompt.size(), response.size()));
+    header.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.latency_ms = entry.latency_ms;
+    header.exit_code = entry.exit_code;
+    header.prompt_length = static_cast<uint32_t>(entry.prompt.size());
+    header.response_length = static_cast<uint32_t>(response.size());
+    header.mode = static_cast<uint8_t>(entry.mode);
+    header.flags = static_cast<uint8_t>((entry.cached ? CACHED : 0) | (entry.offline ? OFFLINE : 0) |
+                                        (entry.daemon ? DAEMON : 0) | (entry.chat ? CHAT : 0) |
+                                        (entry.executed ? EXECUTED : 0));
+    header.checksum = checksum(header, entry.prompt, response);
+
+    size_t start = out.size();
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out += entry.prompt;
+    out += response;
+    out.resize(start + header.length, '\0');
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+std::string history_path(const std::string& data_directory) {
+    return data_directory + "/history.log";
+}
+
+HistoryWriter::HistoryWriter(std::string path) : path_(std::move(path)) {}
+
+HistoryWriter::~HistoryWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void HistoryWriter::append(const HistoryEntry& entry) {
+    std::string record;
+    encode(entry, record);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_ += record;
+        if (!worker_.joinable()) {
+            worker_ = std::thread([this] { drain(); });
+        }
+    }
+    ready_.notify_one();
+}
+
+void HistoryWriter::drain() {
+    int fd = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        ready_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+        if (queued_.empty() && stopping_) break;
+
+        // Everything queued so far goes out in one write
+        std::string batch;
+        batch.swap(queued_);
+        lock.unlock();
+        if (fd >= 0) {
+            FileLock file_lock(fd);
+            write_all(fd, batch.data(), batch.size());
+        }
+        lock.lock();
+    }
+    if (fd >= 0) close(fd);
+}
+
+HistoryReader::HistoryReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return;
+        throw std::runtime_error("Cannot open history: " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read history: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map history: " + path);
+        }
+        madvise(map, size_, MADV_SEQUENTIAL);
+        map_ = static_cast<const char*>(map);
+    }
+    close(fd);
+}
+
+HistoryReader::~HistoryReader() {
+    if (map_) munmap(const_cast<char*>(map_), size_);
+}
+
+size_t HistoryReader::next_record(size_t offset, HistoryRecord* record) const {
+    const char magic[4] = {'N', 'R', 'H', '1'};
+    while (offset + sizeof(RecordHeader) <= size_) {
+        RecordHeader header;
+        std::memcpy(&header, map_ + offset, sizeof(header));
+        bool intact = header.magic == kRecordMagic && header.length <= size_ - offset &&
+                      header.length == record_length(header.prompt_length, header.response_length);
+        if (intact) {
+            std::string_view prompt(map_ + offset + sizeof(RecordHeader), header.prompt_length);
+            std::string_view response(prompt.data() + prompt.size(), header.response_length);
+            if (checksum(header, prompt, response) == header.checksum) {
+                if (record) {
+                    record->time_us = header.time_us;
+                    record->mode = static_cast<Mode>(header.mode);
+                    record->prompt = prompt;
+                    record->response = response;
+                    record->latency_ms = header.latency_ms;
+                    record->exit_code = header.exit_code;
+                    record->cached = header.flags & CACHED;
+                    record->offline = header.flags & OFFLINE;
+                    record->daemon = header.flags & DAEMON;
+                    record->chat = header.flags & CHAT;
+                    record->executed = header.flags & EXECUTED;
+                }
+                return offset;
+            }
+        }
+
+        // Torn or foreign bytes: skip to the next thing that looks like a record
+        const void* found = memmem(map_ + offset + 1, size_ - offset - 1, magic, sizeof(magic));
+        if (!found) break;
+        offset = static_cast<size_t>(static_cast<const char*>(found) - map_);
+    }
+    return size_;
+}
+
+void HistoryReader::scan(int64_t since_us, const std::function<bool(const HistoryRecord&)>& visit) const {
+    if (!map_) return;
+
+    // Narrow down to the last stretch that starts before since, minus slack
+    size_t low = 0, high = size_;
+    if (since_us > 0) {
+        HistoryRecord probe;
+        while (high - low > 64 * 1024) {
+            size_t mid = low + (high - low) / 2;
+            size_t at = next_record(mid, &probe);
+            if (at >= high || probe.time_us >= since_us - kOrderSlack) {
+                high = mid;
+            } else {
+                low = at;
+            }
+        }
+    }
+
+    HistoryRecord record;
+    for (size_t offset = next_record(low, &record); offset < size_;
+         offset = next_record(offset + record_length(record.prompt.size(), record.response.size()), &record)) {
+        if (record.time_us < since_us) continue;
+        if (!visit(record)) break;
+    }
+}
+
+} // namespace neuron
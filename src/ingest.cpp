@@ -0,0 +1,212 @@
+#include "neuron/ingest.hpp"
+#include "neuron/batch.hpp"
+#include "neuron/prompt_template.hpp"
+#include "neuron/trace.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <map>
+#include <nlohmann/json.hpp>
+
+namespace neuron {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t kBytesPerToken = 4;  // As estimate_tokens counts
+
+constexpr auto kStdinQuestion = minify_prompt(R"(
+    {question}
+    Input:
+)");
+
+constexpr auto kMapPrompt = minify_prompt(R"(
+    A large input was piped in with this question: {question}
+    This is part {part} of it, lines {lines}. List only what in this part bears on the question
+    (errors, warnings, failing steps, relevant values or settings), with line numbers, in at most
+    8 short bullet points. If nothing does, reply with just NONE.
+)");
+
+constexpr auto kMergePrompt = minify_prompt(R"(
+    These notes were taken in order from consecutive parts of a large input, for the question: {question}
+    Merge them into at most 12 bullet points. Keep every fact that bears on the question, with its
+    line numbers; drop repeats.
+)");
+
+constexpr auto kReducePrompt = minify_prompt(R"(
+    Answer this question about a large piped input: {question}
+    The input was too large to send at once, so these notes were taken from each part of it, in
+    order. Answer from the notes, and say so if they are not enough.
+)");
+
+std::string trimmed(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+// "NONE", possibly with punctuation or formatting around it
+bool nothing_relevant(const std::string& note) {
+    std::string letters;
+    for (char c : note) {
+        if (std::isalpha(static_cast<unsigned char>(c))) letters += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return letters.empty() || letters == "NONE";
+}
+
+std::string joined(const std::deque<std::string>& notes) {
+    std::string text;
+    for (const auto& note : notes) text += note + "\n\n";
+    return text;
+}
+
+std::string line_range(const Chunk& chunk) {
+    if (chunk.first_line == chunk.last_line) return std::to_string(chunk.first_line);
+    return std::to_string(chunk.first_line) + "-" + std::to_string(chunk.last_line);
+}
+
+} // namespace
+
+IngestOptions IngestOptions::from_config(const Config& config) {
+    IngestOptions options;
+    options.chunk_tokens = static_cast<size_t>(std::max(256L, config.getLong("NEURON_STDIN_CHUNK_TOKENS", 3000)));
+    options.concurrency = static_cast<size_t>(std::max(1L, config.getLong("NEURON_STDIN_CONCURRENCY", 4)));
+    return options;
+}
+
+ChunkReader::ChunkReader(std::istream& in, size_t max_bytes) : in_(in), max_bytes_(std::max<size_t>(max_bytes, 1)) {}
+
+std::optional<Chunk> ChunkReader::next() {
+    char block[16384];
+    while (!eof_ && buffer_.size() < max_bytes_) {
+        size_t want = std::min(sizeof(block), max_bytes_ - buffer_.size());
+        in_.read(block, static_cast<std::streamsize>(want));
+        size_t got = static_cast<size_t>(in_.gcount());
+        buffer_.append(block, got);
+        bytes_read_ += got;
+        if (got < want) eof_ = true;
+    }
+    // So input of exactly one piece is known to be done with it
+    if (!eof_ && in_.peek() == std::char_traits<char>::eof()) eof_ = true;
+    if (buffer_.empty()) return std::nullopt;
+
+    // Up to the last line break that fits; a longer line is split where it must be
+    size_t cut = buffer_.size();
+    if (!eof_ || buffer_.size() > max_bytes_) {
+        size_t newline = buffer_.rfind('\n', max_bytes_ - 1);
+        cut = newline == std::string::npos ? std::min(max_bytes_, buffer_.size()) : newline + 1;
+    }
+
+    Chunk chunk;
+    chunk.text = buffer_.substr(0, cut);
+    buffer_.erase(0, cut);
+    chunk.first_line = line_;
+    line_ += static_cast<size_t>(std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+    chunk.last_line = chunk.text.back() == '\n' ? line_ - 1 : line_;
+    return chunk;
+}
+
+IngestRunner::IngestRunner(AIClient& client, const IngestOptions& options)
+    : client_(client), options_(options) {}
+
+std::optional<std::string> IngestRunner::run(const std::string& question, Chunk first, ChunkReader& reader,
+                                             const TokenCallback& on_token) {
+    const size_t notes_budget = options_.chunk_tokens * kBytesPerToken;
+
+    // Notes arrive in input order, one per part that had any
+    std::deque<std::string> notes;
+    size_t notes_size = 0;
+
+    // Parts are made as the batch runner asks for them, so only the ones in
+    // flight are held. Once the notes outgrow the budget no more are taken:
+    // the batch finishes those in flight and the notes are merged before the
+    // next round, rather than with every other part waiting on the merge.
+    std::optional<Chunk> waiting = std::move(first);
+    std::map<size_t, std::string> ranges;  // Lines of each part in flight, by index in the round
+    size_t round_index = 0;
+    bool over_budget = false;
+    auto next_line = [&](std::string& line) {
+        if (notes_size > notes_budget) {
+            over_budget = true;
+            return false;
+        }
+        std::optional<Chunk> chunk = waiting ? std::move(waiting) : reader.next();
+        waiting.reset();
+        if (!chunk) return false;
+
+        size_t index = round_index++;
+        ranges[index] = line_range(*chunk);
+        std::string prompt = fill_prompt(kMapPrompt.view(), "{part}", std::to_string(++parts_));
+        prompt = fill_prompt(prompt, "{lines}", ranges[index]);
+        prompt = fill_prompt(prompt, "{question}", question) + "\n\n" + chunk->text;
+        line = json{{"mode", "tell"}, {"prompt", std::move(prompt)}}.dump();
+        return true;
+    };
+    auto collect = [&](const std::string& line) {
+        json result = json::parse(line, nullptr, false);
+        if (!result.is_object()) return;
+        size_t index = result.value("index", size_t{0});
+        std::string lines = std::move(ranges[index]);
+        ranges.erase(index);
+
+        if (!result.value("ok", false)) {
+            ++failed_;
+            return;
+        }
+        std::string note = trimmed(result.value("content", ""));
+        if (nothing_relevant(note)) return;
+        notes.push_back("Lines " + lines + ":\n" + note);
+        notes_size += notes.back().size();
+    };
+
+    // Merges the notes into one; if that fails the oldest are dropped
+    // instead, so they never grow past the budget
+    auto merge = [&] {
+        TraceSpan span("ingest merge", "client");
+        auto merged = client_.run(fill_prompt(kMergePrompt.view(), "{question}", question) + "\n\n" + joined(notes),
+                                  Mode::TELL);
+        if (merged) {
+            notes.assign(1, trimmed(*merged));
+            ++merges_;
+        } else {
+            while (notes.size() > 1 && notes_size > notes_budget) {
+                notes_size -= notes.front().size();
+                notes.pop_front();
+                ++dropped_;
+            }
+            span.set_detail("failed");
+        }
+        if (notes.size() == 1 && notes.front().size() > notes_budget) notes.front().resize(notes_budget);
+        notes_size = 0;
+        for (const auto& note : notes) notes_size += note.size();
+    };
+
+    {
+        TraceSpan span("ingest map", "client");
+        BatchOptions batch;
+        batch.concurrency = options_.concurrency;
+        batch.ordered = true;
+        do {
+            over_budget = false;
+            round_index = 0;
+            BatchRunner(client_, batch).run(next_line, collect);
+            if (over_budget) merge();
+        } while (over_budget);
+        span.set_detail(std::to_string(parts_) + " parts");
+    }
+    if (parts_ == failed_) return std::nullopt;
+
+    std::string text = notes.empty() ? "(No part of the input bears on the question.)" : trimmed(joined(notes));
+    TraceSpan span("ingest reduce", "client");
+    return client_.run(fill_prompt(kReducePrompt.view(), "{question}", question) + "\n\n" + text,
+                       Mode::TELL, on_token);
+}
+
+std::string stdin_question(const std::string& question, const std::string& input) {
+    return fill_prompt(kStdinQuestion.view(), "{question}", question) + "\n" + input;
+}
+
+} // namespace neuron
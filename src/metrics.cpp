@@ -0,0 +1,279 @@
+#include "neuron/metrics.hpp"
+#include "neuron/file_lock.hpp"
+#include "neuron/paths.hpp"
+
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+namespace neuron {
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Family {
+    const char* name;
+    const char* type;
+    const char* help;
+};
+
+constexpr Family kFamilies[] = {
+    {"neuron_cache_lookups_total", "counter", "Response cache lookups by result"},
+    {"neuron_request_duration_seconds", "histogram", "Time from preparing a request to its full answer, retries included"},
+    {"neuron_request_errors_total", "counter", "Failed request attempts by HTTP status or curl error code"},
+    {"neuron_tokens_total", "counter", "Tokens used as reported by the API"},
+};
+
+std::string escape_label(std::string_view value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// name{a="x",b="y"}, the key of one series
+std::string series_key(std::string_view name, Metrics::Labels labels) {
+    std::string key(name);
+    key += '{';
+    bool first = true;
+    for (const auto& [label, value] : labels) {
+        if (!first) key += ',';
+        first = false;
+        key += std::string(label) + "=\"" + escape_label(value) + "\"";
+    }
+    key += '}';
+    return key;
+}
+
+// Splits a series key into its name and what is between the braces
+std::pair<std::string_view, std::string_view> split_key(std::string_view key) {
+    size_t brace = key.find('{');
+    if (brace == std::string_view::npos) return {key, {}};
+    return {key.substr(0, brace), key.substr(brace + 1, key.size() - brace - 2)};
+}
+
+std::string format_number(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Replaces path with contents in one rename
+bool write_file(const std::string& path, const std::string& contents, mode_t mode) {
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd < 0) return false;
+    bool written = write_all(fd, contents.data(), contents.size());
+    close(fd);
+    if (!written || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string parent_of(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos || slash == 0 ? "" : path.substr(0, slash);
+}
+
+} // namespace
+
+MetricsOptions MetricsOptions::from_config(const Config& config) {
+    MetricsOptions options;
+    options.textfile = config.getValue("NEURON_METRICS_FILE").value_or("");
+    if (options.textfile.empty() && !config.getFlag("NEURON_METRICS", false)) return options;
+
+    std::string directory = cache_dir();
+    if (options.textfile.empty() && !directory.empty()) options.textfile = directory + "/metrics.prom";
+    if (!directory.empty()) options.state_path = directory + "/metrics.json";
+    options.listen = config.getValue("NEURON_METRICS_LISTEN").value_or("");
+    // Every interface only when asked for by address
+    if (options.listen.starts_with(':')) options.listen.insert(0, "127.0.0.1");
+    return options;
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::enable(const MetricsOptions& options) {
+    if (options.textfile.empty()) return;
+    std::string parent = parent_of(options.textfile);
+    if (!parent.empty()) make_dirs(parent);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+int64_t Metrics::bucket_bound(size_t i) {
+    if (i == 0) return int64_t{1} << kFirstExponent;
+    size_t octave = (i - 1) / kSubBuckets;
+    size_t sub = (i - 1) % kSubBuckets;
+    int64_t base = int64_t{1} << (kFirstExponent + octave);
+    return base + base * static_cast<int64_t>(sub + 1) / kSubBuckets;
+}
+
+size_t Metrics::bucket_for(int64_t microseconds) {
+    if (microseconds <= (int64_t{1} << kFirstExponent)) return 0;
+
+    // microseconds is in (2^exponent, 2^(exponent + 1)]
+    auto value = static_cast<uint64_t>(microseconds);
+    int exponent = static_cast<int>(std::bit_width(value - 1)) - 1;
+    if (exponent > kLastExponent) return kBuckets;
+    uint64_t base = uint64_t{1} << exponent;
+    uint64_t sub = ((value - base) * kSubBuckets + base - 1) / base - 1;
+    return 1 + static_cast<size_t>(exponent - kFirstExponent) * kSubBuckets + sub;
+}
+
+void Metrics::count(std::string_view name, Labels labels, double value) {
+    if (!enabled()) return;
+    std::string key = series_key(name, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.counters[key] += value;
+}
+
+void Metrics::observe(std::string_view name, Labels labels, std::chrono::microseconds duration) {
+    if (!enabled()) return;
+    std::string key = series_key(name, labels);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Histogram& histogram = pending_.histograms[key];
+    ++histogram.counts[bucket_for(duration.count())];
+    histogram.sum += static_cast<double>(duration.count()) / 1e6;
+}
+
+bool Metrics::merge(Snapshot& totals) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto add = [](Snapshot& into, const Snapshot& from) {
+        for (const auto& [key, value] : from.counters) into.counters[key] += value;
+        for (const auto& [key, histogram] : from.histograms) {
+            Histogram& target = into.histograms[key];
+            for (size_t i = 0; i < histogram.counts.size(); ++i) target.counts[i] += histogram.counts[i];
+            target.sum += histogram.sum;
+        }
+    };
+
+    if (options_.state_path.empty()) {
+        add(totals_, pending_);
+        pending_ = Snapshot{};
+        totals = totals_;
+        return write_file(options_.textfile, render(totals), 0644);
+    }
+
+    // The lock lives in its own file, since the state file is replaced on every write
+    int fd = open((options_.state_path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    bool written = false;
+    {
+        FileLock file_lock(fd);
+        std::ifstream in(options_.state_path, std::ios::binary);
+        json state = json::parse(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(), nullptr, false);
+        if (state.is_object()) {
+            const json counters = state.value("counters", json::object());
+            for (const auto& [key, value] : counters.items()) {
+                if (value.is_number()) totals.counters[key] = value.get<double>();
+            }
+            const json histograms = state.value("histograms", json::object());
+            for (const auto& [key, value] : histograms.items()) {
+                const json counts = value.is_object() ? value.value("counts", json::array()) : json::array();
+                if (counts.size() != kBuckets + 1) continue;  // Other bucket layout
+                Histogram& histogram = totals.histograms[key];
+                for (size_t i = 0; i < counts.size(); ++i) histogram.counts[i] = counts[i].is_number() ? counts[i].get<uint64_t>() : 0;
+                histogram.sum = value.value("sum", 0.0);
+            }
+        }
+        add(totals, pending_);
+
+        json saved = {{"counters", totals.counters}, {"histograms", json::object()}};
+        for (const auto& [key, histogram] : totals.histograms) {
+            saved["histograms"][key] = {{"counts", histogram.counts}, {"sum", histogram.sum}};
+        }
+        if (write_file(options_.state_path, saved.dump(), 0600)) {
+            pending_ = Snapshot{};
+            written = write_file(options_.textfile, render(totals), 0644);
+        }
+    }
+    close(fd);
+    return written;
+}
+
+bool Metrics::flush() {
+    if (!enabled()) return false;
+    Snapshot totals;
+    return merge(totals);
+}
+
+std::string Metrics::exposition() {
+    Snapshot totals;
+    merge(totals);
+    return render(totals);
+}
+
+std::string Metrics::render(const Snapshot& totals) {
+    std::string text;
+    auto header = [&](std::string_view name) {
+        for (const Family& family : kFamilies) {
+            if (name != family.name) continue;
+            text += std::string("# HELP ") + family.name + " " + family.help + "\n";
+            text += std::string("# TYPE ") + family.name + " " + family.type + "\n";
+            return;
+        }
+        text += "# TYPE " + std::string(name) + " untyped\n";
+    };
+
+    // Keys sort by name first, so each family's series are together
+    std::string_view current;
+    for (const auto& [key, value] : totals.counters) {
+        auto [name, labels] = split_key(key);
+        if (name != current) header(current = name);
+        text += key + " " + format_number(value) + "\n";
+    }
+
+    current = {};
+    for (const auto& [key, histogram] : totals.histograms) {
+        auto [name, labels] = split_key(key);
+        if (name != current) header(current = name);
+        std::string prefix = std::string(name) + "_bucket{" + std::string(labels) + (labels.empty() ? "" : ",");
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            cumulative += histogram.counts[i];
+            text += prefix + "le=\"" + format_number(static_cast<double>(bucket_bound(i)) / 1e6) + "\"} " +
+                    std::to_string(cumulative) + "\n";
+        }
+        cumulative += histogram.counts[kBuckets];
+        text += prefix + "le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+        std::string suffix = labels.empty() ? "" : "{" + std::string(labels) + "}";
+        text += std::string(name) + "_sum" + suffix + " " + format_number(histogram.sum) + "\n";
+        text += std::string(name) + "_count" + suffix + " " + std::to_string(cumulative) + "\n";
+    }
+    return text;
+}
+
+} // namespace neuron
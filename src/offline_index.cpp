@@ -0,0 +1,655 @@
+#include "neuron/offline_index.hpp"
+#include "neuron/actions.hpp"
+#include "neuron/file_lock.hpp"
+#include "neuron/hash.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace neuron {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x31494f4e;   // "NOI1"
+constexpr uint32_t kVersion = 2;
+constexpr size_t kPostingBudget = 8192;  // Postings read per lookup at most
+constexpr size_t kCandidates = 32;       // Entries scored exactly per lookup
+constexpr size_t kDeltaLimit = 256;      // Log entries past the index before it is rebuilt
+
+// Alternative phrasings are separated by '|'. Prompts avoid numbers and
+// paths unless the command depends on them, since those must match exactly.
+struct Seed {
+    const char* prompts;
+    const char* command;
+};
+
+constexpr Seed kSeed[] = {
+    {"list files|list all files including hidden ones|show hidden files", "ls -la"},
+    {"list files with permissions|show file permissions", "ls -l"},
+    {"sort files by size|list files by size", "ls -lSh"},
+    {"list newest files first|sort files by modification time", "ls -lt"},
+    {"show the current directory|where am i", "pwd"},
+    {"show directory tree|show the folder structure", "find . -maxdepth 2 -not -path '*/.git*' | sort"},
+    {"find the largest files|find large files|find big files",
+     "find . -type f -exec du -h {} + | sort -rh | head -n 20"},
+    {"find files larger than 100mb", "find . -type f -size +100M -exec ls -lh {} +"},
+    {"find files larger than 1gb", "find . -type f -size +1G -exec ls -lh {} +"},
+    {"show the largest directories|which folders use the most space",
+     "du -h --max-depth=1 . | sort -rh | head -n 20"},
+    {"show size of the current directory|how big is this folder", "du -sh ."},
+    {"find files modified today|find files changed in the last day", "find . -type f -mtime -1"},
+    {"find files modified in the last hour", "find . -type f -mmin -60"},
+    {"find empty files", "find . -type f -empty"},
+    {"find empty directories", "find . -type d -empty"},
+    {"find broken symlinks|find broken symbolic links", "find . -xtype l"},
+    {"find duplicate files", "find . -type f -exec md5sum {} + | sort | uniq -w32 -dD"},
+    {"find all python files", "find . -name '*.py'"},
+    {"count files in the current directory|how many files are here", "find . -type f | wc -l"},
+    {"count lines of code|count lines in all files",
+     "find . -type f -not -path '*/.git/*' -exec cat {} + | wc -l"},
+    {"show disk usage|check disk space|how much disk space is free", "df -h"},
+    {"list block devices|show disks", "lsblk"},
+    {"show mounted filesystems|list mounts", "findmnt"},
+    {"show memory usage|how much ram is free|check free memory", "free -h"},
+    {"show running processes|list processes", "ps aux"},
+    {"show processes using the most cpu|top cpu processes", "ps aux --sort=-%cpu | head -n 15"},
+    {"show processes using the most memory|top memory processes", "ps aux --sort=-%mem | head -n 15"},
+    {"how many cpu cores do i have|count cpu cores", "nproc"},
+    {"show cpu information|show cpu details", "lscpu"},
+    {"show system uptime|how long has the system been running", "uptime"},
+    {"when did the system last reboot|show last reboot", "last reboot | head -n 5"},
+    {"show kernel version|which kernel am i running", "uname -r"},
+    {"show os version|which linux distribution is this", "cat /etc/os-release"},
+    {"show current user|who am i", "whoami"},
+    {"show logged in users|who is logged in", "who"},
+    {"show the date and time|what time is it", "date"},
+    {"show a calendar", "cal"},
+    {"show environment variables", "env | sort"},
+    {"show the path variable|print my path", "echo \"$PATH\" | tr ':' '\\n'"},
+    {"clear the terminal|clear the screen", "clear"},
+    {"show system logs|show recent log messages", "journalctl -n 100 --no-pager"},
+    {"follow system logs|tail the system log", "journalctl -f"},
+    {"show failed services|list failed systemd units", "systemctl --failed"},
+    {"list running services", "systemctl list-units --type=service --state=running"},
+    {"show boot time|how long did boot take", "systemd-analyze"},
+    {"show my ip address|what is my local ip", "ip -brief address"},
+    {"what is my public ip address|show my external ip", "curl -s https://ifconfig.me"},
+    {"show listening ports|which ports are open|list open ports", "ss -tulpn"},
+    {"show routing table|show routes", "ip route"},
+    {"show dns servers", "cat /etc/resolv.conf"},
+    {"test internet connection|check if i am online", "ping -c 4 1.1.1.1"},
+    {"start a simple http server|serve the current directory over http", "python3 -m http.server 8000"},
+    {"generate a random password", "openssl rand -base64 24"},
+    {"generate a uuid", "uuidgen"},
+    {"create an ssh key|generate an ssh key", "ssh-keygen -t ed25519"},
+    {"show git status|what changed in this repo", "git status"},
+    {"show git log|show recent commits", "git log --oneline -n 20"},
+    {"show git log as a graph|show branch graph", "git log --oneline --graph --all -n 30"},
+    {"show unstaged changes|show git diff", "git diff"},
+    {"show staged changes", "git diff --cached"},
+    {"show files changed in the last commit", "git show --stat HEAD"},
+    {"list git branches|show all branches", "git branch -a"},
+    {"show current git branch|which branch am i on", "git branch --show-current"},
+    {"show git remotes", "git remote -v"},
+    {"list untracked files", "git ls-files --others --exclude-standard"},
+    {"undo the last commit but keep changes|undo the last git commit", "git reset --soft HEAD~1"},
+    {"amend the last commit", "git commit --amend"},
+    {"stash my changes", "git stash push"},
+    {"apply the latest stash|pop the stash", "git stash pop"},
+    {"pull latest changes", "git pull --rebase"},
+    {"delete merged branches", "git branch --merged | grep -vE '^\\*|main|master' | xargs -r git branch -d"},
+    {"list running containers|show docker containers", "docker ps"},
+    {"list all containers", "docker ps -a"},
+    {"list docker images", "docker images"},
+    {"show docker disk usage", "docker system df"},
+    {"show container resource usage|docker stats", "docker stats --no-stream"},
+    {"remove stopped containers", "docker container prune"},
+    {"clean up docker|free docker disk space", "docker system prune"},
+};
+
+// Words that carry no meaning for command lookup
+const std::unordered_set<std::string_view>& filler_words() {
+    static const std::unordered_set<std::string_view> words = {
+        "a", "an", "the", "please", "me", "my", "i", "we", "can", "could", "would", "you",
+        "how", "do", "some", "that", "this", "these", "those", "just", "want", "need",
+        "is", "are", "there", "it", "its", "of", "command", "give", "get",
+    };
+    return words;
+}
+
+bool is_token_char(unsigned char c) {
+    return std::isalnum(c) || (c && std::strchr("._/-~*:$=+@%", c) != nullptr);
+}
+
+// Anything that looks like a number, path, flag, glob or extension
+bool is_literal(std::string_view token) {
+    return std::any_of(token.begin(), token.end(), [](unsigned char c) {
+        return std::isdigit(c) || (c && std::strchr("./_~*:$=+@%-", c) != nullptr);
+    });
+}
+
+struct Normalized {
+    std::string key;              // Words joined by single spaces
+    std::vector<uint32_t> grams;  // Sorted, unique
+    uint64_t anchors = 0;         // Hash of the literals and kinds of action, in any order
+};
+
+Normalized normalize(std::string_view prompt) {
+    Normalized out;
+    std::vector<std::string> literals;
+    std::set<std::string_view> kinds;
+    std::string token;
+    auto flush = [&] {
+        while (!token.empty() && (token.back() == '.' || token.back() == ':')) token.pop_back();
+        if (token.empty() || filler_words().count(token)) {
+            token.clear();
+            return;
+        }
+        if (is_literal(token)) literals.push_back(token);
+        std::string_view kind = action_kind(token);
+        if (!kind.empty()) kinds.insert(kind);
+        if (!out.key.empty()) out.key += ' ';
+        out.key += token;
+
+        std::string padded = " " + token + " ";
+        for (size_t i = 0; i + 2 < padded.size(); ++i) {
+            out.grams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(padded[i])) << 16 |
+                                static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+                                static_cast<unsigned char>(padded[i + 2]));
+        }
+        token.clear();
+    };
+    for (unsigned char c : prompt) {
+        if (is_token_char(c)) {
+            token += static_cast<char>(std::tolower(c));
+        } else {
+            flush();
+        }
+    }
+    flush();
+
+    std::sort(out.grams.begin(), out.grams.end());
+    out.grams.erase(std::unique(out.grams.begin(), out.grams.end()), out.grams.end());
+
+    if (!literals.empty() || !kinds.empty()) {
+        std::sort(literals.begin(), literals.end());
+        Hasher hasher;
+        for (const auto& literal : literals) hasher.feed(literal);
+        for (std::string_view kind : kinds) hasher.feed("action").feed(kind);
+        out.anchors = hasher.digest().lo;
+    }
+    return out;
+}
+
+// Dice coefficient of two sorted, unique trigram sets
+float dice(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size) {
+    size_t shared = 0;
+    for (size_t i = 0, j = 0; i < a_size && j < b_size;) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            ++shared, ++i, ++j;
+        }
+    }
+    return 2.0f * static_cast<float>(shared) / static_cast<float>(a_size + b_size);
+}
+
+uint64_t seed_hash() {
+    Hasher hasher;
+    hasher.feed(std::string_view(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion)));
+    for (const auto& seed : kSeed) hasher.feed(seed.prompts).feed(seed.command);
+    return hasher.digest().lo;
+}
+
+// accepted.log holds one "prompt<TAB>command" line per accepted command
+std::string escape_field(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '\t') out += "\\t";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+std::string unescape_field(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            char c = text[++i];
+            out += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+// Calls add(prompt, command) for every complete line of the log
+template <typename Add>
+void parse_log(std::string_view log, Add&& add) {
+    for (size_t start = 0; start < log.size();) {
+        size_t end = log.find('\n', start);
+        if (end == std::string_view::npos) break;
+        std::string_view line = log.substr(start, end - start);
+        size_t tab = line.find('\t');
+        if (tab != std::string_view::npos) {
+            add(unescape_field(line.substr(0, tab)), unescape_field(line.substr(tab + 1)));
+        }
+        start = end + 1;
+    }
+}
+
+// Bytes of the log from offset on, up to its last complete line
+std::string read_log(const std::string& path, uint64_t offset) {
+    std::string log;
+    int fd = path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return log;
+    char buffer[64 * 1024];
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), static_cast<off_t>(offset + log.size()))) > 0 ||
+           (n < 0 && errno == EINTR)) {
+        if (n > 0) log.append(buffer, static_cast<size_t>(n));
+    }
+    close(fd);
+    log.resize(log.rfind('\n') + 1);  // npos + 1 is 0
+    return log;
+}
+
+uint64_t file_size(const std::string& path) {
+    struct stat st;
+    return !path.empty() && stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+template <typename T>
+void append_pod(std::string& image, const T& value) {
+    image.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+// File layout: Header, Entry[entry_count], Gram[gram_count] sorted by
+// trigram, postings (entry ids per trigram), each entry's own sorted
+// trigrams, then the prompt and command strings.
+struct OfflineIndex::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t gram_count;
+    uint64_t log_bytes;       // Prefix of accepted.log this was built from
+    uint64_t seed_hash;
+    uint64_t grams_offset;
+    uint64_t postings_offset;
+    uint64_t entry_grams_offset;
+    uint64_t strings_offset;
+    uint64_t size;
+};
+
+struct OfflineIndex::Gram {
+    uint32_t gram;
+    uint32_t first;   // Into the postings
+    uint32_t count;
+};
+
+// An accepted command logged after the index was built
+struct OfflineIndex::Delta {
+    std::string prompt;
+    std::string command;
+    std::vector<uint32_t> grams;
+    uint64_t anchors;
+};
+
+struct OfflineIndex::Entry {
+    uint64_t anchors;
+    uint32_t grams_first;  // Into the entry trigrams
+    uint32_t gram_count;
+    uint32_t prompt_offset;
+    uint32_t prompt_length;
+    uint32_t command_offset;
+    uint32_t command_length;
+};
+
+OfflineIndex::OfflineIndex(const std::string& cache_directory, const std::string& data_directory) {
+    if (!make_dirs(cache_directory)) {
+        throw std::runtime_error("Cannot create cache directory: " + cache_directory);
+    }
+    index_path_ = cache_directory + "/offline.idx";
+    if (!data_directory.empty() && make_dirs(data_directory)) {
+        log_path_ = data_directory + "/accepted.log";
+    }
+
+    if (!open_current()) {
+        rebuild();
+    }
+}
+
+OfflineIndex::~OfflineIndex() {
+    if (map_) munmap(const_cast<char*>(map_), map_size_);
+}
+
+const OfflineIndex::Header* OfflineIndex::header() const {
+    return reinterpret_cast<const Header*>(map_);
+}
+
+size_t OfflineIndex::size() const {
+    return header()->entry_count + delta_.size();
+}
+
+bool OfflineIndex::open_current() {
+    // The file is only ever replaced, never written in place, so the
+    // mapping stays valid however many processes rebuild it meanwhile
+    int fd = open(index_path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header);
+    void* map = ok ? mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const auto* h = static_cast<const Header*>(map);
+    // The log is only appended to; one shorter than the index was rewritten
+    if (h->magic != kMagic || h->version != kVersion || h->size != static_cast<uint64_t>(st.st_size) ||
+        h->log_bytes > file_size(log_path_) || h->seed_hash != seed_hash()) {
+        munmap(map, static_cast<size_t>(st.st_size));
+        return false;
+    }
+
+    if (map_) munmap(const_cast<char*>(map_), map_size_);
+    map_ = static_cast<const char*>(map);
+    map_size_ = static_cast<size_t>(st.st_size);
+    delta_.clear();
+    delta_end_ = h->log_bytes;
+    read_delta();
+    return true;
+}
+
+void OfflineIndex::read_delta() {
+    std::string log = read_log(log_path_, delta_end_);
+    delta_end_ += log.size();
+    parse_log(log, [&](std::string prompt, std::string command) {
+        Normalized normalized = normalize(prompt);
+        if (normalized.grams.empty() || command.empty()) return;
+        delta_.push_back({std::move(prompt), std::move(command), std::move(normalized.grams), normalized.anchors});
+    });
+}
+
+void OfflineIndex::rebuild() {
+    // One builder at a time; the others wait and then use its result
+    std::string lock_path = index_path_ + ".lock";
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0) {
+        throw std::runtime_error("Cannot lock offline index: " + lock_path);
+    }
+    FileLock lock(lock_fd);
+
+    // Another process may have rebuilt it while this one waited
+    if (open_current() && delta_.size() <= kDeltaLimit) {
+        close(lock_fd);
+        return;
+    }
+    std::string log = read_log(log_path_, 0);
+
+    // Seed first, then the log in order, so later answers replace earlier
+    // ones for the same normalized prompt. A torn last line is left for later.
+    struct Pending {
+        std::string prompt;
+        std::string command;
+        Normalized normalized;
+    };
+    std::vector<Pending> entries;
+    std::unordered_map<std::string, size_t> by_key;
+    auto add_entry = [&](std::string prompt, std::string command) {
+        Normalized normalized = normalize(prompt);
+        if (normalized.grams.empty() || command.empty()) return;
+        auto [it, inserted] = by_key.emplace(normalized.key, entries.size());
+        if (inserted) {
+            entries.push_back({std::move(prompt), std::move(command), std::move(normalized)});
+        } else {
+            entries[it->second] = {std::move(prompt), std::move(command), std::move(normalized)};
+        }
+    };
+    for (const auto& seed : kSeed) {
+        std::string_view prompts = seed.prompts;
+        for (size_t start = 0; start <= prompts.size();) {
+            size_t end = std::min(prompts.find('|', start), prompts.size());
+            add_entry(std::string(prompts.substr(start, end - start)), seed.command);
+            start = end + 1;
+        }
+    }
+    parse_log(log, add_entry);
+
+    // Inverted lists: (trigram, entry) pairs grouped by trigram
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+        for (uint32_t gram : entries[id].normalized.grams) pairs.emplace_back(gram, id);
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    std::vector<Gram> grams;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (grams.empty() || grams.back().gram != pairs[i].first) {
+            grams.push_back({pairs[i].first, static_cast<uint32_t>(i), 0});
+        }
+        ++grams.back().count;
+    }
+
+    Header h{};
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.entry_count = static_cast<uint32_t>(entries.size());
+    h.gram_count = static_cast<uint32_t>(grams.size());
+    h.log_bytes = log.size();
+    h.seed_hash = seed_hash();
+    h.grams_offset = sizeof(Header) + sizeof(Entry) * entries.size();
+    h.postings_offset = h.grams_offset + sizeof(Gram) * grams.size();
+    h.entry_grams_offset = h.postings_offset + sizeof(uint32_t) * pairs.size();
+    h.strings_offset = h.entry_grams_offset + sizeof(uint32_t) * pairs.size();
+
+    std::string strings;
+    std::string image;
+    image.reserve(h.strings_offset);
+    append_pod(image, h);
+    uint32_t grams_first = 0;
+    for (const auto& pending : entries) {
+        Entry entry{};
+        entry.anchors = pending.normalized.anchors;
+        entry.grams_first = grams_first;
+        entry.gram_count = static_cast<uint32_t>(pending.normalized.grams.size());
+        entry.prompt_offset = static_cast<uint32_t>(strings.size());
+        entry.prompt_length = static_cast<uint32_t>(pending.prompt.size());
+        strings += pending.prompt;
+        entry.command_offset = static_cast<uint32_t>(strings.size());
+        entry.command_length = static_cast<uint32_t>(pending.command.size());
+        strings += pending.command;
+        grams_first += entry.gram_count;
+        append_pod(image, entry);
+    }
+    for (const auto& gram : grams) append_pod(image, gram);
+    for (const auto& pair : pairs) append_pod(image, pair.second);
+    for (const auto& pending : entries) {
+        image.append(reinterpret_cast<const char*>(pending.normalized.grams.data()),
+                     sizeof(uint32_t) * pending.normalized.grams.size());
+    }
+    image += strings;
+    reinterpret_cast<Header*>(image.data())->size = image.size();
+
+    std::string temp_path = index_path_ + "." + std::to_string(getpid());
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool written = fd >= 0 && write_all(fd, image.data(), image.size());
+    if (fd >= 0) close(fd);
+    if (!written || rename(temp_path.c_str(), index_path_.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        close(lock_fd);
+        throw std::runtime_error("Cannot write offline index: " + index_path_);
+    }
+    close(lock_fd);
+
+    if (!open_current()) {
+        throw std::runtime_error("Cannot open offline index: " + index_path_);
+    }
+}
+
+std::optional<OfflineMatch> OfflineIndex::lookup(std::string_view prompt, float threshold) const {
+    Normalized query = normalize(prompt);
+    if (query.grams.empty()) return std::nullopt;
+    threshold = std::clamp(threshold, 0.05f, 1.0f);
+
+    OfflineMatch match;
+    float best_similarity = threshold;
+    bool found = search(query.grams, query.anchors, best_similarity, match);
+
+    // Entries logged since the index was built are newer, so they win ties
+    for (const Delta& entry : delta_) {
+        if (entry.anchors != query.anchors) continue;
+        float similarity = dice(query.grams.data(), query.grams.size(), entry.grams.data(), entry.grams.size());
+        if (similarity >= best_similarity) {
+            best_similarity = similarity;
+            match.prompt = entry.prompt;
+            match.command = entry.command;
+            found = true;
+        }
+    }
+    if (!found) return std::nullopt;
+    match.similarity = best_similarity;
+    return match;
+}
+
+bool OfflineIndex::search(const std::vector<uint32_t>& query, uint64_t anchors, float& best_similarity,
+                          OfflineMatch& match) const {
+    const Header* h = header();
+    const auto* entries = reinterpret_cast<const Entry*>(map_ + sizeof(Header));
+    const auto* grams = reinterpret_cast<const Gram*>(map_ + h->grams_offset);
+    const auto* postings = reinterpret_cast<const uint32_t*>(map_ + h->postings_offset);
+    const auto* entry_grams = reinterpret_cast<const uint32_t*>(map_ + h->entry_grams_offset);
+    const char* strings = map_ + h->strings_offset;
+
+    // Posting list of each query trigram, rarest first
+    struct List {
+        const uint32_t* ids;
+        uint32_t count;
+    };
+    std::vector<List> lists;
+    lists.reserve(query.size());
+    for (uint32_t gram : query) {
+        const Gram* end = grams + h->gram_count;
+        const Gram* it = std::lower_bound(grams, end, gram, [](const Gram& g, uint32_t value) { return g.gram < value; });
+        if (it != end && it->gram == gram) {
+            lists.push_back({postings + it->first, it->count});
+        } else {
+            lists.push_back({nullptr, 0});
+        }
+    }
+    std::sort(lists.begin(), lists.end(), [](const List& a, const List& b) { return a.count < b.count; });
+
+    // Count trigram hits per entry, rarest lists first, until the posting
+    // budget is spent. Rare trigrams are what tell entries apart; the
+    // common ones are shared by so many that reading them changes little.
+    // The counters are reused across calls and only touched ones reset.
+    thread_local std::vector<uint16_t> hits;
+    thread_local std::vector<uint32_t> touched;
+    if (hits.size() < h->entry_count) hits.assign(h->entry_count, 0);
+    touched.clear();
+
+    // reached[c] counts the entries whose hits reached c, which gives the
+    // cutoff for the best candidates without sorting them
+    std::vector<uint32_t> reached(lists.size() + 2, 0);
+    size_t budget = kPostingBudget;
+    uint16_t* counts = hits.data();
+    for (const List& list : lists) {
+        if (list.count == 0) continue;
+        if (budget == 0) break;
+        uint32_t count = static_cast<uint32_t>(std::min<size_t>(list.count, budget));
+        for (uint32_t j = 0; j < count; ++j) {
+            uint32_t id = list.ids[j];
+            uint16_t c = ++counts[id];
+            if (c == 1) touched.push_back(id);
+            ++reached[c];
+        }
+        budget -= count;
+    }
+    if (touched.empty()) return false;
+
+    // Only the entries sharing the most trigrams are scored exactly
+    size_t cutoff = reached.size() - 1;
+    while (cutoff > 1 && reached[cutoff] < kCandidates) --cutoff;
+    std::vector<uint32_t> candidates;
+    candidates.reserve(kCandidates * 2);
+    for (uint32_t id : touched) {
+        if (counts[id] > cutoff || (counts[id] == cutoff && candidates.size() < kCandidates)) {
+            candidates.push_back(id);
+        }
+        counts[id] = 0;
+    }
+
+    long best = -1;
+    for (uint32_t id : candidates) {
+        const Entry& entry = entries[id];
+        if (entry.anchors != anchors) continue;
+        // Ties go to the later entry, a locally accepted one
+        float similarity = dice(query.data(), query.size(), entry_grams + entry.grams_first, entry.gram_count);
+        if (similarity > best_similarity || (similarity == best_similarity && static_cast<long>(id) > best)) {
+            best = id;
+            best_similarity = similarity;
+        }
+    }
+    if (best < 0) return false;
+
+    const Entry& entry = entries[best];
+    match.prompt.assign(strings + entry.prompt_offset, entry.prompt_length);
+    match.command.assign(strings + entry.command_offset, entry.command_length);
+    return true;
+}
+
+void OfflineIndex::add(std::string_view prompt, std::string_view command) {
+    if (log_path_.empty() || normalize(prompt).grams.empty() || command.empty()) return;
+
+    // Already the answer here; repeated runs need not grow the log
+    if (auto match = lookup(prompt, 1.0f); match && match->command == command) return;
+
+    // One O_APPEND write per line keeps concurrent writers from interleaving
+    std::string line = escape_field(prompt) + "\t" + escape_field(command) + "\n";
+    int fd = open(log_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    bool written = write_all(fd, line.data(), line.size());
+    close(fd);
+
+    // Lookups scan what was logged since the index was built; once that is
+    // long, reindex now, after the command ran, not in front of a request
+    if (!written) return;
+    read_delta();
+    if (delta_.size() > kDeltaLimit) rebuild();
+}
+
+} // namespace neuron
@@ -0,0 +1,51 @@
+#include "neuron/paths.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace neuron {
+
+bool make_dirs(const std::string& path) {
+    if (path.empty()) return false;
+
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0700) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (pos == std::string::npos) break;
+    }
+    return true;
+}
+
+namespace {
+
+// $<xdg_variable>/neuron, else $HOME/<fallback>/neuron
+std::string user_dir(const char* xdg_variable, const char* fallback) {
+    std::string dir;
+    const char* xdg = std::getenv(xdg_variable);
+    const char* home = std::getenv("HOME");
+
+    if (xdg && *xdg) {
+        dir = std::string(xdg) + "/neuron";
+    } else if (home && *home) {
+        dir = std::string(home) + "/" + fallback + "/neuron";
+    } else {
+        return "";
+    }
+
+    return make_dirs(dir) ? dir : "";
+}
+
+} // namespace
+
+std::string cache_dir() {
+    return user_dir("XDG_CACHE_HOME", ".cache");
+}
+
+std::string data_dir() {
+    return user_dir("XDG_DATA_HOME", ".local/share");
+}
+
+} // namespace neuron
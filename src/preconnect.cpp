@@ -0,0 +1,182 @@
+#include "neuron/preconnect.hpp"
+#include "neuron/ai_client.hpp"
+#include "neuron/trace.hpp"
+#include "neuron/transport_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace neuron {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Through a proxy libcurl connects to the proxy, not to the endpoint
+bool behind_proxy() {
+    for (const char* name : {"https_proxy", "HTTPS_PROXY", "http_proxy", "all_proxy", "ALL_PROXY"}) {
+        const char* value = std::getenv(name);
+        if (value && *value) return true;
+    }
+    return false;
+}
+
+// Host and port of url, without the brackets of an IPv6 literal
+bool split_url(const std::string& url, std::string& host, std::string& port) {
+    CURLU* parsed = curl_url();
+    char* h = nullptr;
+    char* p = nullptr;
+    bool ok = parsed && curl_url_set(parsed, CURLUPART_URL, url.c_str(), 0) == CURLUE_OK &&
+              curl_url_get(parsed, CURLUPART_HOST, &h, 0) == CURLUE_OK &&
+              curl_url_get(parsed, CURLUPART_PORT, &p, CURLU_DEFAULT_PORT) == CURLUE_OK;
+    if (ok) {
+        host = h;
+        port = p;
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+    }
+    curl_free(h);
+    curl_free(p);
+    curl_url_cleanup(parsed);
+    return ok;
+}
+
+// A connected, non-blocking socket to address, or -1. Polls in short
+// slices so a cancelled connect does not hold up the process exiting.
+int open_connected(const addrinfo& address, Clock::time_point deadline, const std::atomic<bool>& cancelled) {
+    int fd = socket(address.ai_family, address.ai_socktype, address.ai_protocol);
+    if (fd < 0) return -1;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (::connect(fd, address.ai_addr, address.ai_addrlen) == 0) return fd;
+    if (errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+
+    pollfd watch{fd, POLLOUT, 0};
+    while (!cancelled.load()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) break;
+        int ready = poll(&watch, 1, static_cast<int>(std::min<long long>(left.count(), 20)));
+        if (ready < 0 && errno != EINTR) break;
+        if (ready > 0) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) return fd;
+            break;
+        }
+    }
+    close(fd);
+    return -1;
+}
+
+bool is_loopback(const std::string& host) {
+    return host == "localhost" || host == "::1" || host.rfind("127.", 0) == 0;
+}
+
+} // namespace
+
+Preconnect::Preconnect(std::string url, std::chrono::milliseconds timeout, std::string dns_directory)
+    : url_(std::move(url)) {
+    if (behind_proxy() || !split_url(url_, host_, port_) || is_loopback(host_)) {
+        taken_ = true;
+        return;
+    }
+    worker_ = std::thread([this, timeout, dns_directory = std::move(dns_directory)] {
+        connect(timeout, dns_directory);
+    });
+}
+
+Preconnect::~Preconnect() {
+    cancelled_.store(true);
+    if (worker_.joinable()) worker_.join();
+    if (fd_ >= 0) close(fd_);
+}
+
+void Preconnect::connect(std::chrono::milliseconds timeout, const std::string& dns_directory) {
+    TraceSpan span("preconnect", "network");
+    const auto deadline = Clock::now() + timeout;
+
+    // The request needs this next, so it is done here rather than on the main thread
+    init_curl();
+
+    // An address saved by an earlier process is what libcurl will use too
+    std::string saved = dns_directory.empty() ? "" : TransportCache::saved_address(dns_directory, host_ + ":" + port_);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = saved.empty() ? AI_ADDRCONFIG : AI_NUMERICHOST;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(saved.empty() ? host_.c_str() : saved.c_str(), port_.c_str(), &hints, &found) != 0) {
+        span.set_detail("cannot resolve " + host_);
+        return;
+    }
+
+    for (addrinfo* address = found; address && fd_ < 0 && !cancelled_.load(); address = address->ai_next) {
+        fd_ = open_connected(*address, deadline, cancelled_);
+        family_ = address->ai_family;
+    }
+    freeaddrinfo(found);
+    span.set_detail((fd_ >= 0 ? "" : "cannot connect to ") + host_ + ":" + port_);
+}
+
+void Preconnect::attach(CURL* handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (taken_) return;
+    }
+    curl_easy_setopt(handle, CURLOPT_OPENSOCKETFUNCTION, open_socket);
+    curl_easy_setopt(handle, CURLOPT_OPENSOCKETDATA, this);
+    curl_easy_setopt(handle, CURLOPT_SOCKOPTFUNCTION, socket_options);
+    curl_easy_setopt(handle, CURLOPT_SOCKOPTDATA, this);
+}
+
+int Preconnect::take(int family) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (taken_) return -1;
+    if (worker_.joinable()) {
+        TraceSpan span("preconnect wait", "network");
+        worker_.join();
+    }
+
+    // libcurl may try the other address family first
+    if (fd_ >= 0 && family_ != family) return -1;
+    taken_ = true;
+    handed_ = fd_;
+    fd_ = -1;
+    return handed_;
+}
+
+curl_socket_t Preconnect::open_socket(void* self, curlsocktype purpose, curl_sockaddr* address) {
+    if (purpose == CURLSOCKTYPE_IPCXN) {
+        int fd = static_cast<Preconnect*>(self)->take(address->family);
+        if (fd >= 0) return fd;
+    }
+    // What libcurl does without the callback
+    int fd = socket(address->family, address->socktype, address->protocol);
+    return fd < 0 ? CURL_SOCKET_BAD : fd;
+}
+
+int Preconnect::socket_options(void* self, curl_socket_t fd, curlsocktype) {
+    auto* preconnect = static_cast<Preconnect*>(self);
+    std::lock_guard<std::mutex> lock(preconnect->mutex_);
+    if (fd != preconnect->handed_) return CURL_SOCKOPT_OK;
+
+    // Once only: the descriptor number comes back for later sockets
+    preconnect->handed_ = -1;
+    return CURL_SOCKOPT_ALREADY_CONNECTED;
+}
+
+} // namespace neuron
@@ -0,0 +1,286 @@
+#include "neuron/race.hpp"
+#include "neuron/trace.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace neuron {
+
+namespace {
+
+// Answers at least this similar count as the same command
+constexpr double kAgreeSimilarity = 0.8;
+
+// Whitespace-separated words, so "ls  -la" and "ls -la;" compare equal
+std::vector<std::string> command_words(const std::string& command) {
+    std::vector<std::string> words;
+    std::istringstream in(command);
+    std::string word;
+    while (in >> word) {
+        words.push_back(std::move(word));
+    }
+    while (!words.empty() && words.back() == ";") words.pop_back();
+    if (!words.empty() && words.back().size() > 1 && words.back().back() == ';') words.back().pop_back();
+    return words;
+}
+
+// 1 for the same words in the same order, else Jaccard over distinct words
+double similarity(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+    if (a == b) return 1.0;
+    std::vector<std::string> x = a, y = b;
+    std::sort(x.begin(), x.end());
+    x.erase(std::unique(x.begin(), x.end()), x.end());
+    std::sort(y.begin(), y.end());
+    y.erase(std::unique(y.begin(), y.end()), y.end());
+
+    std::vector<std::string> shared;
+    std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(shared));
+    size_t total = x.size() + y.size() - shared.size();
+    return total == 0 ? 0.0 : static_cast<double>(shared.size()) / static_cast<double>(total);
+}
+
+bool has_text(const std::string& content) {
+    return content.find_first_not_of(" \t\r\n") != std::string::npos;
+}
+
+} // namespace
+
+RaceOptions RaceOptions::from_config(const Config& config) {
+    RaceOptions options;
+    if (auto models = config.getValue("NEURON_RACE_MODELS")) {
+        std::istringstream in(*models);
+        std::string spec;
+        while (std::getline(in, spec, ',')) {
+            spec.erase(0, spec.find_first_not_of(" \t"));
+            spec.erase(spec.find_last_not_of(" \t") + 1);
+            if (!spec.empty()) options.models.push_back(spec);
+        }
+    }
+    // NEURON_RACE_KEY_1 is the key of the first model listed
+    for (size_t i = 0; i < options.models.size(); ++i) {
+        options.keys.push_back(config.getValue("NEURON_RACE_KEY_" + std::to_string(i + 1)).value_or(""));
+    }
+    options.candidates = static_cast<size_t>(std::clamp(config.getLong("NEURON_RACE_CANDIDATES", 1), 1L, 8L));
+    if (config.getValue("NEURON_RACE_STRATEGY").value_or("first") == "rank") {
+        options.strategy = RaceStrategy::RANK;
+    }
+    options.deadline = std::chrono::milliseconds(
+        std::max(0L, config.getLong("NEURON_RACE_DEADLINE_MS", options.deadline.count())));
+    return options;
+}
+
+RaceRunner::RaceRunner(AIClient& client, const RaceOptions& options)
+    : client_(client), options_(options) {
+    if (options_.candidates == 0) {
+        options_.candidates = 1;
+    }
+}
+
+RaceResult RaceRunner::run(const std::string& prompt, const TokenCallback& on_token) {
+    RaceResult result;
+    TraceSpan span("race", "client");
+
+    // Only the first transfer to produce text streams; ranking needs whole answers
+    const bool first = options_.strategy == RaceStrategy::FIRST;
+    const TokenCallback streamed = first ? on_token : nullptr;
+
+    // The configured model's request doubles as the cache lookup
+    auto primary = client_.prepare(prompt, Mode::RUN, streamed);
+    if (primary->cached) {
+        span.set_detail("cache hit");
+        result.cached = true;
+        result.match = primary->match;
+        result.command = primary->cached;
+        if (on_token) on_token(*primary->cached);
+        return result;
+    }
+    primary->store = false;
+
+    std::vector<std::unique_ptr<Exchange>> exchanges;
+    exchanges.push_back(std::move(primary));
+    for (size_t i = 1; i < options_.candidates; ++i) {
+        exchanges.push_back(client_.prepare_for(client_.resolve(""), prompt, Mode::RUN, streamed));
+    }
+    for (size_t m = 0; m < options_.models.size(); ++m) {
+        ModelEndpoint target = client_.resolve(options_.models[m], m < options_.keys.size() ? options_.keys[m] : "");
+        for (size_t i = 0; i < options_.candidates; ++i) {
+            exchanges.push_back(client_.prepare_for(target, prompt, Mode::RUN, streamed));
+        }
+    }
+
+    std::optional<size_t> streaming;  // Whose tokens the caller is seeing
+    if (streamed) {
+        for (size_t i = 0; i < exchanges.size(); ++i) {
+            exchanges[i]->on_token = [&, i](std::string_view token) {
+                if (!streaming) streaming = i;
+                if (*streaming == i) on_token(token);
+            };
+        }
+    }
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        result.error = "Failed to initialize request";
+        return result;
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    std::unordered_map<CURL*, size_t> running;
+    result.candidates.resize(exchanges.size());
+    for (size_t i = 0; i < exchanges.size(); ++i) {
+        result.candidates[i].model = exchanges[i]->target.model;
+        if (!exchanges[i]->curl) {
+            result.candidates[i].error = "Failed to initialize request";
+            continue;
+        }
+
+        // Under a rate limit the configured model waits its turn; the
+        // extra copies only go out if a slot is free right now
+        auto wait = client_.reserve(*exchanges[i], i == 0 ? std::nullopt
+                                                          : std::optional(std::chrono::milliseconds(0)));
+        if (!wait) {
+            result.candidates[i].error = i == 0 ? exchanges[i]->error : "Skipped: rate limited";
+            continue;
+        }
+        if (wait->count() > 0) {
+            TraceSpan wait_span("rate limit wait", "client");
+            std::this_thread::sleep_for(*wait);
+        }
+
+        // Waiting to multiplex would queue copies behind one HTTP/1.1 connection
+        curl_easy_setopt(exchanges[i]->curl, CURLOPT_PIPEWAIT, 0L);
+        curl_multi_add_handle(multi, exchanges[i]->curl);
+        running.emplace(exchanges[i]->curl, i);
+    }
+
+    // No retries inside a race: the other contestants are the redundancy
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<size_t> first_success;
+    while (!running.empty()) {
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            auto it = running.find(msg->easy_handle);
+            if (it == running.end()) continue;
+
+            size_t i = it->second;
+            running.erase(it);
+            curl_multi_remove_handle(multi, msg->easy_handle);
+
+            RaceCandidate& candidate = result.candidates[i];
+            candidate.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            auto content = client_.finish(*exchanges[i], msg->data.result);
+            if (content && has_text(*content)) {
+                candidate.command = std::move(content);
+                if (!first_success) first_success = i;
+            } else {
+                candidate.error = content ? "Empty response" : exchanges[i]->error;
+            }
+        }
+
+        // Once one transfer is streaming to the caller the others are wasted work
+        if (streaming) {
+            for (auto it = running.begin(); it != running.end();) {
+                if (it->second != *streaming) {
+                    curl_multi_remove_handle(multi, it->first);
+                    result.candidates[it->second].error = "Abandoned";
+                    it = running.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool settled = first ? first_success.has_value()
+                             : first_success && now - start >= options_.deadline;
+        if (settled || running.empty()) break;
+
+        int timeout_ms = 100;
+        if (!first && now - start < options_.deadline) {
+            auto until_deadline = std::chrono::duration_cast<std::chrono::milliseconds>(options_.deadline - (now - start));
+            timeout_ms = static_cast<int>(std::clamp<long long>(until_deadline.count(), 1, 100));
+        }
+        curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+    }
+
+    for (const auto& [handle, index] : running) {
+        curl_multi_remove_handle(multi, handle);
+        result.candidates[index].error = first ? "Abandoned" : "No answer before the deadline";
+    }
+    curl_multi_cleanup(multi);
+
+    if (first) {
+        result.winner = first_success;
+    } else {
+        rank(result);
+    }
+
+    if (!result.winner) {
+        for (const auto& candidate : result.candidates) {
+            if (!candidate.error.empty()) {
+                result.error = candidate.error;
+                break;
+            }
+        }
+        span.set_detail("no answer");
+        return result;
+    }
+
+    result.command = result.candidates[*result.winner].command;
+    client_.store(*exchanges.front(), *result.command);
+    if (!first && on_token) on_token(*result.command);
+    span.set_detail(result.candidates[*result.winner].model);
+    return result;
+}
+
+void RaceRunner::rank(RaceResult& result) const {
+    std::vector<size_t> answered;
+    std::vector<std::vector<std::string>> words(result.candidates.size());
+    for (size_t i = 0; i < result.candidates.size(); ++i) {
+        RaceCandidate& candidate = result.candidates[i];
+        if (!candidate.command) continue;
+        answered.push_back(i);
+        words[i] = command_words(*candidate.command);
+        if (options_.safety) candidate.severity = options_.safety->analyze(*candidate.command).severity;
+    }
+
+    for (size_t a = 0; a < answered.size(); ++a) {
+        for (size_t b = a + 1; b < answered.size(); ++b) {
+            RaceCandidate& x = result.candidates[answered[a]];
+            RaceCandidate& y = result.candidates[answered[b]];
+            double s = similarity(words[answered[a]], words[answered[b]]);
+            x.agreement += s;
+            y.agreement += s;
+            if (s >= kAgreeSimilarity) {
+                ++x.agreeing;
+                ++y.agreeing;
+            }
+        }
+    }
+
+    // A command that would need confirmation only wins if every answer
+    // does; among the rest the consensus wins, then the safer, then the faster
+    auto better = [&](size_t a, size_t b) {
+        const RaceCandidate& x = result.candidates[a];
+        const RaceCandidate& y = result.candidates[b];
+        bool x_risky = x.severity >= Severity::MEDIUM;
+        bool y_risky = y.severity >= Severity::MEDIUM;
+        if (x_risky != y_risky) return !x_risky;
+        if (x.agreement != y.agreement) return x.agreement > y.agreement;
+        if (x.severity != y.severity) return x.severity < y.severity;
+        return x.latency < y.latency;
+    };
+    if (!answered.empty()) {
+        result.winner = *std::min_element(answered.begin(), answered.end(), better);
+    }
+}
+
+} // namespace neuron
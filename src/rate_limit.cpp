@@ -0,0 +1,93 @@
+#include "neuron/rate_limit.hpp"
+#include "neuron/hash.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace neuron {
+
+namespace {
+
+static_assert(std::atomic_ref<int64_t>::is_always_lock_free, "the bucket is shared lock-free between processes");
+
+constexpr size_t kFileSize = 64;
+
+// An arrival time further ahead than this is left over from a clock jump
+constexpr int64_t kStaleNs = 3600LL * 1000 * 1000 * 1000;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(const std::string& path, double per_minute, long burst) {
+    interval_ns_ = static_cast<int64_t>(60e9 / std::max(per_minute, 1e-3));
+    burst_ns_ = interval_ns_ * (std::max(burst, 1L) - 1);
+
+    // Wall-clock time rather than monotonic, since the file outlives reboots
+    if (path.empty()) return;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+
+    // Concurrent creators all extend to the same size; new bytes read as zero, an idle bucket
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (st.st_size >= static_cast<off_t>(kFileSize) || ftruncate(fd, kFileSize) == 0)) {
+        void* map = mmap(nullptr, kFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) tat_ = static_cast<int64_t*>(map);
+    }
+    close(fd);
+}
+
+RateLimiter::~RateLimiter() {
+    if (tat_) munmap(tat_, kFileSize);
+}
+
+std::optional<std::chrono::milliseconds> RateLimiter::reserve(std::chrono::milliseconds max_wait) {
+    std::atomic_ref<int64_t> tat(tat_ ? *tat_ : local_tat_);
+    const int64_t now = now_ns();
+    const int64_t max_wait_ns = max_wait.count() * 1000 * 1000;
+
+    int64_t current = tat.load();
+    while (true) {
+        int64_t base = current;
+        if (base < now || base > now + burst_ns_ + kStaleNs) base = now;
+
+        int64_t wait_ns = std::max<int64_t>(0, base - burst_ns_ - now);
+        if (wait_ns > max_wait_ns) return std::nullopt;
+
+        // Losing the race means another process took this slot; try the next one
+        if (tat.compare_exchange_weak(current, base + interval_ns_)) {
+            return std::chrono::milliseconds((wait_ns + 999999) / 1000000);
+        }
+    }
+}
+
+void RateLimiter::hold_off(std::chrono::milliseconds delay) {
+    std::atomic_ref<int64_t> tat(tat_ ? *tat_ : local_tat_);
+    const int64_t until = now_ns() + delay.count() * 1000 * 1000 + burst_ns_;
+
+    int64_t current = tat.load();
+    while (current < until && !tat.compare_exchange_weak(current, until)) {
+    }
+}
+
+std::string RateLimiter::path_for(const std::string& api_key, const std::string& model) {
+    std::string dir = cache_dir();
+    if (dir.empty()) return "";
+
+    // The key itself never touches the disk
+    char name[64];
+    std::snprintf(name, sizeof(name), "/ratelimit-%016llx.bin",
+                  static_cast<unsigned long long>(Hasher().feed(api_key).feed(model).digest().lo));
+    return dir + name;
+}
+
+} // namespace neuron
@@ -0,0 +1,339 @@
+#include "neuron/response_cache.hpp"
+#include "neuron/file_lock.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace neuron {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x3143524e;   // "NRC1"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kCapacity = 8192;      // Slots in the hash table
+constexpr uint32_t kMaxEntries = kCapacity * 3 / 4;
+constexpr uint64_t kCompactThreshold = 1024 * 1024;
+
+enum SlotState : uint32_t { EMPTY = 0, USED = 1 };
+
+// Prefix of every record in the data log; lets readers validate what an
+// index slot points at even if another process rewrote the log under them.
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;
+    uint64_t key_hi;
+    uint64_t key_lo;
+};
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_at(int fd, char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = pread(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+struct ResponseCache::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t live_bytes;  // Bytes of the data log still referenced by a slot
+    uint64_t data_bytes;  // Total size of the data log
+    uint64_t clock;       // Logical LRU clock, bumped on every hit or insert
+    uint64_t generation;  // Bumped whenever the data log is replaced
+};
+
+struct ResponseCache::Slot {
+    uint64_t key_hi;
+    uint64_t key_lo;
+    uint64_t offset;
+    uint32_t length;  // Record length including its header
+    uint32_t state;
+    int64_t created;
+    uint64_t last_used;
+};
+
+ResponseCache::ResponseCache(const Options& options)
+    : options_(options) {
+    if (!make_dirs(options_.directory)) {
+        throw std::runtime_error("Cannot create cache directory: " + options_.directory);
+    }
+
+    data_path_ = options_.directory + "/responses.dat";
+    std::string index_path = options_.directory + "/responses.idx";
+
+    data_fd_ = open(data_path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    index_fd_ = open(index_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (data_fd_ < 0 || index_fd_ < 0) {
+        if (data_fd_ >= 0) close(data_fd_);
+        if (index_fd_ >= 0) close(index_fd_);
+        throw std::runtime_error("Cannot open response cache in " + options_.directory);
+    }
+
+    FileLock lock(index_fd_);
+
+    map_size_ = sizeof(Header) + sizeof(Slot) * kCapacity;
+    struct stat st;
+    bool fresh = fstat(index_fd_, &st) != 0 || static_cast<size_t>(st.st_size) != map_size_;
+    if (fresh && ftruncate(index_fd_, static_cast<off_t>(map_size_)) != 0) {
+        close(data_fd_);
+        close(index_fd_);
+        throw std::runtime_error("Cannot size response cache index");
+    }
+
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, index_fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        close(data_fd_);
+        close(index_fd_);
+        throw std::runtime_error("Cannot map response cache index");
+    }
+
+    Header* h = header();
+    if (fresh || h->magic != kMagic || h->version != kVersion || h->capacity != kCapacity) {
+        init_index();
+    }
+    generation_ = h->generation;
+}
+
+ResponseCache::~ResponseCache() {
+    if (map_) munmap(map_, map_size_);
+    if (data_fd_ >= 0) close(data_fd_);
+    if (index_fd_ >= 0) close(index_fd_);
+}
+
+ResponseCache::Header* ResponseCache::header() const {
+    return static_cast<Header*>(map_);
+}
+
+ResponseCache::Slot* ResponseCache::slots() const {
+    return reinterpret_cast<Slot*>(static_cast<char*>(map_) + sizeof(Header));
+}
+
+void ResponseCache::init_index() {
+    std::memset(map_, 0, map_size_);
+    Header* h = header();
+    h->magic = kMagic;
+    h->version = kVersion;
+    h->capacity = kCapacity;
+
+    // Truncate in place so other processes' descriptors stay valid. If that
+    // fails the old records are just unreferenced until the next compaction.
+    if (ftruncate(data_fd_, 0) != 0) return;
+}
+
+bool ResponseCache::reopen_data_if_stale() {
+    if (header()->generation == generation_) return true;
+
+    close(data_fd_);
+    data_fd_ = open(data_path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    generation_ = header()->generation;
+    return data_fd_ >= 0;
+}
+
+int64_t ResponseCache::now() {
+    using namespace std::chrono;
+    return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+}
+
+ResponseCache::Slot* ResponseCache::find(const Hash128& key) const {
+    Slot* table = slots();
+    for (uint32_t probe = 0, i = key.lo % kCapacity; probe < kCapacity; ++probe, i = (i + 1) % kCapacity) {
+        Slot& slot = table[i];
+        if (slot.state == EMPTY) return nullptr;
+        if (slot.key_hi == key.hi && slot.key_lo == key.lo) return &slot;
+    }
+    return nullptr;
+}
+
+void ResponseCache::erase(Slot* slot) {
+    Header* h = header();
+    Slot* table = slots();
+
+    h->live_bytes -= std::min<uint64_t>(h->live_bytes, slot->length);
+    h->count -= 1;
+
+    // Backward-shift deletion keeps linear probe chains intact without tombstones
+    uint32_t hole = static_cast<uint32_t>(slot - table);
+    for (uint32_t j = (hole + 1) % kCapacity; table[j].state != EMPTY; j = (j + 1) % kCapacity) {
+        uint32_t home = table[j].key_lo % kCapacity;
+        bool reachable = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!reachable) {
+            table[hole] = table[j];
+            hole = j;
+        }
+    }
+    table[hole] = Slot{};
+}
+
+void ResponseCache::evict_until(uint64_t bytes, uint32_t count) {
+    Header* h = header();
+    Slot* table = slots();
+    const int64_t cutoff = now() - options_.ttl.count();
+
+    // Expired entries go first, regardless of pressure
+    std::vector<std::pair<uint64_t, Hash128>> live;
+    std::vector<Hash128> expired;
+    for (uint32_t i = 0; i < kCapacity; ++i) {
+        if (table[i].state != USED) continue;
+        Hash128 key{table[i].key_hi, table[i].key_lo};
+        if (table[i].created < cutoff) {
+            expired.push_back(key);
+        } else {
+            live.emplace_back(table[i].last_used, key);
+        }
+    }
+    for (const auto& key : expired) {
+        if (Slot* slot = find(key)) erase(slot);
+    }
+
+    if (h->live_bytes <= bytes && h->count <= count) return;
+
+    // Then least recently used until both limits hold
+    std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& [last_used, key] : live) {
+        if (h->live_bytes <= bytes && h->count <= count) break;
+        if (Slot* slot = find(key)) erase(slot);
+    }
+}
+
+void ResponseCache::compact() {
+    Header* h = header();
+    Slot* table = slots();
+    std::string tmp_path = data_path_ + ".tmp";
+
+    int tmp_fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (tmp_fd < 0) return;
+
+    // Copy live records first; only touch the index once the new log is complete
+    std::vector<std::pair<uint32_t, uint64_t>> moved;
+    std::string buffer;
+    uint64_t offset = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < kCapacity && ok; ++i) {
+        if (table[i].state != USED) continue;
+        buffer.resize(table[i].length);
+        ok = read_at(data_fd_, buffer.data(), buffer.size(), table[i].offset) &&
+             write_all(tmp_fd, buffer.data(), buffer.size());
+        moved.emplace_back(i, offset);
+        offset += buffer.size();
+    }
+    close(tmp_fd);
+
+    if (!ok || rename(tmp_path.c_str(), data_path_.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return;
+    }
+
+    for (const auto& [index, new_offset] : moved) {
+        table[index].offset = new_offset;
+    }
+    h->data_bytes = offset;
+    h->generation += 1;
+    reopen_data_if_stale();
+}
+
+std::optional<std::string> ResponseCache::get(const Hash128& key) {
+    FileLock lock(index_fd_);
+    if (!reopen_data_if_stale()) return std::nullopt;
+
+    Slot* slot = find(key);
+    if (!slot) return std::nullopt;
+
+    if (slot->created < now() - options_.ttl.count()) {
+        erase(slot);
+        return std::nullopt;
+    }
+
+    std::string record(slot->length, '\0');
+    RecordHeader rh;
+    if (slot->length < sizeof(rh) ||
+        !read_at(data_fd_, record.data(), record.size(), slot->offset)) {
+        erase(slot);
+        return std::nullopt;
+    }
+
+    std::memcpy(&rh, record.data(), sizeof(rh));
+    if (rh.magic != kMagic || rh.key_hi != key.hi || rh.key_lo != key.lo ||
+        rh.length != slot->length - sizeof(rh)) {
+        erase(slot);
+        return std::nullopt;
+    }
+
+    slot->last_used = ++header()->clock;
+    return record.substr(sizeof(rh));
+}
+
+void ResponseCache::put(const Hash128& key, std::string_view value) {
+    const uint64_t record_size = sizeof(RecordHeader) + value.size();
+    if (record_size > options_.max_bytes || value.size() > UINT32_MAX / 2) return;
+
+    FileLock lock(index_fd_);
+    if (!reopen_data_if_stale()) return;
+
+    if (Slot* existing = find(key)) {
+        erase(existing);
+    }
+
+    Header* h = header();
+    if (h->live_bytes + record_size > options_.max_bytes || h->count >= kMaxEntries) {
+        evict_until(options_.max_bytes - record_size, kMaxEntries - 1);
+    }
+
+    struct stat st;
+    if (fstat(data_fd_, &st) != 0) return;
+    const uint64_t offset = static_cast<uint64_t>(st.st_size);
+
+    RecordHeader rh{kMagic, static_cast<uint32_t>(value.size()), key.hi, key.lo};
+    std::string record(reinterpret_cast<const char*>(&rh), sizeof(rh));
+    record.append(value);
+    if (!write_all(data_fd_, record.data(), record.size())) return;
+
+    Slot* table = slots();
+    uint32_t i = key.lo % kCapacity;
+    while (table[i].state != EMPTY) {
+        i = (i + 1) % kCapacity;
+    }
+
+    table[i] = Slot{key.hi, key.lo, offset, static_cast<uint32_t>(record_size), USED, now(), ++h->clock};
+    h->count += 1;
+    h->live_bytes += record_size;
+    h->data_bytes = offset + record_size;
+
+    if (h->data_bytes > kCompactThreshold && h->data_bytes > 2 * h->live_bytes) {
+        compact();
+    }
+}
+
+} // namespace neuron
@@ -0,0 +1,146 @@
+#include "neuron/retry.hpp"
+#include "neuron/hash.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace neuron {
+
+RetryPolicy RetryPolicy::from_config(const Config& config) {
+    using std::chrono::milliseconds;
+
+    RetryPolicy policy;
+    policy.max_attempts = static_cast<int>(std::max(1L, config.getLong("NEURON_MAX_ATTEMPTS", policy.max_attempts)));
+    policy.base_delay = milliseconds(config.getLong("NEURON_RETRY_BASE_MS", policy.base_delay.count()));
+    policy.max_delay = milliseconds(config.getLong("NEURON_RETRY_MAX_MS", policy.max_delay.count()));
+    policy.connect_timeout = milliseconds(config.getLong("NEURON_CONNECT_TIMEOUT_MS", policy.connect_timeout.count()));
+    policy.attempt_timeout = milliseconds(config.getLong("NEURON_TIMEOUT_MS", policy.attempt_timeout.count()));
+    policy.deadline = milliseconds(config.getLong("NEURON_DEADLINE_MS", policy.deadline.count()));
+    policy.hedge = config.getFlag("NEURON_HEDGE", policy.hedge);
+    policy.min_hedge_delay = milliseconds(config.getLong("NEURON_HEDGE_MIN_MS", policy.min_hedge_delay.count()));
+    return policy;
+}
+
+std::chrono::milliseconds RetryPolicy::backoff(int retry, std::mt19937& rng) const {
+    // base * 2^(retry-1), capped, then uniformly drawn from [0, cap]
+    long long cap = base_delay.count();
+    for (int i = 1; i < retry && cap < max_delay.count(); ++i) {
+        cap *= 2;
+    }
+    cap = std::min<long long>(cap, max_delay.count());
+
+    std::uniform_int_distribution<long long> jitter(0, std::max(0LL, cap));
+    return std::chrono::milliseconds(jitter(rng));
+}
+
+bool is_retryable(CURLcode result, long status) {
+    switch (result) {
+        case CURLE_OK:
+            break;
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+
+    return status == 408 || status == 425 || status == 429 ||
+           status == 500 || status == 502 || status == 503 || status == 504;
+}
+
+std::optional<std::chrono::milliseconds> parse_retry_after(std::string_view value) {
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front()))) value.remove_prefix(1);
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back()))) value.remove_suffix(1);
+    if (value.empty()) return std::nullopt;
+
+    if (std::all_of(value.begin(), value.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+        if (value.size() > 9) return std::nullopt;
+        return std::chrono::seconds(std::stol(std::string(value)));
+    }
+
+    // HTTP-date form, e.g. "Wed, 21 Oct 2015 07:28:00 GMT"
+    time_t when = curl_getdate(std::string(value).c_str(), nullptr);
+    if (when < 0) return std::nullopt;
+
+    time_t now = std::time(nullptr);
+    return std::chrono::seconds(when > now ? when - now : 0);
+}
+
+LatencyTracker::LatencyTracker(const std::string& model) {
+    std::string dir = cache_dir();
+    if (!dir.empty()) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "/latency-%016llx.bin",
+                      static_cast<unsigned long long>(fnv1a64(model)));
+        path_ = dir + name;
+    }
+}
+
+void LatencyTracker::load() {
+    if (loaded_) return;
+    loaded_ = true;
+    if (path_.empty()) return;
+
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    flock(fd, LOCK_SH);
+    samples_.resize(kWindow);
+    ssize_t n = read(fd, samples_.data(), kWindow * sizeof(uint32_t));
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    samples_.resize(n > 0 ? static_cast<size_t>(n) / sizeof(uint32_t) : 0);
+}
+
+void LatencyTracker::record(std::chrono::milliseconds ttfb) {
+    if (path_.empty()) return;
+
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+
+    // Re-read under the lock so concurrent processes don't drop each other's samples
+    flock(fd, LOCK_EX);
+    std::vector<uint32_t> window(kWindow);
+    ssize_t n = pread(fd, window.data(), kWindow * sizeof(uint32_t), 0);
+    window.resize(n > 0 ? static_cast<size_t>(n) / sizeof(uint32_t) : 0);
+
+    if (window.size() >= kWindow) {
+        window.erase(window.begin());
+    }
+    window.push_back(static_cast<uint32_t>(std::clamp<long long>(ttfb.count(), 0, UINT32_MAX)));
+
+    ssize_t bytes = static_cast<ssize_t>(window.size() * sizeof(uint32_t));
+    if (pwrite(fd, window.data(), static_cast<size_t>(bytes), 0) == bytes) {
+        samples_ = window;
+        loaded_ = true;
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+std::optional<std::chrono::milliseconds> LatencyTracker::p95() {
+    load();
+    if (samples_.size() < kMinSamples) return std::nullopt;
+
+    std::vector<uint32_t> sorted = samples_;
+    size_t rank = (sorted.size() * 95 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<long>(rank), sorted.end());
+    return std::chrono::milliseconds(sorted[rank]);
+}
+
+} // namespace neuron
@@ -0,0 +1,937 @@
+#include "neuron/safety.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace neuron {
+
+namespace {
+
+// Shipped rules, in the rule file format
+constexpr std::string_view kBuiltinRules = R"(
+critical rm-root        cmd=rm flag=r,R,recursive arg=/,/\*,~,~/,~/\*,$HOME,$HOME/,$HOME/\*,${HOME},${HOME}/,${HOME}/\*,/home,/etc,/usr,/var,/boot,/bin,/lib -- Recursively deletes the system or a home directory
+high     rm-recursive   cmd=rm flag=r,R,recursive -- Recursively deletes files
+medium   rm-force       cmd=rm flag=f,force -- Deletes files without asking
+medium   shred          cmd=shred,srm -- Irrecoverably overwrites files
+critical mkfs           cmd=mkfs,mkfs.*,mke2fs,mkswap,wipefs,newfs,newfs_* -- Creates a filesystem, erasing what was there
+critical dd-device      cmd=dd arg=of=/dev/* -- Writes raw data to a device
+medium   dd             cmd=dd arg=if=* -- Copies raw data with dd
+high     partition      cmd=fdisk,sfdisk,gdisk,cfdisk,parted,diskutil -- Edits disk partitions
+critical redirect-disk  redirect=/dev/sd*,/dev/hd*,/dev/nvme*,/dev/vd*,/dev/xvd*,/dev/mmcblk*,/dev/disk* -- Overwrites a disk device
+high     redirect-system redirect=/etc/*,/boot/*,/usr/*,/bin/*,/sbin/*,/lib/* -- Overwrites a system file
+critical mv-root        cmd=mv source=/,/\*,~,~/,$HOME,$HOME/,${HOME},${HOME}/,/home,/etc,/usr,/var,/boot,/bin,/lib -- Moves the system or a home directory away
+critical rsync-delete-root cmd=rsync flag=delete,del,delete-before,delete-during,delete-delay,delete-after,delete-excluded dest=/,~,~/,$HOME,$HOME/,${HOME},${HOME}/ -- Deletes everything on the system or in a home directory that is not in the source
+medium   rsync-delete   cmd=rsync flag=delete,del,delete-before,delete-during,delete-delay,delete-after,delete-excluded -- Deletes files at the destination that are not in the source
+critical tee-disk       cmd=tee arg=/dev/sd*,/dev/hd*,/dev/nvme*,/dev/vd*,/dev/xvd*,/dev/mmcblk*,/dev/disk* -- Overwrites a disk device
+high     tee-system     cmd=tee arg=/etc/*,/boot/*,/usr/*,/bin/*,/sbin/*,/lib/* -- Overwrites a system file
+critical fork-bomb      text=:(){ -- Fork bomb
+high     format         cmd=format,format.com -- Formats a drive
+critical del-drive      cmd=del,erase,rmdir,rd arg=?:,?:\\,?:/,?:\*,?:\\\*,?:/\* -- Deletes everything on a drive
+high     del-recursive  cmd=del,erase arg=/s,/S -- Recursively deletes files
+high     rmdir-recursive cmd=rmdir,rd arg=/s,/S -- Recursively deletes a directory
+medium   del-force      cmd=del,erase arg=/f,/F,/q,/Q -- Deletes files without asking
+high     pipe-to-shell  pipe-to=sh,bash,zsh,dash,ksh,fish,python,python3,perl,ruby,node -- Runs code fetched or generated on the fly
+high     run-download   cmd=sh,bash,zsh,dash,ksh,fish,source,.,eval,python,python3,perl,ruby,node subst=curl,wget,fetch -- Runs code downloaded on the fly
+high     chmod-open     cmd=chmod arg=777,a+rwx,o+w,a+w -- Makes files writable by everyone
+high     chmod-none     cmd=chmod flag=R,recursive arg=000,0000,a-rwx,ugo-rwx,a=,ugo= -- Recursively takes away every permission
+high     chown-recursive cmd=chown,chgrp flag=R,recursive -- Recursively changes ownership
+high     shutdown       cmd=shutdown,reboot,halt,poweroff,init -- Shuts down or restarts the machine
+high     power-state    cmd=systemctl,loginctl arg=poweroff,reboot,halt,kexec,suspend,hibernate,hybrid-sleep,suspend-then-hibernate,rescue,emergency -- Shuts down, restarts or suspends the machine
+high     git-force-push cmd=git arg=push flag=f,force -- Overwrites remote history
+high     git-force-refspec cmd=git arg=push arg=+* -- Overwrites remote history
+medium   git-reset-hard cmd=git arg=reset flag=hard -- Discards local changes
+medium   git-clean      cmd=git arg=clean flag=f,force -- Deletes untracked files
+high     firewall-flush cmd=iptables,ip6tables,nft flag=F,flush -- Removes firewall rules
+high     kill-everything cmd=kill arg=-1 -- Signals every process the user may signal
+medium   kill-all       cmd=killall,pkill -- Kills processes by name
+medium   kill           cmd=kill -- Signals processes
+high     userdel        cmd=userdel,deluser -- Deletes a user account
+medium   crontab-remove cmd=crontab flag=r -- Removes the crontab
+medium   find-delete    cmd=find flag=delete -- Deletes every file found
+medium   truncate       cmd=truncate -- Truncates files
+medium   sudo           sudo -- Runs with elevated privileges
+low      install        cmd=apt,apt-get,brew,dnf,yum,pacman,zypper,port,snap arg=install -- Installs packages
+)";
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+std::string_view basename(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+std::string program_of(const std::vector<std::string>& words) {
+    return words.empty() ? std::string() : lower(basename(words[0]));
+}
+
+// Glob with * for any run of characters, ? for any one and \ to take the
+// next one literally
+bool glob_match(std::string_view pattern, std::string_view text) {
+    size_t p = 0, t = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+            continue;
+        }
+        if (p < pattern.size()) {
+            char want = pattern[p];
+            size_t width = 1;
+            if (want == '\\' && p + 1 < pattern.size()) {
+                want = pattern[p + 1];
+                width = 2;
+            }
+            if (want == text[t] || (want == '?' && width == 1)) {
+                p += width;
+                ++t;
+                continue;
+            }
+        }
+        if (star == std::string_view::npos) return false;
+        p = star + 1;
+        t = ++resume;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+bool any_glob(const std::vector<std::string>& patterns, std::string_view text) {
+    return std::any_of(patterns.begin(), patterns.end(), [&](const std::string& p) { return glob_match(p, text); });
+}
+
+// The fixed text a glob starts with, which the prefilter can look for
+std::string literal_prefix(std::string_view pattern) {
+    std::string out;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '*' || pattern[i] == '?') break;
+        if (pattern[i] == '\\' && i + 1 < pattern.size()) ++i;
+        out += static_cast<char>(std::tolower(static_cast<unsigned char>(pattern[i])));
+    }
+    return out;
+}
+
+std::vector<std::string> split_alternatives(std::string_view value) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string_view::npos) comma = value.size();
+        if (comma > start) out.emplace_back(value.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+std::optional<Severity> parse_severity(std::string_view name) {
+    if (name == "low") return Severity::LOW;
+    if (name == "medium") return Severity::MEDIUM;
+    if (name == "high") return Severity::HIGH;
+    if (name == "critical") return Severity::CRITICAL;
+    if (name == "off" || name == "none") return Severity::NONE;
+    return std::nullopt;
+}
+
+bool is_assignment(std::string_view word) {
+    size_t eq = word.find('=');
+    if (eq == 0 || eq == std::string_view::npos) return false;
+    for (size_t i = 0; i < eq; ++i) {
+        char c = word[i];
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_')) return false;
+    }
+    return !std::isdigit(static_cast<unsigned char>(word[0]));
+}
+
+bool is_digits(std::string_view word) {
+    return !word.empty() && std::all_of(word.begin(), word.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Whether word sets the option named flag: -f inside a cluster like -rf,
+// or -flag / --flag / --flag=value spelled out
+bool sets_flag(std::string_view word, std::string_view flag) {
+    if (word.size() < 2 || word[0] != '-') return false;
+    if (word[1] == '-') {
+        std::string_view name = word.substr(2);
+        name = name.substr(0, name.find('='));
+        return name == flag;
+    }
+    if (word.substr(1) == flag) return true;
+    return flag.size() == 1 && word.find(flag[0], 1) != std::string_view::npos;
+}
+
+constexpr int kMaxDepth = 8;
+
+// Turns shell text into ShellCommands: tokenizes with quote removal,
+// splits at ; & && || | and newlines, and recurses into substitutions
+class ShellParser {
+public:
+    ShellParser(std::vector<ShellCommand>& out, int depth, bool privileged)
+        : out_(out), depth_(depth), privileged_(privileged) {}
+
+    void parse(std::string_view text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            switch (c) {
+                case ' ':
+                case '\t':
+                case '\r':
+                    end_word();
+                    ++i;
+                    break;
+                case '\n':
+                case ';':
+                case '(':
+                case ')':
+                    end_command(false);
+                    ++i;
+                    break;
+                case '&':
+                    if (i + 1 < text.size() && text[i + 1] == '>') {
+                        // &> and &>> send both streams to a file
+                        end_word();
+                        i += 2;
+                        if (i < text.size() && text[i] == '>') ++i;
+                        pending_ = Pending::OUTPUT;
+                    } else {
+                        end_command(false);
+                        i += (i + 1 < text.size() && text[i + 1] == '&') ? 2 : 1;
+                    }
+                    break;
+                case '|':
+                    if (i + 1 < text.size() && text[i + 1] == '|') {
+                        end_command(false);
+                        i += 2;
+                    } else {
+                        end_command(true);
+                        i += (i + 1 < text.size() && text[i + 1] == '&') ? 2 : 1;
+                    }
+                    break;
+                case '>':
+                    i = redirect_out(text, i);
+                    break;
+                case '<':
+                    i = redirect_in(text, i);
+                    break;
+                case '#':
+                    if (in_word_) {
+                        word_ += c;
+                        ++i;
+                    } else {
+                        size_t newline = text.find('\n', i);
+                        i = newline == std::string_view::npos ? text.size() : newline;
+                    }
+                    break;
+                case '\'': {
+                    in_word_ = true;
+                    size_t close = text.find('\'', i + 1);
+                    if (close == std::string_view::npos) close = text.size();
+                    word_.append(text.substr(i + 1, close - i - 1));
+                    i = close + 1;
+                    break;
+                }
+                case '"':
+                    i = double_quoted(text, i + 1);
+                    break;
+                case '\\':
+                    in_word_ = true;
+                    if (i + 1 < text.size() && text[i + 1] != '\n') word_ += text[i + 1];
+                    i += 2;
+                    break;
+                case '$':
+                    i = dollar(text, i);
+                    break;
+                case '`':
+                    i = backtick(text, i);
+                    break;
+                default:
+                    in_word_ = true;
+                    word_ += c;
+                    ++i;
+            }
+        }
+        end_command(false);
+    }
+
+private:
+    enum class Pending { NONE, OUTPUT, INPUT };
+
+    std::vector<ShellCommand>& out_;
+    int depth_;
+    bool privileged_;
+
+    ShellCommand current_;
+    std::string word_;
+    bool in_word_ = false;
+    Pending pending_ = Pending::NONE;
+    long pipe_from_ = -1;
+
+    void end_word() {
+        if (!in_word_) return;
+        if (pending_ == Pending::OUTPUT) {
+            current_.redirects.push_back(std::move(word_));
+        } else if (pending_ == Pending::NONE) {
+            current_.words.push_back(std::move(word_));
+        }
+        pending_ = Pending::NONE;
+        word_.clear();
+        in_word_ = false;
+    }
+
+    void end_command(bool piped) {
+        end_word();
+        pending_ = Pending::NONE;
+        if (current_.words.empty() && current_.redirects.empty()) {
+            if (!piped) pipe_from_ = -1;
+            return;
+        }
+
+        long index = static_cast<long>(out_.size());
+        current_.privileged = current_.privileged || privileged_;
+        out_.push_back(std::move(current_));
+        current_ = ShellCommand{};
+        expand(static_cast<size_t>(index));
+
+        if (pipe_from_ >= 0) {
+            out_[static_cast<size_t>(pipe_from_)].pipes_to = program_of(out_[static_cast<size_t>(index)].words);
+        }
+        pipe_from_ = piped ? index : -1;
+    }
+
+    // A word made only of digits right before > is a file descriptor
+    void drop_fd_word() {
+        if (in_word_ && is_digits(word_)) {
+            word_.clear();
+            in_word_ = false;
+        }
+        end_word();
+    }
+
+    size_t redirect_out(std::string_view text, size_t i) {
+        drop_fd_word();
+        ++i;
+        if (i < text.size() && (text[i] == '>' || text[i] == '|')) ++i;
+        if (i < text.size() && text[i] == '&') {
+            // >&2 duplicates a descriptor rather than naming a file
+            size_t j = i + 1;
+            while (j < text.size() && (std::isdigit(static_cast<unsigned char>(text[j])) || text[j] == '-')) ++j;
+            if (j > i + 1) return j;
+            ++i;
+        }
+        pending_ = Pending::OUTPUT;
+        return i;
+    }
+
+    size_t redirect_in(std::string_view text, size_t i) {
+        drop_fd_word();
+        if (i + 1 < text.size() && text[i + 1] == '(') {
+            return substitution(text, i + 1, '(', ')');
+        }
+        ++i;
+        while (i < text.size() && (text[i] == '<' || text[i] == '-' || text[i] == '&')) ++i;
+        pending_ = Pending::INPUT;
+        return i;
+    }
+
+    size_t double_quoted(std::string_view text, size_t i) {
+        in_word_ = true;
+        while (i < text.size() && text[i] != '"') {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size()) {
+                char next = text[i + 1];
+                if (next == '$' || next == '`' || next == '"' || next == '\\') {
+                    word_ += next;
+                } else if (next != '\n') {
+                    word_ += c;
+                    word_ += next;
+                }
+                i += 2;
+            } else if (c == '$') {
+                i = dollar(text, i);
+            } else if (c == '`') {
+                i = backtick(text, i);
+            } else {
+                word_ += c;
+                ++i;
+            }
+        }
+        return i + 1;
+    }
+
+    size_t dollar(std::string_view text, size_t i) {
+        in_word_ = true;
+        if (i + 1 < text.size() && text[i + 1] == '(') {
+            if (i + 2 < text.size() && text[i + 2] == '(') {
+                // Arithmetic expansion, not a command
+                size_t close = matching(text, i + 1, '(', ')');
+                word_.append(text.substr(i, close - i));
+                return close;
+            }
+            return substitution(text, i + 1, '(', ')');
+        }
+        if (i + 1 < text.size() && text[i + 1] == '{') {
+            size_t close = matching(text, i + 1, '{', '}');
+            word_.append(text.substr(i, close - i));
+            return close;
+        }
+        word_ += '$';
+        return i + 1;
+    }
+
+    size_t backtick(std::string_view text, size_t i) {
+        size_t close = i + 1;
+        while (close < text.size() && text[close] != '`') {
+            if (text[close] == '\\') ++close;
+            ++close;
+        }
+        close = std::min(close, text.size());
+        substitute(text.substr(i + 1, close - i - 1));
+        in_word_ = true;
+        word_ += "$()";
+        return close + 1;
+    }
+
+    // Parses $(...) or <(...) as commands of their own and leaves a
+    // placeholder in the current word
+    size_t substitution(std::string_view text, size_t open, char open_char, char close_char) {
+        size_t close = matching(text, open, open_char, close_char);
+        size_t inner_end = close > open + 1 ? close - 1 : open + 1;
+        substitute(text.substr(open + 1, inner_end - open - 1));
+        in_word_ = true;
+        word_ += "$()";
+        return close;
+    }
+
+    // Index just past the bracket matching the one at open, skipping quotes
+    static size_t matching(std::string_view text, size_t open, char open_char, char close_char) {
+        int depth = 0;
+        for (size_t i = open; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '\\') {
+                ++i;
+            } else if (c == '\'') {
+                size_t close = text.find('\'', i + 1);
+                if (close == std::string_view::npos) return text.size();
+                i = close;
+            } else if (c == '"') {
+                for (++i; i < text.size() && text[i] != '"'; ++i) {
+                    if (text[i] == '\\') ++i;
+                }
+            } else if (c == open_char) {
+                ++depth;
+            } else if (c == close_char && --depth == 0) {
+                return i + 1;
+            }
+        }
+        return text.size();
+    }
+
+    // Parses the text of a substitution and notes the programs it runs on
+    // the command it is spliced into
+    void substitute(std::string_view text) {
+        size_t first = out_.size();
+        nested(text);
+        for (size_t i = first; i < out_.size(); ++i) {
+            std::string program = program_of(out_[i].words);
+            if (!program.empty()) current_.substituted.push_back(std::move(program));
+        }
+    }
+
+    void nested(std::string_view text, bool privileged = false) {
+        if (depth_ >= kMaxDepth) return;
+        ShellParser(out_, depth_ + 1, privileged_ || privileged).parse(text);
+    }
+
+    void nested(std::vector<std::string> words, bool privileged) {
+        if (depth_ >= kMaxDepth || words.empty()) return;
+        ShellCommand command;
+        command.words = std::move(words);
+        command.privileged = privileged;
+        out_.push_back(std::move(command));
+        ShellParser(out_, depth_ + 1, privileged).expand(out_.size() - 1);
+    }
+
+    // Strips wrappers off the command at index and parses anything it runs
+    void expand(size_t index) {
+        strip_wrappers(out_[index]);
+
+        // Copies, since nested parsing appends to out_
+        const std::vector<std::string> words = out_[index].words;
+        const bool privileged = out_[index].privileged;
+        if (words.empty()) return;
+
+        static const std::unordered_set<std::string> shells = {"sh", "bash", "zsh", "dash", "ksh", "fish"};
+        const std::string program = program_of(words);
+
+        if (shells.count(program)) {
+            for (size_t i = 1; i + 1 < words.size(); ++i) {
+                if (words[i].size() > 1 && words[i][0] == '-' && words[i][1] != '-' &&
+                    words[i].find('c') != std::string::npos) {
+                    nested(words[i + 1], privileged);
+                    break;
+                }
+            }
+        } else if (program == "eval") {
+            std::string joined;
+            for (size_t i = 1; i < words.size(); ++i) {
+                joined += words[i];
+                joined += ' ';
+            }
+            nested(joined, privileged);
+        } else if (program == "watch" || program == "ssh") {
+            // Both join the rest of their arguments into a line for a shell,
+            // ssh's on the host named first. Their options that take a value:
+            static const std::unordered_set<std::string> watch_values = {"-n", "--interval", "-q", "--equexit"};
+            static const std::unordered_set<std::string> ssh_values = {
+                "-b", "-c", "-D", "-E", "-e", "-F", "-I", "-i", "-J", "-L", "-l", "-m",
+                "-O", "-o", "-p", "-Q", "-R", "-S", "-W", "-w"};
+            const auto& values = program == "ssh" ? ssh_values : watch_values;
+            size_t i = 1;
+            while (i < words.size() && words[i].size() > 1 && words[i][0] == '-') {
+                if (words[i] == "--") {
+                    ++i;
+                    break;
+                }
+                i += values.count(words[i]) ? 2 : 1;
+            }
+            if (program == "ssh") ++i;  // The host
+            std::string joined;
+            for (; i < words.size(); ++i) {
+                joined += words[i];
+                joined += ' ';
+            }
+            nested(joined, privileged);
+        } else if (program == "find") {
+            for (size_t i = 1; i < words.size(); ++i) {
+                if (words[i] != "-exec" && words[i] != "-execdir" && words[i] != "-ok" && words[i] != "-okdir") continue;
+                std::vector<std::string> exec;
+                for (++i; i < words.size() && words[i] != ";" && words[i] != "+"; ++i) {
+                    exec.push_back(words[i]);
+                }
+                nested(std::move(exec), privileged);
+            }
+        }
+    }
+
+    // Drops leading assignments, reserved words and programs that only run
+    // another command (sudo, env, nohup, xargs, ...) with their options
+    static void strip_wrappers(ShellCommand& command) {
+        static const std::unordered_set<std::string> keywords = {
+            "!", "{", "}", "if", "then", "else", "elif", "do", "while", "until", "fi", "done"};
+        // Programs that run the rest of their arguments, with their options that take a value
+        static const std::unordered_map<std::string, std::unordered_set<std::string>> wrappers = {
+            {"sudo", {"-u", "-g", "-C", "-D", "-h", "-p", "-r", "-t", "-U"}},
+            {"doas", {"-u", "-C"}},
+            {"env", {"-u", "-C", "-S"}},
+            {"nice", {"-n"}},
+            {"ionice", {"-c", "-n", "-p"}},
+            {"timeout", {"-s", "-k"}},
+            {"xargs", {"-I", "-n", "-P", "-d", "-L", "-s", "-a", "-E"}},
+            {"time", {"-f", "-o"}},
+            {"exec", {"-a"}},
+            {"stdbuf", {"-i", "-o", "-e"}},
+            {"nohup", {}},
+            {"command", {}},
+            {"builtin", {}},
+            {"setsid", {}},
+            {"caffeinate", {}},
+            {"unbuffer", {}},
+            {"chronic", {}},
+            {"busybox", {}},
+            {"toybox", {}},
+        };
+
+        auto& words = command.words;
+        size_t i = 0;
+        while (i < words.size()) {
+            if (is_assignment(words[i])) {
+                ++i;
+                continue;
+            }
+            std::string program = lower(basename(words[i]));
+            if (keywords.count(program)) {
+                ++i;
+                continue;
+            }
+            auto wrapper = wrappers.find(program);
+            if (wrapper == wrappers.end()) break;
+
+            if (program == "sudo" || program == "doas") command.privileged = true;
+            ++i;
+            while (i < words.size() && words[i].size() > 1 && words[i][0] == '-') {
+                if (words[i] == "--") {
+                    ++i;
+                    break;
+                }
+                i += wrapper->second.count(words[i]) ? 2 : 1;
+            }
+            // timeout's duration comes before the command
+            if (program == "timeout" && i < words.size()) ++i;
+        }
+        words.erase(words.begin(), words.begin() + static_cast<long>(std::min(i, words.size())));
+    }
+};
+
+// The words after the program that are not options
+std::vector<std::string_view> operands(const std::vector<std::string>& words) {
+    std::vector<std::string_view> out;
+    bool options_done = false;
+    for (size_t i = 1; i < words.size(); ++i) {
+        if (!options_done && words[i] == "--") {
+            options_done = true;
+        } else if (options_done || words[i].size() < 2 || words[i][0] != '-') {
+            out.push_back(words[i]);
+        }
+    }
+    return out;
+}
+
+// Condition checks for one command; the line-wide text= check is done by the caller
+bool matches(const SafetyRule& rule, const ShellCommand& command) {
+    const auto& words = command.words;
+    if (rule.privileged && !command.privileged) return false;
+
+    if (!rule.programs.empty()) {
+        if (words.empty() || !any_glob(rule.programs, program_of(words))) return false;
+    }
+
+    for (const auto& group : rule.flags) {
+        bool found = false;
+        for (size_t i = 1; i < words.size() && !found && words[i] != "--"; ++i) {
+            found = std::any_of(group.begin(), group.end(), [&](const std::string& f) { return sets_flag(words[i], f); });
+        }
+        if (!found) return false;
+    }
+
+    for (const auto& group : rule.args) {
+        bool found = false;
+        bool options_done = false;
+        for (size_t i = 1; i < words.size() && !found; ++i) {
+            if (!options_done && words[i] == "--") {
+                options_done = true;
+                continue;
+            }
+            if (!options_done && words[i].size() > 1 && words[i][0] == '-') {
+                // Only an argument spelled like an option, such as kill's -1, matches one
+                found = std::any_of(group.begin(), group.end(),
+                                    [&](const std::string& p) { return p[0] == '-' && glob_match(p, words[i]); });
+                continue;
+            }
+            found = any_glob(group, words[i]);
+        }
+        if (!found) return false;
+    }
+
+    if (!rule.sources.empty() || !rule.destinations.empty()) {
+        auto ops = operands(words);
+        auto is_source = [&](std::string_view op) { return any_glob(rule.sources, op); };
+        if (!rule.sources.empty() && (ops.size() < 2 || std::none_of(ops.begin(), ops.end() - 1, is_source))) {
+            return false;
+        }
+        if (!rule.destinations.empty() && (ops.empty() || !any_glob(rule.destinations, ops.back()))) return false;
+    }
+
+    if (!rule.redirects.empty()) {
+        bool found = std::any_of(command.redirects.begin(), command.redirects.end(),
+                                 [&](const std::string& target) { return any_glob(rule.redirects, target); });
+        if (!found) return false;
+    }
+
+    if (!rule.pipes_to.empty()) {
+        if (command.pipes_to.empty() || !any_glob(rule.pipes_to, command.pipes_to)) return false;
+    }
+
+    if (!rule.substituted.empty()) {
+        bool found = std::any_of(command.substituted.begin(), command.substituted.end(),
+                                 [&](const std::string& program) { return any_glob(rule.substituted, program); });
+        if (!found) return false;
+    }
+    return true;
+}
+
+bool has_command_conditions(const SafetyRule& rule) {
+    return rule.privileged || !rule.programs.empty() || !rule.flags.empty() || !rule.args.empty() ||
+           !rule.sources.empty() || !rule.destinations.empty() ||
+           !rule.redirects.empty() || !rule.pipes_to.empty() || !rule.substituted.empty();
+}
+
+// What the prefilter scans: lowercase, with quotes and backslashes removed
+// so r''m and \rm still read as rm
+std::string scan_text(std::string_view command) {
+    std::string out;
+    out.reserve(command.size());
+    for (char c : command) {
+        if (c == '\'' || c == '"' || c == '\\') continue;
+        out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+} // namespace
+
+const char* severity_name(Severity severity) {
+    switch (severity) {
+        case Severity::LOW: return "low";
+        case Severity::MEDIUM: return "medium";
+        case Severity::HIGH: return "high";
+        case Severity::CRITICAL: return "critical";
+        case Severity::NONE: break;
+    }
+    return "none";
+}
+
+std::vector<ShellCommand> parse_shell(std::string_view text) {
+    std::vector<ShellCommand> commands;
+    ShellParser(commands, 0, false).parse(text);
+    return commands;
+}
+
+SafetyAnalyzer::SafetyAnalyzer(const std::string& rules_path) {
+    load(kBuiltinRules, "built-in rules");
+
+    if (!rules_path.empty()) {
+        std::ifstream file(rules_path);
+        if (file) {
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            load(buffer.str(), rules_path);
+        } else {
+            std::cerr << "Warning: cannot read safety rules from " << rules_path << std::endl;
+        }
+    }
+    compile();
+}
+
+void SafetyAnalyzer::load(std::string_view text, std::string_view origin) {
+    size_t line_number = 0;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(start, end - start);
+        start = end + 1;
+        ++line_number;
+
+        std::string message;
+        size_t dashes = line.find(" -- ");
+        if (dashes != std::string_view::npos) {
+            message = std::string(line.substr(dashes + 4));
+            line = line.substr(0, dashes);
+        }
+
+        std::istringstream fields{std::string(line)};
+        std::string severity_word, id;
+        if (!(fields >> severity_word) || severity_word[0] == '#') continue;
+
+        auto warn = [&](const std::string& problem) {
+            std::cerr << "Warning: " << origin << ":" << line_number << ": " << problem << std::endl;
+        };
+
+        auto severity = parse_severity(lower(severity_word));
+        if (!severity) {
+            warn("unknown severity '" + severity_word + "'");
+            continue;
+        }
+        if (!(fields >> id)) {
+            warn("missing rule id");
+            continue;
+        }
+
+        // A later rule with the same id replaces the earlier one
+        rules_.erase(std::remove_if(rules_.begin(), rules_.end(), [&](const SafetyRule& r) { return r.id == id; }),
+                     rules_.end());
+        if (*severity == Severity::NONE) continue;
+
+        SafetyRule rule;
+        rule.id = id;
+        rule.severity = *severity;
+        rule.message = message.empty() ? id : message;
+
+        std::string condition;
+        bool valid = true;
+        while (fields >> condition) {
+            if (condition == "sudo") {
+                rule.privileged = true;
+                continue;
+            }
+            size_t eq = condition.find('=');
+            std::string key = condition.substr(0, eq);
+            auto values = eq == std::string::npos ? std::vector<std::string>{} : split_alternatives(condition.substr(eq + 1));
+            if (values.empty()) {
+                warn("condition '" + condition + "' has no value");
+                valid = false;
+                break;
+            }
+
+            if (key == "cmd") {
+                for (auto& v : values) rule.programs.push_back(lower(v));
+            } else if (key == "flag") {
+                rule.flags.push_back(std::move(values));
+            } else if (key == "arg") {
+                rule.args.push_back(std::move(values));
+            } else if (key == "source") {
+                rule.sources.insert(rule.sources.end(), values.begin(), values.end());
+            } else if (key == "dest") {
+                rule.destinations.insert(rule.destinations.end(), values.begin(), values.end());
+            } else if (key == "redirect") {
+                rule.redirects.insert(rule.redirects.end(), values.begin(), values.end());
+            } else if (key == "pipe-to") {
+                for (auto& v : values) rule.pipes_to.push_back(lower(v));
+            } else if (key == "subst") {
+                for (auto& v : values) rule.substituted.push_back(lower(v));
+            } else if (key == "text") {
+                for (auto& v : values) rule.texts.push_back(lower(v));
+            } else {
+                warn("unknown condition '" + key + "'");
+                valid = false;
+                break;
+            }
+        }
+        if (!valid) continue;
+        if (!has_command_conditions(rule) && rule.texts.empty()) {
+            warn("rule '" + id + "' has no conditions");
+            continue;
+        }
+        rules_.push_back(std::move(rule));
+    }
+}
+
+void SafetyAnalyzer::compile() {
+    // The literal each rule keys on: the most selective condition it has
+    std::vector<std::pair<std::string, uint32_t>> literals;
+    for (uint32_t r = 0; r < rules_.size(); ++r) {
+        const SafetyRule& rule = rules_[r];
+        std::vector<std::string> keys;
+        if (!rule.substituted.empty()) {
+            for (const auto& p : rule.substituted) keys.push_back(literal_prefix(p));
+        } else if (!rule.programs.empty()) {
+            for (const auto& p : rule.programs) keys.push_back(literal_prefix(p));
+        } else if (!rule.texts.empty()) {
+            keys = rule.texts;
+        } else if (!rule.redirects.empty()) {
+            for (const auto& p : rule.redirects) keys.push_back(literal_prefix(p));
+        } else if (!rule.pipes_to.empty()) {
+            for (const auto& p : rule.pipes_to) keys.push_back(literal_prefix(p));
+        } else if (rule.privileged) {
+            keys = {"sudo", "doas"};
+        }
+
+        bool keyed = !keys.empty() && std::none_of(keys.begin(), keys.end(), [](const std::string& k) { return k.empty(); });
+        if (!keyed) {
+            unkeyed_.push_back(r);
+            continue;
+        }
+        for (auto& key : keys) literals.emplace_back(std::move(key), r);
+    }
+
+    // Only bytes that occur in some literal need their own column
+    classes_.fill(0);
+    class_count_ = 1;
+    for (const auto& [literal, rule] : literals) {
+        for (unsigned char c : literal) {
+            if (classes_[c] == 0) classes_[c] = static_cast<uint8_t>(class_count_++);
+        }
+    }
+
+    // Trie of all literals
+    next_.assign(class_count_, -1);
+    outputs_.assign(1, {});
+    for (const auto& [literal, rule] : literals) {
+        size_t state = 0;
+        for (unsigned char c : literal) {
+            int32_t& slot = next_[state * class_count_ + classes_[c]];
+            if (slot < 0) {
+                slot = static_cast<int32_t>(outputs_.size());
+                outputs_.emplace_back();
+                next_.resize(next_.size() + class_count_, -1);
+            }
+            state = static_cast<size_t>(next_[state * class_count_ + classes_[c]]);
+        }
+        outputs_[state].push_back(rule);
+    }
+
+    // Breadth-first failure links, folded into the table so scanning is a
+    // single lookup per byte
+    std::vector<int32_t> fail(outputs_.size(), 0);
+    std::deque<size_t> queue;
+    for (size_t c = 0; c < class_count_; ++c) {
+        int32_t& slot = next_[c];
+        if (slot < 0) {
+            slot = 0;
+        } else {
+            queue.push_back(static_cast<size_t>(slot));
+        }
+    }
+    while (!queue.empty()) {
+        size_t state = queue.front();
+        queue.pop_front();
+        for (size_t c = 0; c < class_count_; ++c) {
+            int32_t& slot = next_[state * class_count_ + c];
+            int32_t via_fail = next_[static_cast<size_t>(fail[state]) * class_count_ + c];
+            if (slot < 0) {
+                slot = via_fail;
+                continue;
+            }
+            size_t child = static_cast<size_t>(slot);
+            fail[child] = via_fail;
+            const auto& inherited = outputs_[static_cast<size_t>(via_fail)];
+            outputs_[child].insert(outputs_[child].end(), inherited.begin(), inherited.end());
+            queue.push_back(child);
+        }
+    }
+}
+
+SafetyReport SafetyAnalyzer::analyze(std::string_view command) const {
+    SafetyReport report;
+
+    const std::string text = scan_text(command);
+    std::vector<char> candidate(rules_.size(), 0);
+    bool any = false;
+    for (uint32_t r : unkeyed_) {
+        candidate[r] = 1;
+        any = true;
+    }
+    size_t state = 0;
+    for (unsigned char c : text) {
+        state = static_cast<size_t>(next_[state * class_count_ + classes_[c]]);
+        for (uint32_t r : outputs_[state]) {
+            candidate[r] = 1;
+            any = true;
+        }
+    }
+    if (!any) return report;
+
+    const auto commands = parse_shell(command);
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        if (!candidate[r]) continue;
+        const SafetyRule& rule = rules_[r];
+
+        bool hit = rule.texts.empty() ||
+                   std::any_of(rule.texts.begin(), rule.texts.end(),
+                               [&](const std::string& t) { return text.find(t) != std::string::npos; });
+        if (hit && has_command_conditions(rule)) {
+            hit = std::any_of(commands.begin(), commands.end(), [&](const ShellCommand& c) { return matches(rule, c); });
+        }
+        if (hit) {
+            report.findings.push_back(SafetyFinding{rule.id, rule.severity, rule.message});
+            report.severity = std::max(report.severity, rule.severity);
+        }
+    }
+
+    std::stable_sort(report.findings.begin(), report.findings.end(),
+                     [](const SafetyFinding& a, const SafetyFinding& b) { return a.severity > b.severity; });
+    return report;
+}
+
+} // namespace neuron
@@ -0,0 +1,357 @@
+#include "neuron/semantic_cache.hpp"
+#include "neuron/actions.hpp"
+#include "neuron/file_lock.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define NEURON_HAVE_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define NEURON_HAVE_NEON 1
+#endif
+
+namespace neuron {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x3143534e;   // "NSC1"
+constexpr uint32_t kVersion = 3;
+constexpr size_t kDims = PromptVector::kDims;
+
+// Words that carry no meaning for command generation
+const std::unordered_set<std::string_view>& stop_words() {
+    static const std::unordered_set<std::string_view> words = {
+        "a", "an", "the", "please", "me", "my", "i", "we", "our", "can", "could", "would",
+        "you", "how", "do", "some", "that", "this", "these", "those", "just", "want",
+        "need", "is", "are", "there", "which", "what", "it", "its", "of", "command",
+    };
+    return words;
+}
+
+// Words that flip the meaning of a request; they must match exactly
+const std::unordered_set<std::string_view>& negations() {
+    static const std::unordered_set<std::string_view> words = {
+        "not", "no", "without", "except", "excluding", "never", "nor",
+        "don", "doesn", "isn", "aren", "won", "non",
+    };
+    return words;
+}
+
+// Common ways of saying the same thing in a shell request
+const std::unordered_map<std::string_view, std::string_view>& synonyms() {
+    static const std::unordered_map<std::string_view, std::string_view> words = {
+        {"big", "large"}, {"bigger", "large"}, {"biggest", "large"}, {"larger", "large"},
+        {"largest", "large"}, {"huge", "large"},
+        {"smaller", "small"}, {"smallest", "small"}, {"tiny", "small"},
+        {"show", "list"}, {"display", "list"}, {"print", "list"},
+        {"folder", "directory"}, {"dir", "directory"},
+        {"remove", "delete"}, {"erase", "delete"},
+        {"find", "list"}, {"search", "list"}, {"locate", "list"},
+    };
+    return words;
+}
+
+bool is_token_char(unsigned char c) {
+    return std::isalnum(c) || (c && std::strchr("._/-~*:$=+@%", c) != nullptr);
+}
+
+// Anything that looks like a path, flag, number, glob or extension
+bool is_literal(std::string_view token) {
+    return std::any_of(token.begin(), token.end(), [](unsigned char c) {
+        return std::isdigit(c) || (c && std::strchr("./_~*:$=+@%-", c) != nullptr);
+    });
+}
+
+// Plurals only; anything cleverer merges words that mean different things
+std::string stem(std::string word) {
+    auto ends_with = [&](std::string_view suffix) {
+        return word.size() > suffix.size() && word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (word.size() <= 3) return word;
+    if (ends_with("ies")) return word.substr(0, word.size() - 3) + "y";
+    if (ends_with("sses") || ends_with("xes") || ends_with("ches") || ends_with("shes")) {
+        return word.substr(0, word.size() - 2);
+    }
+    if (ends_with("s") && !ends_with("ss") && !ends_with("us") && !ends_with("is")) {
+        return word.substr(0, word.size() - 1);
+    }
+    return word;
+}
+
+void add_feature(PromptVector& vec, std::string_view kind, std::string_view feature, float weight) {
+    uint64_t h = mix64(fnv1a64(feature, fnv1a64(kind)));
+    float sign = (h >> 63) ? -1.0f : 1.0f;
+    vec.values[h % kDims] += sign * weight;
+}
+
+float dot_scalar(const float* a, const float* b) {
+    float sum = 0;
+    for (size_t i = 0; i < kDims; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(NEURON_HAVE_AVX2)
+__attribute__((target("avx2,fma")))
+float dot_avx2(const float* a, const float* b) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < kDims; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#if defined(NEURON_HAVE_NEON)
+float dot_neon(const float* a, const float* b) {
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    for (size_t i = 0; i < kDims; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+}
+#endif
+
+using DotFn = float (*)(const float*, const float*);
+
+DotFn select_dot() {
+#if defined(NEURON_HAVE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return dot_avx2;
+#elif defined(NEURON_HAVE_NEON)
+    return dot_neon;
+#endif
+    return dot_scalar;
+}
+
+} // namespace
+
+float dot(const float* a, const float* b) {
+    static const DotFn impl = select_dot();
+    return impl(a, b);
+}
+
+PromptVector PromptVector::from(std::string_view prompt) {
+    PromptVector vec;
+
+    // Tokenize, lowercase and normalize; literals are kept verbatim
+    std::vector<std::string> words;
+    Hasher anchors;
+    std::set<std::string_view> kinds;  // Of action, sorted so word order does not matter
+    std::set<std::string> content;     // Every normalized word, likewise
+    std::string token;
+    auto flush = [&] {
+        while (!token.empty() && (token.back() == '.' || token.back() == ':')) token.pop_back();
+        if (token.empty()) return;
+
+        if (is_literal(token) || negations().count(token)) {
+            anchors.feed(token);
+            words.push_back(std::move(token));
+        } else if (!stop_words().count(token)) {
+            std::string word = stem(std::move(token));
+            auto synonym = synonyms().find(word);
+            if (synonym != synonyms().end()) word = synonym->second;
+            std::string_view kind = action_kind(word);
+            if (!kind.empty()) kinds.insert(kind);
+            content.insert(word);
+            words.push_back(std::move(word));
+        }
+        token.clear();
+    };
+    for (unsigned char c : prompt) {
+        if (is_token_char(c)) {
+            token += static_cast<char>(std::tolower(c));
+        } else {
+            flush();
+        }
+    }
+    flush();
+
+    for (std::string_view kind : kinds) anchors.feed("action").feed(kind);
+    // A word without a counterpart in the other request can change what it
+    // asks for ("owned by alice", "sorted by date"), however long the rest is
+    for (const auto& word : content) anchors.feed("word").feed(word);
+    vec.anchors = anchors.digest().lo;
+    if (words.empty()) return vec;
+    vec.empty = false;
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        const std::string& word = words[i];
+        add_feature(vec, "w", word, 1.0f);
+
+        // Word order, so "convert png to jpg" differs from "convert jpg to png"
+        if (i + 1 < words.size()) {
+            add_feature(vec, "b", word + " " + words[i + 1], 0.7f);
+        }
+    }
+
+    float norm = std::sqrt(dot_scalar(vec.values.data(), vec.values.data()));
+    if (norm > 0) {
+        for (float& v : vec.values) v /= norm;
+    }
+    return vec;
+}
+
+struct SemanticCache::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dims;
+    uint32_t capacity;
+    uint32_t count;     // Valid entries, at most capacity
+    uint32_t next;      // Ring position of the next insert
+    uint64_t reserved[5];
+};
+
+struct SemanticCache::Entry {
+    uint64_t scope;
+    uint64_t anchors;
+    uint64_t key_hi;
+    uint64_t key_lo;
+    char prompt[96];    // NUL-terminated, truncated for display
+};
+
+SemanticCache::SemanticCache(const std::string& directory) {
+    static_assert(sizeof(Header) % 32 == 0, "vectors must stay aligned");
+
+    if (!make_dirs(directory)) {
+        throw std::runtime_error("Cannot create cache directory: " + directory);
+    }
+
+    std::string path = directory + "/semantic.idx";
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open semantic cache in " + directory);
+    }
+
+    FileLock lock(fd_);
+
+    map_size_ = sizeof(Header) + (sizeof(float) * kDims + sizeof(Entry)) * kCapacity;
+    struct stat st;
+    bool fresh = fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) != map_size_;
+    if (fresh && ftruncate(fd_, static_cast<off_t>(map_size_)) != 0) {
+        close(fd_);
+        throw std::runtime_error("Cannot size semantic cache index");
+    }
+
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        close(fd_);
+        throw std::runtime_error("Cannot map semantic cache index");
+    }
+
+    Header* h = header();
+    if (fresh || h->magic != kMagic || h->version != kVersion || h->dims != kDims || h->capacity != kCapacity) {
+        std::memset(h, 0, sizeof(Header));
+        h->magic = kMagic;
+        h->version = kVersion;
+        h->dims = kDims;
+        h->capacity = kCapacity;
+    }
+}
+
+SemanticCache::~SemanticCache() {
+    if (map_) munmap(map_, map_size_);
+    if (fd_ >= 0) close(fd_);
+}
+
+SemanticCache::Header* SemanticCache::header() const {
+    return static_cast<Header*>(map_);
+}
+
+float* SemanticCache::vectors() const {
+    return reinterpret_cast<float*>(static_cast<char*>(map_) + sizeof(Header));
+}
+
+SemanticCache::Entry* SemanticCache::entries() const {
+    return reinterpret_cast<Entry*>(vectors() + kDims * kCapacity);
+}
+
+long SemanticCache::best(uint64_t scope, const PromptVector& query, float& similarity) const {
+    const uint32_t count = std::min(header()->count, kCapacity);
+    const float* rows = vectors();
+    const Entry* meta = entries();
+
+    long best = -1;
+    similarity = -1;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (meta[i].scope != scope || meta[i].anchors != query.anchors) continue;
+        float s = dot(query.values.data(), rows + static_cast<size_t>(i) * kDims);
+        if (s > similarity) {
+            similarity = s;
+            best = i;
+        }
+    }
+    return best;
+}
+
+std::optional<SemanticMatch> SemanticCache::lookup(uint64_t scope, std::string_view prompt, float threshold) {
+    PromptVector query = PromptVector::from(prompt);
+    if (query.empty) return std::nullopt;
+
+    FileLock lock(fd_, true);
+    float similarity;
+    long index = best(scope, query, similarity);
+    if (index < 0 || similarity < threshold) return std::nullopt;
+
+    const Entry& entry = entries()[index];
+    SemanticMatch match;
+    match.key = {entry.key_hi, entry.key_lo};
+    match.prompt.assign(entry.prompt, strnlen(entry.prompt, sizeof(entry.prompt)));
+    match.similarity = std::min(similarity, 1.0f);
+    return match;
+}
+
+void SemanticCache::insert(uint64_t scope, std::string_view prompt, const Hash128& key) {
+    PromptVector vec = PromptVector::from(prompt);
+    if (vec.empty) return;
+
+    FileLock lock(fd_);
+    Header* h = header();
+
+    // Rewording of a prompt already indexed: point it at the newer answer
+    float similarity;
+    long index = best(scope, vec, similarity);
+    if (index < 0 || similarity < 0.999f) {
+        index = h->next % kCapacity;
+        h->next = (h->next + 1) % kCapacity;
+        h->count = std::min(h->count + 1, kCapacity);
+    }
+
+    std::memcpy(vectors() + static_cast<size_t>(index) * kDims, vec.values.data(), sizeof(float) * kDims);
+    Entry& entry = entries()[index];
+    entry.scope = scope;
+    entry.anchors = vec.anchors;
+    entry.key_hi = key.hi;
+    entry.key_lo = key.lo;
+    size_t length = std::min(prompt.size(), sizeof(entry.prompt) - 1);
+    std::memcpy(entry.prompt, prompt.data(), length);
+    entry.prompt[length] = '\0';
+}
+
+} // namespace neuron
@@ -0,0 +1,74 @@
+#include "neuron/single_flight.hpp"
+#include "neuron/paths.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace neuron {
+
+namespace {
+
+// The lock file at path is still the one fd has open; a finished leader
+// unlinks it before unlocking, so whoever got the lock next may hold a
+// file nobody else can find
+bool still_linked(int fd, const std::string& path) {
+    struct stat held, linked;
+    return fstat(fd, &held) == 0 && stat(path.c_str(), &linked) == 0 &&
+           held.st_dev == linked.st_dev && held.st_ino == linked.st_ino;
+}
+
+} // namespace
+
+SingleFlight::SingleFlight(const std::string& directory, const Hash128& key, std::chrono::milliseconds timeout) {
+    if (!make_dirs(directory)) return;
+
+    char name[48];
+    std::snprintf(name, sizeof(name), "/%016llx%016llx.lock",
+                  static_cast<unsigned long long>(key.hi), static_cast<unsigned long long>(key.lo));
+    path_ = directory + name;
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) return;
+
+        // flock() has no timeout, so waiting polls, quickly at first since
+        // most answers take a second or two
+        auto pause = std::chrono::milliseconds(2);
+        while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            if (errno != EWOULDBLOCK && errno != EINTR) {
+                close(fd);
+                return;
+            }
+            waited_ = true;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                close(fd);
+                return;
+            }
+            std::this_thread::sleep_for(pause);
+            pause = std::min(pause * 3 / 2, std::chrono::milliseconds(25));
+        }
+
+        if (still_linked(fd, path_)) {
+            fd_ = fd;
+            return;
+        }
+        close(fd);
+    }
+}
+
+SingleFlight::~SingleFlight() {
+    if (fd_ < 0) return;
+
+    // Unlink while still holding the lock, so the next one starts afresh
+    unlink(path_.c_str());
+    close(fd_);
+}
+
+} // namespace neuron
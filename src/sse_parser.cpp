@@ -0,0 +1,72 @@
+#include "neuron/sse_parser.hpp"
+
+namespace neuron {
+
+SseParser::SseParser(EventCallback on_event)
+    : on_event_(std::move(on_event)) {}
+
+void SseParser::feed(const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+
+        // A CRLF pair may be split across two chunks
+        if (skip_lf_) {
+            skip_lf_ = false;
+            if (c == '\n') continue;
+        }
+
+        if (c == '\r' || c == '\n') {
+            skip_lf_ = (c == '\r');
+            process_line();
+            line_.clear();
+        } else {
+            line_.push_back(c);
+        }
+    }
+}
+
+void SseParser::finish() {
+    if (!line_.empty()) {
+        process_line();
+        line_.clear();
+    }
+    dispatch();
+}
+
+void SseParser::process_line() {
+    // Blank line terminates the current event
+    if (line_.empty()) {
+        dispatch();
+        return;
+    }
+
+    // Comment lines (keep-alives) start with a colon
+    if (line_[0] == ':') return;
+
+    std::string_view line(line_);
+    std::string_view field = line;
+    std::string_view value;
+
+    size_t colon = line.find(':');
+    if (colon != std::string_view::npos) {
+        field = line.substr(0, colon);
+        value = line.substr(colon + 1);
+        if (!value.empty() && value[0] == ' ') value.remove_prefix(1);
+    }
+
+    // Only "data" matters for chat completions; event/id/retry are ignored
+    if (field == "data") {
+        if (has_data_) data_.push_back('\n');
+        data_.append(value);
+        has_data_ = true;
+    }
+}
+
+void SseParser::dispatch() {
+    if (!has_data_) return;
+    on_event_(data_);
+    data_.clear();
+    has_data_ = false;
+}
+
+} // namespace neuron
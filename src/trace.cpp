@@ -0,0 +1,175 @@
+#include "neuron/trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <unistd.h>
+
+namespace neuron {
+
+using json = nlohmann::json;
+
+namespace {
+
+// Small, stable thread numbers read better in a trace viewer than hashes
+int thread_number() {
+    static std::atomic<int> next{1};
+    thread_local int number = next++;
+    return number;
+}
+
+} // namespace
+
+Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::enable() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled()) return;
+    origin_ = Clock::now();
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+int64_t Tracer::since_origin(Clock::time_point t) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - origin_).count();
+}
+
+void Tracer::add(std::string_view name, std::string_view category, Clock::time_point start,
+                 Clock::time_point end, std::string detail) {
+    if (!enabled()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back(Span{std::string(name), std::string(category), since_origin(start),
+                          std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()),
+                          thread_number(), std::move(detail)});
+}
+
+void Tracer::add_transfer(CURL* curl, int attempt) {
+    if (!enabled() || !curl) return;
+
+    // All curl timers are cumulative from the start of the transfer
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    long status = 0, new_connections = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+
+    const Clock::time_point end = Clock::now();
+    const Clock::time_point start = end - std::chrono::microseconds(total);
+    auto at = [&](curl_off_t us) { return start + std::chrono::microseconds(us); };
+
+    std::string detail = "attempt " + std::to_string(attempt) + ", HTTP " + std::to_string(status) +
+                         (new_connections == 0 ? ", reused connection" : ", new connection");
+    add("http request", "network", start, end, std::move(detail));
+
+    // A reused connection reports zero for the setup phases
+    if (dns > 0) add("dns", "network", start, at(dns));
+    if (connect > dns) add("tcp connect", "network", at(dns), at(connect));
+    if (tls > connect) add("tls handshake", "network", at(connect), at(tls));
+    if (first_byte > pretransfer) add("time to first byte", "network", at(pretransfer), at(first_byte));
+    if (total > first_byte && first_byte > 0) add("response transfer", "network", at(first_byte), end);
+}
+
+void Tracer::note(std::string_view name, std::string value) {
+    if (!enabled()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [existing, text] : notes_) {
+        if (existing == name) {
+            text = std::move(value);
+            return;
+        }
+    }
+    notes_.emplace_back(std::string(name), std::move(value));
+}
+
+void Tracer::print_summary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Phases in order of first appearance, totals across repeats
+    struct Totals {
+        size_t order;
+        size_t calls = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+    };
+    std::map<std::string, Totals> phases;
+    for (const auto& span : spans_) {
+        auto [it, inserted] = phases.try_emplace(span.name, Totals{phases.size()});
+        it->second.calls++;
+        it->second.total_us += span.duration_us;
+        it->second.max_us = std::max(it->second.max_us, span.duration_us);
+    }
+
+    std::vector<std::pair<std::string, Totals>> rows(phases.begin(), phases.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.order < b.second.order; });
+
+    char line[128];
+    out << "\n\033[1;35m⏱  Trace\033[0m" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-22s %6s %11s %11s", "phase", "calls", "total ms", "max ms");
+    out << "\033[2;37m" << line << "\033[0m" << std::endl;
+    for (const auto& [name, totals] : rows) {
+        std::snprintf(line, sizeof(line), "  %-22s %6zu %11.2f %11.2f", name.c_str(), totals.calls,
+                      static_cast<double>(totals.total_us) / 1000.0, static_cast<double>(totals.max_us) / 1000.0);
+        out << line << std::endl;
+    }
+    std::snprintf(line, sizeof(line), "  %-22s %6s %11.2f", "wall", "",
+                  static_cast<double>(since_origin(Clock::now())) / 1000.0);
+    out << "\033[1m" << line << "\033[0m" << std::endl;
+    for (const auto& [name, value] : notes_) {
+        out << "\033[2;37m  " << name << ": " << value << "\033[0m" << std::endl;
+    }
+}
+
+bool Tracer::write_chrome_trace(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    json events = json::array();
+    const int pid = static_cast<int>(getpid());
+    for (const auto& span : spans_) {
+        json event = {
+            {"name", span.name},
+            {"cat", span.category},
+            {"ph", "X"},
+            {"ts", span.start_us},
+            {"dur", span.duration_us},
+            {"pid", pid},
+            {"tid", span.thread},
+        };
+        if (!span.detail.empty()) {
+            event["args"] = {{"detail", span.detail}};
+        }
+        events.push_back(std::move(event));
+    }
+
+    std::ofstream file(path);
+    if (!file) return false;
+    json trace = {{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    for (const auto& [name, value] : notes_) trace["otherData"][name] = value;
+    file << trace.dump() << std::endl;
+    return static_cast<bool>(file);
+}
+
+TraceSpan::TraceSpan(std::string_view name, std::string_view category)
+    : name_(name), category_(category), active_(Tracer::global().enabled()) {
+    if (active_) start_ = Tracer::Clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+    if (active_) {
+        Tracer::global().add(name_, category_, start_, Tracer::Clock::now(), std::move(detail_));
+    }
+}
+
+} // namespace neuron
@@ -0,0 +1,244 @@
+#include "neuron/transport_cache.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace neuron {
+
+namespace {
+
+constexpr char kSessionMagic[4] = {'N', 'T', 'S', '1'};
+constexpr size_t kMaxSessionFile = 256 * 1024;
+
+int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Through a proxy the connected address is the proxy's, not the host's
+bool behind_proxy() {
+    for (const char* name : {"https_proxy", "HTTPS_PROXY", "http_proxy", "all_proxy", "ALL_PROXY"}) {
+        const char* value = std::getenv(name);
+        if (value && *value) return true;
+    }
+    return false;
+}
+
+// "host:port" of the URL a handle last fetched, or empty
+std::string host_port(CURL* handle) {
+    char* url = nullptr;
+    if (curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || !url) return "";
+
+    std::string key;
+    CURLU* parsed = curl_url();
+    char* host = nullptr;
+    char* port = nullptr;
+    if (parsed && curl_url_set(parsed, CURLUPART_URL, url, 0) == CURLUE_OK &&
+        curl_url_get(parsed, CURLUPART_HOST, &host, 0) == CURLUE_OK &&
+        curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) == CURLUE_OK) {
+        key = std::string(host) + ":" + port;
+    }
+    curl_free(host);
+    curl_free(port);
+    curl_url_cleanup(parsed);
+    return key;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Replaces path with contents in one rename, private to the user
+void write_file(const std::string& path, const std::string& contents) {
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    bool written = write_all(fd, contents.data(), contents.size());
+    close(fd);
+    if (!written || rename(temp.c_str(), path.c_str()) != 0) unlink(temp.c_str());
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// One "host:port ip expires" line of dns.txt, if it has not expired
+bool parse_address(const std::string& line, int64_t now, std::string& key, std::string& ip, int64_t& expires) {
+    std::istringstream fields(line);
+    return (fields >> key >> ip >> expires) && expires > now;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+template <typename T>
+void append_pod(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+CURLcode collect_session(CURL*, void* userptr, const char*, const unsigned char* shmac, size_t shmac_len,
+                         const unsigned char* sdata, size_t sdata_len, curl_off_t valid_until, int,
+                         const char*, size_t) {
+    auto& out = *static_cast<std::string*>(userptr);
+    if (!shmac || !sdata || out.size() + shmac_len + sdata_len > kMaxSessionFile) return CURLE_OK;
+
+    // Only the salted hash of the peer is stored, not the host name
+    append_pod<int64_t>(out, static_cast<int64_t>(valid_until));
+    append_pod<uint32_t>(out, static_cast<uint32_t>(shmac_len));
+    append_pod<uint32_t>(out, static_cast<uint32_t>(sdata_len));
+    out.append(reinterpret_cast<const char*>(shmac), shmac_len);
+    out.append(reinterpret_cast<const char*>(sdata), sdata_len);
+    return CURLE_OK;
+}
+#endif
+
+} // namespace
+
+TransportCache::TransportCache(std::string directory, std::chrono::seconds dns_ttl)
+    : directory_(std::move(directory)), dns_ttl_(dns_ttl) {
+    if (directory_.empty()) return;
+    altsvc_path_ = directory_ + "/altsvc.txt";
+    if (dns_ttl_.count() > 0) load_addresses();
+}
+
+TransportCache::~TransportCache() {
+    if (resolve_) curl_slist_free_all(resolve_);
+}
+
+void TransportCache::apply(CURL* handle) {
+    if (resolve_) curl_easy_setopt(handle, CURLOPT_RESOLVE, resolve_);
+    if (!altsvc_path_.empty()) {
+        curl_easy_setopt(handle, CURLOPT_ALTSVC_CTRL, static_cast<long>(CURLALTSVC_H1 | CURLALTSVC_H2 | CURLALTSVC_H3));
+        curl_easy_setopt(handle, CURLOPT_ALTSVC, altsvc_path_.c_str());
+    }
+    if (!sessions_imported_) {
+        sessions_imported_ = true;
+        import_sessions(handle);
+    }
+}
+
+void TransportCache::observe(CURL* handle) {
+    if (directory_.empty() || dns_ttl_.count() <= 0 || behind_proxy()) return;
+
+    std::string key = host_port(handle);
+    if (key.empty() || key[0] == '[') return;
+
+    // Nothing came back: the saved address may be what failed
+    long status = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 0) {
+        dirty_ = addresses_.erase(key) > 0 || dirty_;
+        return;
+    }
+
+    char* ip = nullptr;
+    if (curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &ip) != CURLE_OK || !ip || !*ip) return;
+    if (key.compare(0, key.rfind(':'), ip) == 0) return;  // Already an address
+
+    // Keep the original expiry, so a pinned address is looked up again on schedule
+    auto it = addresses_.find(key);
+    if (it != addresses_.end() && it->second.ip == ip) return;
+    addresses_[key] = Address{ip, now_seconds() + dns_ttl_.count()};
+    dirty_ = true;
+}
+
+void TransportCache::save(CURL* handle) {
+    if (directory_.empty()) return;
+    if (dirty_) save_addresses();
+    export_sessions(handle);
+}
+
+void TransportCache::load_addresses() {
+    std::istringstream in(read_file(directory_ + "/dns.txt"));
+    const int64_t now = now_seconds();
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string key, ip;
+        int64_t expires = 0;
+        if (!parse_address(line, now, key, ip, expires)) continue;
+        addresses_[key] = Address{ip, expires};
+
+        // "+" lets the entry age out of libcurl's DNS cache like a lookup would
+        std::string entry = "+" + key + ":" + (ip.find(':') != std::string::npos ? "[" + ip + "]" : ip);
+        resolve_ = curl_slist_append(resolve_, entry.c_str());
+    }
+}
+
+std::string TransportCache::saved_address(const std::string& directory, const std::string& host_port) {
+    std::istringstream in(read_file(directory + "/dns.txt"));
+    const int64_t now = now_seconds();
+    std::string line, key, ip;
+    int64_t expires = 0;
+    while (std::getline(in, line)) {
+        if (parse_address(line, now, key, ip, expires) && key == host_port) return ip;
+    }
+    return "";
+}
+
+void TransportCache::save_addresses() const {
+    const int64_t now = now_seconds();
+    std::string out;
+    for (const auto& [key, address] : addresses_) {
+        if (address.expires <= now) continue;
+        out += key + " " + address.ip + " " + std::to_string(address.expires) + "\n";
+    }
+    write_file(directory_ + "/dns.txt", out);
+}
+
+void TransportCache::import_sessions(CURL* handle) {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    std::string data = read_file(directory_ + "/tls.sessions");
+    if (data.size() < sizeof(kSessionMagic) || std::memcmp(data.data(), kSessionMagic, sizeof(kSessionMagic)) != 0) {
+        return;
+    }
+
+    const int64_t now = now_seconds();
+    size_t offset = sizeof(kSessionMagic);
+    while (offset + 16 <= data.size()) {
+        int64_t valid_until;
+        uint32_t shmac_len, sdata_len;
+        std::memcpy(&valid_until, data.data() + offset, 8);
+        std::memcpy(&shmac_len, data.data() + offset + 8, 4);
+        std::memcpy(&sdata_len, data.data() + offset + 12, 4);
+        offset += 16;
+        if (data.size() - offset < static_cast<size_t>(shmac_len) + sdata_len) break;
+
+        const auto* shmac = reinterpret_cast<const unsigned char*>(data.data() + offset);
+        const auto* sdata = shmac + shmac_len;
+        offset += static_cast<size_t>(shmac_len) + sdata_len;
+        if (valid_until > 0 && valid_until <= now) continue;
+        curl_easy_ssls_import(handle, nullptr, shmac, shmac_len, sdata, sdata_len);
+    }
+#else
+    (void)handle;
+#endif
+}
+
+void TransportCache::export_sessions(CURL* handle) const {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    std::string out(kSessionMagic, sizeof(kSessionMagic));
+    if (curl_easy_ssls_export(handle, collect_session, &out) == CURLE_OK && out.size() > sizeof(kSessionMagic)) {
+        write_file(directory_ + "/tls.sessions", out);
+    }
+#else
+    (void)handle;
+#endif
+}
+
+} // namespace neuron
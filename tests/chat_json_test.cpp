@@ -0,0 +1,103 @@
+// Checks the hand-rolled completion scanner against nlohmann::json: both
+// must agree on whether a body is well-formed, and on the fields the
+// scanner pulls out of it. Exits non-zero on any mismatch.
+
+#include "neuron/chat_json.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+struct Case {
+    std::string_view body;
+    std::string_view content;  // Expected choices[0] content when well-formed
+};
+
+constexpr Case kCases[] = {
+    // Plain bodies
+    {R"({"choices":[{"message":{"role":"assistant","content":"ls -la"},"finish_reason":"stop"}]})", "ls -la"},
+    {R"( {"id":"x","choices":[{"delta":{"content":"du -sh"}}],"usage":null} )", "du -sh"},
+    {R"({"choices":[{"message":{"content":"a"}},{"message":{"content":"b"}}]})", "a"},
+    {R"({})", ""},
+    {R"([1,2,3])", ""},
+
+    // Escapes
+    {R"({"choices":[{"message":{"content":"tab\there \"quoted\" \\ \/"}}]})", "tab\there \"quoted\" \\ /"},
+    {R"({"choices":[{"message":{"content":"café €"}}]})", "café €"},
+    {R"({"choices":[{"message":{"content":"\ud83d\ude80"}}]})", "\U0001F680"},
+    {R"({"choices":[{"message":{"content":"caf\u00e9 \u20AC"}}]})", "café €"},
+    {R"({"choices":[{"message":{"content":"\u0078\u0000y"}}]})", std::string_view("x\0y", 3)},
+    {"{\"choices\":[{\"message\":{\"content\":\"\xe2\x82\xac\"}}]}", "€"},
+    {R"({"choices":[{"message":{"content":"\ud83d"}}]})", ""},
+    {R"({"choices":[{"message":{"content":"\ude80"}}]})", ""},
+    {R"({"choices":[{"message":{"content":"\ud83dA"}}]})", ""},
+    {R"({"choices":[{"message":{"content":"\u00g0"}}]})", ""},
+    {R"({"choices":[{"message":{"content":"\x"}}]})", ""},
+    {"{\"choices\":[{\"message\":{\"content\":\"line\nbreak\"}}]}", ""},
+    {"{\"choices\":[{\"message\":{\"content\":\"\xc3\"}}]}", ""},
+    {"{\"choices\":[{\"message\":{\"content\":\"\xc0\xaf\"}}]}", ""},
+    {"{\"choices\":[{\"message\":{\"content\":\"\xed\xa0\x80\"}}]}", ""},
+    {"{\"k\xff\":1}", ""},
+
+    // Unexpected types and nulls
+    {R"({"choices":[{"message":{"content":null},"finish_reason":null}]})", ""},
+    {R"({"choices":[{"message":null}]})", ""},
+    {R"({"choices":null})", ""},
+    {R"({"choices":{"message":{"content":"x"}}})", ""},
+    {R"({"choices":["x",{"message":{"content":"y"}}]})", ""},
+    {R"({"choices":[{"message":"x"}]})", ""},
+    {R"({"choices":[{"message":{"content":42}}]})", ""},
+    {R"({"choices":[{"message":{"content":["x"]}}]})", ""},
+    {R"({"usage":"none"})", ""},
+    {R"({"usage":{"prompt_tokens":"12","total_tokens":1.5e1}})", ""},
+
+    // Numbers
+    {R"({"n":0,"m":-0,"o":1.25,"p":-3e+2,"q":2E-1,"r":10})", ""},
+    {R"({"n":01})", ""},
+    {R"({"n":-})", ""},
+    {R"({"n":1e5e5})", ""},
+    {R"({"n":1.})", ""},
+    {R"({"n":.5})", ""},
+    {R"({"n":+1})", ""},
+    {R"({"n":1e})", ""},
+    {R"({"n":--1})", ""},
+    {R"({"n":0x10})", ""},
+    {R"({"usage":{"prompt_tokens":-})", ""},
+
+    // Structure
+    {R"({"choices":[{"message":{"content":"x"}}]} trailing)", ""},
+    {R"({"choices":[]}{})", ""},
+    {R"({"choices":[],})", ""},
+    {R"({"choices":[1,]})", ""},
+    {R"({"choices":[})", ""},
+    {R"({"a" 1})", ""},
+    {R"({'a':1})", ""},
+    {R"({"a":tru})", ""},
+    {R"({"a":nul})", ""},
+    {"", ""},
+};
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (const Case& c : kCases) {
+        bool expected = !nlohmann::json::parse(c.body, nullptr, false).is_discarded();
+        neuron::CompletionFields fields;
+        bool scanned = neuron::extract_completion(c.body, fields);
+        if (scanned == expected && (!scanned || fields.content == c.content)) continue;
+
+        ++failures;
+        std::cerr << "FAIL: " << c.body << "\n  nlohmann " << (expected ? "accepts" : "rejects") << ", scanner "
+                  << (scanned ? "accepts" : "rejects");
+        if (scanned && expected) std::cerr << " with content \"" << fields.content << "\"";
+        std::cerr << std::endl;
+    }
+    std::cout << (std::size(kCases) - static_cast<size_t>(failures)) << "/" << std::size(kCases) << " passed"
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// Which pairs of requests the semantic cache treats as the same, including
+// pairs that once shared an answer they should not have. Exits non-zero on
+// any mismatch.
+
+#include "neuron/semantic_cache.hpp"
+
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+constexpr float kThreshold = 0.9f;  // NEURON_SEMANTIC_THRESHOLD default
+
+struct Case {
+    std::string_view cached;
+    std::string_view asked;
+    bool match;
+};
+
+constexpr Case kCases[] = {
+    // Rewordings
+    {"find big files", "find the largest files", true},
+    {"list largest files", "find big files", true},
+    {"show me the disk usage please", "display disk usage", true},
+    {"remove the stopped containers", "delete stopped containers", true},
+
+    // Literals and negations
+    {"find files larger than 500MB", "find files larger than 100MB", false},
+    {"delete *.log files", "delete *.txt files", false},
+    {"list files except hidden ones", "list hidden files", false},
+
+    // Actions
+    {"show old log files", "delete old log files", false},
+    {"stop the docker containers", "start the docker containers", false},
+    {"find the process on port 8080", "kill the process on port 8080", false},
+
+    // Word order
+    {"convert png to jpg", "convert jpg to png", false},
+
+    // One content word apart in a long request
+    {"find all files in the home directory owned by user alice and modified in the last week",
+     "find all files in the home directory owned by user bob and modified in the last week", false},
+    {"list every file in the current directory tree sorted by size with human readable units",
+     "list every file in the current directory tree sorted by date with human readable units", false},
+};
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (const Case& c : kCases) {
+        neuron::PromptVector cached = neuron::PromptVector::from(c.cached);
+        neuron::PromptVector asked = neuron::PromptVector::from(c.asked);
+        float similarity = neuron::dot(cached.values.data(), asked.values.data());
+        bool match = cached.anchors == asked.anchors && similarity >= kThreshold;
+        if (match == c.match) continue;
+
+        ++failures;
+        std::cerr << "FAIL: \"" << c.cached << "\" / \"" << c.asked << "\"\n  expected "
+                  << (c.match ? "a match" : "no match") << ", got similarity " << similarity
+                  << (cached.anchors == asked.anchors ? "" : " with different anchors") << std::endl;
+    }
+    std::cout << (std::size(kCases) - static_cast<size_t>(failures)) << "/" << std::size(kCases) << " passed"
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}